@@ -57,9 +57,10 @@ void update_elements(struct _fbg *fbg, int w, int h) {
   }
 }
 
-void draw_elements(struct _fbg *fbg, const char *text){
+void draw_elements(struct _fbg *fbg, struct _fbg_text_cache *text_cache, const char *text){
   for (int n = 0; n < NUM_ELEMS; n++) {
-    fbg_text_new(fbg, text, xs[n], ys[n], (n + 1), (n * 15) % 255, ((NUM_ELEMS-n) * 25) % 255, ((n) * 35) % 255);
+    // the text is rasterized once per size then drawn from the cache
+    fbg_textCached(fbg, text_cache, text, xs[n], ys[n], (n + 1), (n * 15) % 255, ((NUM_ELEMS-n) * 25) % 255, ((n) * 35) % 255);
   }
   }
 
@@ -77,15 +78,19 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  fbg_setTargetFramerate(fbg, 60);
+
   initialize_elements(fbg, vertex_size, vertex_size);
 
+  struct _fbg_text_cache *text_cache = fbg_createTextCache(NUM_ELEMS);
+
   do {
 
     fbg_clear(fbg, 0); // can also be replaced by fbg_background(fbg, 0, 0, 0);
 
     fbg_draw(fbg);
     update_elements(fbg, 40, 8);
-    draw_elements(fbg, "MOLLY");
+    draw_elements(fbg, text_cache, "MOLLY");
     // fbg_text_new(fbg, "JASON", 10, 10, 255, 255, 255);
 
     fbg_flip(fbg);
@@ -93,6 +98,8 @@ int main(int argc, char *argv[]) {
   while (keep_running)
     ;
 
+  fbg_freeTextCache(text_cache);
+
   fbg_close(fbg);
 
   return 0;
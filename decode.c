@@ -32,6 +32,11 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  fbg_setTargetFramerate(fbg, 60);
+
+  // smooth the color bands on 16 bpp displays
+  fbg_fbdevSetDither(fbg, FBG_FBDEV_DITHER_ORDERED);
+
   do {
     frame_counter++;
     if (frame_counter % 15 == 0) {
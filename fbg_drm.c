@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "fbg_drm.h"
+
+void fbg_drmFlip(struct _fbg *fbg);
+void fbg_drmFree(struct _fbg *fbg);
+void fbg_drmFreeContext(struct _fbg_drm_context *drm_context);
+
+int fbg_drmCreateBuffer(int fd, struct _fbg_drm_buffer *buffer, uint32_t width, uint32_t height) {
+    struct drm_mode_create_dumb create_dumb;
+    memset(&create_dumb, 0, sizeof(create_dumb));
+    create_dumb.width = width;
+    create_dumb.height = height;
+    create_dumb.bpp = 32;
+
+    if (drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &create_dumb) == -1) {
+        fprintf(stderr, "fbg_drmSetup: DRM_IOCTL_MODE_CREATE_DUMB failed!\n");
+
+        return 0;
+    }
+
+    buffer->handle = create_dumb.handle;
+    buffer->pitch = create_dumb.pitch;
+    buffer->size = create_dumb.size;
+
+    if (drmModeAddFB(fd, width, height, 24, 32, buffer->pitch, buffer->handle, &buffer->fb_id) != 0) {
+        fprintf(stderr, "fbg_drmSetup: drmModeAddFB failed!\n");
+
+        buffer->fb_id = 0;
+
+        return 0;
+    }
+
+    struct drm_mode_map_dumb map_dumb;
+    memset(&map_dumb, 0, sizeof(map_dumb));
+    map_dumb.handle = buffer->handle;
+
+    if (drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &map_dumb) == -1) {
+        fprintf(stderr, "fbg_drmSetup: DRM_IOCTL_MODE_MAP_DUMB failed!\n");
+
+        return 0;
+    }
+
+    buffer->map = (unsigned char *)mmap(0, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, map_dumb.offset);
+    if (buffer->map == MAP_FAILED) {
+        fprintf(stderr, "fbg_drmSetup: dumb buffer mmap failed!\n");
+
+        buffer->map = NULL;
+
+        return 0;
+    }
+
+    memset(buffer->map, 0, buffer->size);
+
+    return 1;
+}
+
+void fbg_drmDestroyBuffer(int fd, struct _fbg_drm_buffer *buffer) {
+    if (buffer->map) {
+        munmap(buffer->map, buffer->size);
+    }
+
+    if (buffer->fb_id) {
+        drmModeRmFB(fd, buffer->fb_id);
+    }
+
+    if (buffer->handle) {
+        struct drm_mode_destroy_dumb destroy_dumb;
+        memset(&destroy_dumb, 0, sizeof(destroy_dumb));
+        destroy_dumb.handle = buffer->handle;
+
+        drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_dumb);
+    }
+
+    memset(buffer, 0, sizeof(struct _fbg_drm_buffer));
+}
+
+// pick the first connected connector, its preferred mode and a CRTC able to drive it
+int fbg_drmFindOutput(struct _fbg_drm_context *drm_context) {
+    drmModeRes *resources = drmModeGetResources(drm_context->fd);
+    if (!resources) {
+        fprintf(stderr, "fbg_drmSetup: drmModeGetResources failed!\n");
+
+        return 0;
+    }
+
+    int found = 0;
+    int i = 0, j = 0, k = 0;
+
+    for (i = 0; i < resources->count_connectors && !found; i += 1) {
+        drmModeConnector *connector = drmModeGetConnector(drm_context->fd, resources->connectors[i]);
+        if (!connector) {
+            continue;
+        }
+
+        if (connector->connection != DRM_MODE_CONNECTED || connector->count_modes == 0) {
+            drmModeFreeConnector(connector);
+
+            continue;
+        }
+
+        drm_context->connector_id = connector->connector_id;
+        drm_context->mode = connector->modes[0];
+
+        for (j = 0; j < connector->count_modes; j += 1) {
+            if (connector->modes[j].type & DRM_MODE_TYPE_PREFERRED) {
+                drm_context->mode = connector->modes[j];
+
+                break;
+            }
+        }
+
+        // current encoder CRTC first then any CRTC compatible with one of the connector encoders
+        for (j = -1; j < connector->count_encoders && !found; j += 1) {
+            uint32_t encoder_id = (j < 0) ? connector->encoder_id : connector->encoders[j];
+            if (!encoder_id) {
+                continue;
+            }
+
+            drmModeEncoder *encoder = drmModeGetEncoder(drm_context->fd, encoder_id);
+            if (!encoder) {
+                continue;
+            }
+
+            for (k = 0; k < resources->count_crtcs; k += 1) {
+                int current = (j < 0 && encoder->crtc_id == resources->crtcs[k]);
+                int possible = (j >= 0 && (encoder->possible_crtcs & (1 << k)));
+
+                if (current || possible) {
+                    drm_context->crtc_id = resources->crtcs[k];
+                    drm_context->crtc_index = k;
+
+                    found = 1;
+
+                    break;
+                }
+            }
+
+            drmModeFreeEncoder(encoder);
+        }
+
+        drmModeFreeConnector(connector);
+    }
+
+    drmModeFreeResources(resources);
+
+    if (!found) {
+        fprintf(stderr, "fbg_drmSetup: no connected connector / usable CRTC found!\n");
+    }
+
+    return found;
+}
+
+// look for the primary plane of the CRTC and its FB_ID property, return 1 if atomic flips can be used
+int fbg_drmSetupAtomic(struct _fbg_drm_context *drm_context) {
+    if (drmSetClientCap(drm_context->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0 ||
+        drmSetClientCap(drm_context->fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0) {
+        return 0;
+    }
+
+    drmModePlaneRes *plane_resources = drmModeGetPlaneResources(drm_context->fd);
+    if (!plane_resources) {
+        return 0;
+    }
+
+    uint32_t i = 0, j = 0;
+
+    for (i = 0; i < plane_resources->count_planes && !drm_context->plane_id; i += 1) {
+        drmModePlane *plane = drmModeGetPlane(drm_context->fd, plane_resources->planes[i]);
+        if (!plane) {
+            continue;
+        }
+
+        if (plane->possible_crtcs & (1 << drm_context->crtc_index)) {
+            drmModeObjectProperties *properties = drmModeObjectGetProperties(drm_context->fd, plane->plane_id, DRM_MODE_OBJECT_PLANE);
+
+            if (properties) {
+                int primary = 0;
+                uint32_t prop_fb_id = 0;
+
+                for (j = 0; j < properties->count_props; j += 1) {
+                    drmModePropertyRes *property = drmModeGetProperty(drm_context->fd, properties->props[j]);
+                    if (!property) {
+                        continue;
+                    }
+
+                    if (strcmp(property->name, "type") == 0 && properties->prop_values[j] == DRM_PLANE_TYPE_PRIMARY) {
+                        primary = 1;
+                    } else if (strcmp(property->name, "FB_ID") == 0) {
+                        prop_fb_id = property->prop_id;
+                    }
+
+                    drmModeFreeProperty(property);
+                }
+
+                if (primary && prop_fb_id) {
+                    drm_context->plane_id = plane->plane_id;
+                    drm_context->prop_fb_id = prop_fb_id;
+                }
+
+                drmModeFreeObjectProperties(properties);
+            }
+        }
+
+        drmModeFreePlane(plane);
+    }
+
+    drmModeFreePlaneResources(plane_resources);
+
+    if (!drm_context->plane_id) {
+        return 0;
+    }
+
+    // make sure a plane-only commit is accepted by the driver
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    if (!request) {
+        return 0;
+    }
+
+    int ok = drmModeAtomicAddProperty(request, drm_context->plane_id, drm_context->prop_fb_id, drm_context->buffers[drm_context->back].fb_id) >= 0 &&
+        drmModeAtomicCommit(drm_context->fd, request, DRM_MODE_ATOMIC_TEST_ONLY, NULL) == 0;
+
+    drmModeAtomicFree(request);
+
+    return ok;
+}
+
+void fbg_drmFlipHandler(int fd, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, void *user_data) {
+    (void)fd;
+    (void)sequence;
+    (void)tv_sec;
+    (void)tv_usec;
+
+    struct _fbg_drm_context *drm_context = (struct _fbg_drm_context *)user_data;
+
+    drm_context->flip_pending = 0;
+}
+
+// block until the submitted flip completed (the flipped buffer is then scanned out)
+void fbg_drmWaitFlip(struct _fbg_drm_context *drm_context) {
+    drmEventContext event_context;
+    memset(&event_context, 0, sizeof(event_context));
+    event_context.version = 2;
+    event_context.page_flip_handler = fbg_drmFlipHandler;
+
+    struct pollfd pfd;
+    pfd.fd = drm_context->fd;
+    pfd.events = POLLIN;
+
+    while (drm_context->flip_pending) {
+        pfd.revents = 0;
+
+        int ret = poll(&pfd, 1, 1000);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        } else if (ret == 0) {
+            fprintf(stderr, "fbg_drmFlip: flip event timeout!\n");
+
+            break;
+        }
+
+        if (drmHandleEvent(drm_context->fd, &event_context) != 0) {
+            break;
+        }
+    }
+
+    drm_context->flip_pending = 0;
+
+    if (drm_context->pending >= 0) {
+        drm_context->front = drm_context->pending;
+        drm_context->pending = -1;
+    }
+}
+
+int fbg_drmSubmitFlip(struct _fbg_drm_context *drm_context, uint32_t fb_id) {
+    if (drm_context->atomic) {
+        drmModeAtomicReq *request = drmModeAtomicAlloc();
+
+        if (request) {
+            int ret = -1;
+
+            if (drmModeAtomicAddProperty(request, drm_context->plane_id, drm_context->prop_fb_id, fb_id) >= 0) {
+                ret = drmModeAtomicCommit(drm_context->fd, request, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, drm_context);
+            }
+
+            drmModeAtomicFree(request);
+
+            if (ret == 0) {
+                return 0;
+            }
+        }
+
+        fprintf(stderr, "fbg_drmFlip: atomic commit failed, falling back to drmModePageFlip!\n");
+
+        drm_context->atomic = 0;
+    }
+
+    return drmModePageFlip(drm_context->fd, drm_context->crtc_id, fb_id, DRM_MODE_PAGE_FLIP_EVENT, drm_context);
+}
+
+struct _fbg *fbg_drmSetup(char *dri_device) {
+    struct _fbg_drm_context *drm_context = (struct _fbg_drm_context *)calloc(1, sizeof(struct _fbg_drm_context));
+    if (!drm_context) {
+        fprintf(stderr, "fbg_drmSetup: drm context calloc failed!\n");
+        return NULL;
+    }
+
+    char *default_dri_device = "/dev/dri/card0";
+    dri_device = dri_device ? dri_device : default_dri_device;
+
+    drm_context->fd = open(dri_device, O_RDWR | O_CLOEXEC);
+
+    if (drm_context->fd == -1) {
+        fprintf(stderr, "fbg_drmSetup: Cannot open '%s'!\n", dri_device);
+
+        free(drm_context);
+
+        return NULL;
+    }
+
+    uint64_t has_dumb = 0;
+    if (drmGetCap(drm_context->fd, DRM_CAP_DUMB_BUFFER, &has_dumb) != 0 || !has_dumb) {
+        fprintf(stderr, "fbg_drmSetup: '%s' does not support dumb buffers!\n", dri_device);
+
+        close(drm_context->fd);
+
+        free(drm_context);
+
+        return NULL;
+    }
+
+    if (!fbg_drmFindOutput(drm_context)) {
+        close(drm_context->fd);
+
+        free(drm_context);
+
+        return NULL;
+    }
+
+    int width = drm_context->mode.hdisplay;
+    int height = drm_context->mode.vdisplay;
+
+    int i = 0;
+    for (i = 0; i < FBG_DRM_BUFFERS; i += 1) {
+        if (!fbg_drmCreateBuffer(drm_context->fd, &drm_context->buffers[i], width, height)) {
+            fbg_drmFreeContext(drm_context);
+
+            return NULL;
+        }
+    }
+
+    drm_context->front = 0;
+    drm_context->pending = -1;
+    drm_context->back = 1;
+
+    drm_context->saved_crtc = drmModeGetCrtc(drm_context->fd, drm_context->crtc_id);
+
+    if (drmModeSetCrtc(drm_context->fd, drm_context->crtc_id, drm_context->buffers[drm_context->front].fb_id, 0, 0, &drm_context->connector_id, 1, &drm_context->mode) != 0) {
+        fprintf(stderr, "fbg_drmSetup: '%s' drmModeSetCrtc failed!\n", dri_device);
+
+        fbg_drmFreeContext(drm_context);
+
+        return NULL;
+    }
+
+    drm_context->atomic = fbg_drmSetupAtomic(drm_context);
+
+    fprintf(stdout, "fbg_drmSetup: '%s' (%dx%d@%d, %d pitch, %s page flips)\n",
+        dri_device,
+        width, height, drm_context->mode.vrefresh,
+        drm_context->buffers[0].pitch,
+        drm_context->atomic ? "atomic" : "legacy");
+
+    struct _fbg *fbg = fbg_customSetup(width, height, 4, 0, 0, (void *)drm_context, NULL, fbg_drmFlip, NULL, fbg_drmFree);
+    if (!fbg) {
+        fprintf(stderr, "fbg_drmSetup: fbg_customSetup failed\n");
+
+        fbg_drmFreeContext(drm_context);
+
+        return NULL;
+    }
+
+    // XRGB8888 is stored as B, G, R, X
+    fbg->bgr = 1;
+
+    // render directly into the dumb buffers
+    fbg->line_length = drm_context->buffers[0].pitch;
+    fbg->size = fbg->line_length * fbg->height;
+
+    fbg->disp_buffer = drm_context->buffers[drm_context->front].map;
+    fbg->back_buffer = drm_context->buffers[drm_context->back].map;
+
+    return fbg;
+}
+
+void fbg_drmFlip(struct _fbg *fbg) {
+    struct _fbg_drm_context *drm_context = fbg->user_context;
+
+    // a single flip can be queued at a time
+    if (drm_context->flip_pending) {
+        fbg_drmWaitFlip(drm_context);
+    }
+
+    if (fbg_drmSubmitFlip(drm_context, drm_context->buffers[drm_context->back].fb_id) != 0) {
+        fprintf(stderr, "fbg_drmFlip: page flip failed!\n");
+
+        return;
+    }
+
+    drm_context->flip_pending = 1;
+    drm_context->pending = drm_context->back;
+
+    // triple buffering : render into the buffer which is neither scanned out nor waiting for its flip
+    int i = 0;
+    for (i = 0; i < FBG_DRM_BUFFERS; i += 1) {
+        if (i != drm_context->front && i != drm_context->pending) {
+            drm_context->back = i;
+
+            break;
+        }
+    }
+
+    fbg->disp_buffer = drm_context->buffers[drm_context->pending].map;
+    fbg->back_buffer = drm_context->buffers[drm_context->back].map;
+}
+
+void fbg_drmFreeContext(struct _fbg_drm_context *drm_context) {
+    if (drm_context->flip_pending) {
+        fbg_drmWaitFlip(drm_context);
+    }
+
+    if (drm_context->saved_crtc) {
+        drmModeCrtc *crtc = drm_context->saved_crtc;
+
+        drmModeSetCrtc(drm_context->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, &drm_context->connector_id, 1, &crtc->mode);
+
+        drmModeFreeCrtc(crtc);
+    }
+
+    int i = 0;
+    for (i = 0; i < FBG_DRM_BUFFERS; i += 1) {
+        fbg_drmDestroyBuffer(drm_context->fd, &drm_context->buffers[i]);
+    }
+
+    close(drm_context->fd);
+
+    free(drm_context);
+}
+
+void fbg_drmFree(struct _fbg *fbg) {
+    fbg_drmFreeContext(fbg->user_context);
+}
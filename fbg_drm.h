@@ -0,0 +1,75 @@
+#ifndef FB_GRAPHICS_DRM_H
+#define FB_GRAPHICS_DRM_H
+
+    #include <stdint.h>
+    #include <xf86drm.h>
+    #include <xf86drmMode.h>
+    #include "fbgraphics.h"
+
+    //! amount of dumb buffers (front, pending flip, back)
+    #define FBG_DRM_BUFFERS 3
+
+    //! DRM dumb buffer data structure
+    struct _fbg_drm_buffer {
+      //! GEM handle
+      uint32_t handle;
+      //! Framebuffer object id
+      uint32_t fb_id;
+      //! Line length in bytes
+      uint32_t pitch;
+      //! Buffer length in bytes
+      uint64_t size;
+
+      //! Memory-mapped buffer
+      unsigned char *map;
+    };
+
+    //! DRM/KMS wrapper data structure
+    struct _fbg_drm_context {
+      //! DRM device file descriptor
+      int fd;
+
+      //! Connector id
+      uint32_t connector_id;
+      //! CRTC id
+      uint32_t crtc_id;
+      //! CRTC index (used to match the planes)
+      int crtc_index;
+      //! Display mode
+      drmModeModeInfo mode;
+
+      //! CRTC configuration restored on exit
+      drmModeCrtc *saved_crtc;
+
+      //! Dumb buffers
+      struct _fbg_drm_buffer buffers[FBG_DRM_BUFFERS];
+      //! Index of the scanned out buffer
+      int front;
+      //! Index of the buffer waiting for its flip (-1 = none)
+      int pending;
+      //! Index of the buffer being rendered
+      int back;
+
+      //! Flag indicating that a flip was submitted and its completion event was not received yet
+      int flip_pending;
+
+      //! Flag indicating that flips use atomic commits (legacy drmModePageFlip otherwise)
+      int atomic;
+      //! Primary plane id (atomic)
+      uint32_t plane_id;
+      //! Primary plane FB_ID property id (atomic)
+      uint32_t prop_fb_id;
+    };
+
+    //! initialize a FB Graphics context (DRM/KMS dumb buffers)
+    //! the first connected connector is used with its preferred mode, flips are vsync-aligned page flips (atomic commit when supported) with triple buffering
+    //! note : the context is 32 bpp (XRGB8888), resizing is not supported
+    /*!
+      \param dri_device DRM device (example : /dev/dri/card0, vkms is usually the last card)
+      \return _fbg structure pointer to pass to any FBG library functions
+    */
+    extern struct _fbg *fbg_drmSetup(char *dri_device);
+
+    //! initialize a FB Graphics context with '/dev/dri/card0' as DRM device
+    #define fbg_drmInit() fbg_drmSetup(NULL)
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
@@ -10,16 +11,28 @@
 #include "fbg_fbdev.h"
 
 void fbg_fbdevDraw(struct _fbg *fbg);
+int fbg_fbdevVsync(struct _fbg *fbg);
 void fbg_fbdevFlip(struct _fbg *fbg);
 void fbg_fbdevFree(struct _fbg *fbg);
 
 struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
+    return fbg_fbdevSetupEx(fb_device, page_flipping, 1);
+}
+
+struct _fbg *fbg_fbdevSetupEx(char *fb_device, int page_flipping, int scale) {
+    if (scale < 1) {
+        fprintf(stderr, "fbg_fbdevSetup: invalid scale %d!\n", scale);
+        return NULL;
+    }
+
     struct _fbg_fbdev_context *fbdev_context = (struct _fbg_fbdev_context *)calloc(1, sizeof(struct _fbg_fbdev_context));
     if (!fbdev_context) {
         fprintf(stderr, "fbg_fbdevSetup: fbdev context calloc failed!\n");
         return NULL;
     }
 
+    fbdev_context->scale = scale;
+
     char *default_fb_device = "/dev/fb0";
     fb_device = fb_device ? fb_device : default_fb_device;
 
@@ -77,6 +90,33 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
         return NULL;
     }
 
+    if (scale > 1) {
+        if (fbdev_context->vinfo.xres < (unsigned int)scale || fbdev_context->vinfo.yres < (unsigned int)scale) {
+            fprintf(stderr, "fbg_fbdevSetup: '%s' scale %d is larger than the display!\n", fb_device, scale);
+
+            close(fbdev_context->fd);
+
+            free(fbdev_context);
+
+            return NULL;
+        }
+
+        fbdev_context->line = fbg_alignedAlloc(fbdev_context->finfo.line_length);
+        if (!fbdev_context->line) {
+            fprintf(stderr, "fbg_fbdevSetup: line allocation failed!\n");
+
+            close(fbdev_context->fd);
+
+            free(fbdev_context);
+
+            return NULL;
+        }
+
+        fprintf(stdout, "fbg_fbdevSetup: rendering at 1/%d resolution (%dx%d)\n", scale, fbdev_context->vinfo.xres / scale, fbdev_context->vinfo.yres / scale);
+
+        page_flipping = 0;
+    }
+
     int components = 3;
 
     if (fbdev_context->vinfo.bits_per_pixel == 16) {
@@ -87,10 +127,11 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
         components = fbdev_context->vinfo.bits_per_pixel / 8;
     }
 
-    struct _fbg *fbg = fbg_customSetup(fbdev_context->vinfo.xres, fbdev_context->vinfo.yres, components, 0, 0, (void *)fbdev_context, fbg_fbdevDraw, fbg_fbdevFlip, NULL, fbg_fbdevFree);
+    struct _fbg *fbg = fbg_customSetup(fbdev_context->vinfo.xres / scale, fbdev_context->vinfo.yres / scale, components, 0, 0, (void *)fbdev_context, fbg_fbdevDraw, fbg_fbdevFlip, NULL, fbg_fbdevFree);
     if (!fbg) {
         fprintf(stderr, "fbg_fbdevSetup: fbg_customSetup failed\n");
 
+        free(fbdev_context->line);
         close(fbdev_context->fd);
 
         free(fbdev_context);
@@ -98,6 +139,8 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
         return NULL;
     }
 
+    fbg->backend_vsync = fbg_fbdevVsync;
+
     if ((fbdev_context->vinfo.bits_per_pixel == 24 || fbdev_context->vinfo.bits_per_pixel == 32) &&
         fbdev_context->vinfo.red.length == 8 &&
         fbdev_context->vinfo.red.offset == 16 &&
@@ -154,14 +197,19 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
 
     // setup page flipping
     if (fbdev_context->page_flipping) {
+        // draw directly into the framebuffer so the hardware line length is used
+        fbg->line_length = fbdev_context->finfo.line_length;
+        fbg->size = fbg->line_length * fbg->height;
+
         fbg->disp_buffer = fbdev_context->buffer;
-        fbg->back_buffer = fbdev_context->buffer + fbg->width * fbg->components * fbg->height;
+        fbg->back_buffer = fbdev_context->buffer + fbg->size;
     } else {
         // setup front & back buffers
-        fbg->back_buffer = calloc(1, fbg->size * sizeof(char));
+        fbg->back_buffer = fbg_alignedAlloc(fbg->size * sizeof(char));
         if (!fbg->back_buffer) {
-            fprintf(stderr, "fbg_fbdevSetup: back_buffer calloc failed!\n");
+            fprintf(stderr, "fbg_fbdevSetup: back_buffer allocation failed!\n");
 
+            free(fbdev_context->line);
             close(fbdev_context->fd);
 
             free(fbdev_context);
@@ -169,11 +217,12 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
             return NULL;
         }
 
-        fbg->disp_buffer = calloc(1, fbg->size * sizeof(char));
+        fbg->disp_buffer = fbg_alignedAlloc(fbg->size * sizeof(char));
         if (!fbg->disp_buffer) {
-            fprintf(stderr, "fbg_fbdevSetup: disp_buffer calloc failed!\n");
+            fprintf(stderr, "fbg_fbdevSetup: disp_buffer allocation failed!\n");
 
             free(fbg->back_buffer);
+            free(fbdev_context->line);
             close(fbdev_context->fd);
 
             free(fbdev_context);
@@ -185,35 +234,234 @@ struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping) {
     return fbg;
 }
 
-void fbg_fbdevDraw(struct _fbg *fbg) {
-    struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
+// 4x4 Bayer matrix (thresholds 0 - 15)
+static const unsigned char fbg_fbdev_bayer[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
 
-#ifdef FBIO_WAITFORVSYNC
-    static int dummy = 0;
-    ioctl(fbdev_context->fd, FBIO_WAITFORVSYNC, &dummy);
-#endif
+// 24 bpp to 16 bpp (565) conversion of a row, errors is the diffusion state (2 * (width + 2) * 3 values, zeroed at the start of a band)
+void fbg_fbdevRow565(uint16_t *dst, const unsigned char *src, int width, int y, int dither, int16_t *errors) {
+    int x = 0;
+
+    if (dither == FBG_FBDEV_DITHER_ORDERED) {
+        // q = floor(v * levels / 255 + (t + 0.5) / 16), no branch nor clamp (divisions by a constant)
+        const unsigned char *bayer = fbg_fbdev_bayer[y & 3];
+
+        for (x = 0; x < width; x += 1) {
+            unsigned int t = bayer[x & 3] * 255 + 127;
+
+            unsigned int r = (src[0] * 31 * 16 + t) / 4080;
+            unsigned int g = (src[1] * 63 * 16 + t) / 4080;
+            unsigned int b = (src[2] * 31 * 16 + t) / 4080;
+
+            dst[x] = r | (g << 5) | (b << 11);
+
+            src += 3;
+        }
+    } else if (dither == FBG_FBDEV_DITHER_DIFFUSION) {
+        // serpentine Floyd-Steinberg : the row y error is read from one half of errors, the row y + 1 error accumulated into the other half
+        int stride = (width + 2) * 3;
+        int16_t *current = errors + (y & 1) * stride + 3;
+        int16_t *next = errors + ((y + 1) & 1) * stride + 3;
+
+        memset(next - 3, 0, stride * sizeof(int16_t));
+
+        int dir = (y & 1) ? -1 : 1;
+        int x_start = (dir == 1) ? 0 : width - 1;
+
+        int c = 0;
+        for (x = x_start; x >= 0 && x < width; x += dir) {
+            const unsigned char *p = src + x * 3;
+            int16_t *e = current + x * 3;
+            int16_t *n = next + x * 3;
+
+            int v[3];
+            for (c = 0; c < 3; c += 1) {
+                // error is in 1/16 units
+                int value = p[c] + (e[c] + 8) / 16;
+                value = _FBG_MIN(_FBG_MAX(value, 0), 255);
+
+                int bits = (c == 1) ? 2 : 3;
+                int q = value >> bits;
+                int err = value - ((q << bits) | (q >> (8 - 2 * bits)));
+
+                v[c] = q;
+
+                e[c + dir * 3] += err * 7;
+                n[c - dir * 3] += err * 3;
+                n[c] += err * 5;
+                n[c + dir * 3] += err;
+            }
+
+            dst[x] = v[0] | (v[1] << 5) | (v[2] << 11);
+        }
+    } else {
+        for (x = 0; x < width; x += 1) {
+            unsigned int v = ((src[0] >> 3) & 0x1f);
+            v |= ((src[1] >> 2) & 0x3f) << 5;
+            v |= ((src[2] >> 3) & 0x1f) << 11;
+
+            dst[x] = v;
+
+            src += 3;
+        }
+    }
+}
+
+int16_t *fbg_fbdevCreateErrors(struct _fbg *fbg, struct _fbg_fbdev_context *fbdev_context) {
+    if (fbdev_context->dither != FBG_FBDEV_DITHER_DIFFUSION) {
+        return NULL;
+    }
+
+    return (int16_t *)calloc(2 * (fbg->width + 2) * 3, sizeof(int16_t));
+}
+
+// 24 bpp to 16 bpp (565) conversion of the rows [y_start, y_end), the diffusion error restart at each band
+void fbg_fbdevConvertRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_fbdev_context *fbdev_context = (struct _fbg_fbdev_context *)user_data;
+
+    int fb_line_length = fbdev_context->finfo.line_length;
+
+    int16_t *errors = fbg_fbdevCreateErrors(fbg, fbdev_context);
+    int dither = (fbdev_context->dither == FBG_FBDEV_DITHER_DIFFUSION && !errors) ? FBG_FBDEV_DITHER_ORDERED : fbdev_context->dither;
+
+    int y = 0;
+
+    for (y = y_start; y < y_end; y += 1) {
+        unsigned char *pix_pointer_src = fbg->disp_buffer + y * fbg->line_length;
+        uint16_t *pix_pointer_dst = (uint16_t *)(fbdev_context->buffer + y * fb_line_length);
+
+        fbg_fbdevRow565(pix_pointer_dst, pix_pointer_src, fbg->width, y, dither, errors);
+    }
+
+    free(errors);
+}
+
+typedef uint32_t fbg_v4u32 __attribute__((vector_size(16)));
+
+// upscale a row of 32 bits pixels, pixel doubling use vector shuffles (4 source pixels per step)
+void fbg_fbdevUpscaleRow32(uint32_t *dst, const uint32_t *src, int width, int scale) {
+    int x = 0, i = 0;
+
+    if (scale == 2) {
+        const fbg_v4u32 lo_mask = { 0, 0, 1, 1 };
+        const fbg_v4u32 hi_mask = { 2, 2, 3, 3 };
+
+        for (; x <= width - 4; x += 4) {
+            fbg_v4u32 v;
+            memcpy(&v, src + x, sizeof(v));
+
+            fbg_v4u32 lo = __builtin_shuffle(v, lo_mask);
+            fbg_v4u32 hi = __builtin_shuffle(v, hi_mask);
+
+            memcpy(dst, &lo, sizeof(lo));
+            memcpy(dst + 4, &hi, sizeof(hi));
+
+            dst += 8;
+        }
+    }
+
+    for (; x < width; x += 1) {
+        uint32_t v = src[x];
+
+        for (i = 0; i < scale; i += 1) {
+            *dst++ = v;
+        }
+    }
+}
+
+void fbg_fbdevDrawScaled(struct _fbg *fbg, struct _fbg_fbdev_context *fbdev_context) {
+    int x = 0, y = 0, i = 0;
+
+    int scale = fbdev_context->scale;
+    int fb_line_length = fbdev_context->finfo.line_length;
+
+    unsigned char *line = fbdev_context->line;
+    unsigned char *fb_row = fbdev_context->buffer;
+
+    int16_t *errors = fbg_fbdevCreateErrors(fbg, fbdev_context);
+    int dither = (fbdev_context->dither == FBG_FBDEV_DITHER_DIFFUSION && !errors) ? FBG_FBDEV_DITHER_ORDERED : fbdev_context->dither;
+
+    for (y = 0; y < fbg->height; y += 1) {
+        unsigned char *pix_pointer_src = fbg->disp_buffer + y * fbg->line_length;
 
-    if (fbdev_context->page_flipping == 0) {
         if (fbdev_context->vinfo.bits_per_pixel == 16) {
-            unsigned char *pix_pointer_src = fbg->disp_buffer;
-            unsigned char *pix_pointer_dst = fbdev_context->buffer;
+            // convert (and dither) once per source pixel then replicate the 565 values in place, from the end so that no unread value is overwritten
+            uint16_t *pix_pointer_dst = (uint16_t *)line;
 
-            int i = 0;
+            fbg_fbdevRow565(pix_pointer_dst, pix_pointer_src, fbg->width, y, dither, errors);
 
-            for (i = 0; i < fbg->width_n_height; i += 1) {
-                unsigned int v = ((*pix_pointer_src++ >> 3) & 0x1f);
-                v |= ((*pix_pointer_src++ >> 2) & 0x3f) << 5;
-                v |= ((*pix_pointer_src++ >> 3) & 0x1f) << 11;
+            for (x = fbg->width - 1; x >= 0; x -= 1) {
+                uint16_t v = pix_pointer_dst[x];
 
-                *pix_pointer_dst++ = v;
-                *pix_pointer_dst++ = v >> 8;;
+                for (i = scale - 1; i >= 0; i -= 1) {
+                    pix_pointer_dst[x * scale + i] = v;
+                }
             }
+        } else if (fbg->components == 4) {
+            fbg_fbdevUpscaleRow32((uint32_t *)line, (const uint32_t *)pix_pointer_src, fbg->width, scale);
         } else {
+            unsigned char *pix_pointer_dst = line;
+
+            for (x = 0; x < fbg->width; x += 1) {
+                for (i = 0; i < scale; i += 1) {
+                    memcpy(pix_pointer_dst, pix_pointer_src, 3);
+                    pix_pointer_dst += 3;
+                }
+
+                pix_pointer_src += 3;
+            }
+        }
+
+        // the framebuffer is only written (never read back)
+        for (i = 0; i < scale; i += 1) {
+            memcpy(fb_row, line, fb_line_length);
+            fb_row += fb_line_length;
+        }
+    }
+    free(errors);
+}
+
+void fbg_fbdevDraw(struct _fbg *fbg) {
+    struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
+
+    if (fbdev_context->scale > 1) {
+        fbg_fbdevDrawScaled(fbg, fbdev_context);
+    } else if (fbdev_context->page_flipping == 0) {
+        int fb_line_length = fbdev_context->finfo.line_length;
+
+        if (fbdev_context->vinfo.bits_per_pixel == 16) {
+            fbg_parallelRows(fbg, fbg_fbdevConvertRows, fbdev_context);
+        } else if (fbg->line_length == fb_line_length) {
             memcpy(fbdev_context->buffer, fbg->disp_buffer, fbg->size);
+        } else {
+            // padded rows on either side
+            int y = 0;
+            int w3 = fbg->width * fbg->components;
+
+            for (y = 0; y < fbg->height; y += 1) {
+                memcpy(fbdev_context->buffer + y * fb_line_length, fbg->disp_buffer + y * fbg->line_length, w3);
+            }
         }
     }
 }
 
+int fbg_fbdevVsync(struct _fbg *fbg) {
+#ifdef FBIO_WAITFORVSYNC
+    struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
+
+    // argument is the CRTC index
+    __u32 crtc = 0;
+
+    return ioctl(fbdev_context->fd, FBIO_WAITFORVSYNC, &crtc) == -1 ? -1 : 0;
+#else
+    return -1;
+#endif
+}
+
 void fbg_fbdevFlip(struct _fbg *fbg) {
     struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
     
@@ -234,6 +482,12 @@ void fbg_fbdevFlip(struct _fbg *fbg) {
     fbg->back_buffer = tmp_buffer;
 }
 
+void fbg_fbdevSetDither(struct _fbg *fbg, int dither) {
+    struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
+
+    fbdev_context->dither = dither;
+}
+
 void fbg_fbdevFree(struct _fbg *fbg) {
     struct _fbg_fbdev_context *fbdev_context = fbg->user_context;
 
@@ -242,6 +496,8 @@ void fbg_fbdevFree(struct _fbg *fbg) {
         free(fbg->disp_buffer);
     }
 
+    free(fbdev_context->line);
+
     if (fbdev_context->buffer) {
         munmap(fbdev_context->buffer, fbdev_context->finfo.smem_len);
         close(fbdev_context->fd);
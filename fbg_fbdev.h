@@ -4,6 +4,13 @@
     #include <linux/fb.h>
     #include "fbgraphics.h"
 
+    //! 16 bpp conversion truncate the colors (banding on gradients)
+    #define FBG_FBDEV_DITHER_NONE 0
+    //! 16 bpp conversion with a 4x4 Bayer matrix (ordered) dither
+    #define FBG_FBDEV_DITHER_ORDERED 1
+    //! 16 bpp conversion with a serpentine Floyd-Steinberg (error diffusion) dither, the error restart at each thread pool band
+    #define FBG_FBDEV_DITHER_DIFFUSION 2
+
     //! fbdev wrapper data structure
     struct _fbg_fbdev_context {
       //! Framebuffer device file descriptor
@@ -19,6 +26,14 @@
 
       //! Flag indicating that page flipping is enabled
       int page_flipping;
+
+      //! Integer upscale factor applied on draw (1 = native resolution)
+      int scale;
+      //! Upscaled line (written once then replicated scale times into the framebuffer)
+      unsigned char *line;
+
+      //! Dithering applied by the 16 bpp conversion (FBG_FBDEV_DITHER_NONE, FBG_FBDEV_DITHER_ORDERED or FBG_FBDEV_DITHER_DIFFUSION)
+      int dither;
     };
 
     //! initialize a FB Graphics context (framebuffer)
@@ -29,6 +44,25 @@
     */
     extern struct _fbg *fbg_fbdevSetup(char *fb_device, int page_flipping);
 
+    //! initialize a FB Graphics context (framebuffer) rendering at a reduced resolution
+    //! the context is xres / scale by yres / scale pixels, it is upscaled (pixel doubling / tripling fused with the format conversion) when drawn
+    //! note : page flipping is disabled when scale is above 1
+    /*!
+      \param fb_device framebuffer device (example : /dev/fb0)
+      \param page_flipping wether to use page flipping mechanism for double buffering (slow on some devices)
+      \param scale integer upscale factor (1 = native resolution, 2 = half resolution, 3 = third resolution etc.)
+      \return _fbg structure pointer to pass to any FBG library functions
+      \sa fbg_fbdevSetup()
+    */
+    extern struct _fbg *fbg_fbdevSetupEx(char *fb_device, int page_flipping, int scale);
+
+    //! set the dithering fused into the 16 bpp (RGB565) conversion of the draw (no effect on other depths)
+    /*!
+      \param fbg pointer to a FBG context / data structure (fbdev backend)
+      \param dither FBG_FBDEV_DITHER_NONE (default), FBG_FBDEV_DITHER_ORDERED or FBG_FBDEV_DITHER_DIFFUSION
+    */
+    extern void fbg_fbdevSetDither(struct _fbg *fbg, int dither);
+
     //! initialize a FB Graphics context with '/dev/fb0' as framebuffer device and no page flipping
     #define fbg_fbdevInit() fbg_fbdevSetup(NULL, 0)
 #endif
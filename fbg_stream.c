@@ -0,0 +1,507 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fbg_stream.h"
+
+void fbg_streamDraw(struct _fbg *fbg);
+void fbg_streamFree(struct _fbg *fbg);
+
+int fbg_streamWrite(int fd, const void *data, size_t length) {
+    const unsigned char *ptr = (const unsigned char *)data;
+
+    while (length > 0) {
+        ssize_t written = write(fd, ptr, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return 0;
+        }
+
+        ptr += written;
+        length -= written;
+    }
+
+    return 1;
+}
+
+int fbg_streamRead(int fd, void *data, size_t length) {
+    unsigned char *ptr = (unsigned char *)data;
+
+    while (length > 0) {
+        ssize_t bytes = read(fd, ptr, length);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return 0;
+        } else if (bytes == 0) {
+            return 0;
+        }
+
+        ptr += bytes;
+        length -= bytes;
+    }
+
+    return 1;
+}
+
+// PackBits-like encoding, return the encoded length (dst must hold length + length / 128 + 1 bytes)
+size_t fbg_streamRLE(unsigned char *dst, const unsigned char *src, size_t length) {
+    unsigned char *out = dst;
+
+    size_t i = 0;
+    while (i < length) {
+        size_t run = 1;
+        while (i + run < length && run < 130 && src[i + run] == src[i]) {
+            run += 1;
+        }
+
+        if (run >= 3) {
+            *out++ = (unsigned char)(run + 125);
+            *out++ = src[i];
+
+            i += run;
+        } else {
+            // literals up to the next run of 3
+            size_t start = i;
+            size_t count = 0;
+
+            while (i < length && count < 128) {
+                if (i + 2 < length && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+                    break;
+                }
+
+                i += 1;
+                count += 1;
+            }
+
+            *out++ = (unsigned char)(count - 1);
+            memcpy(out, src + start, count);
+            out += count;
+        }
+    }
+
+    return out - dst;
+}
+
+// decode RLE data, return 0 if the data is malformed or does not fill dst exactly
+int fbg_streamUnRLE(unsigned char *dst, size_t length, const unsigned char *src, size_t src_length) {
+    size_t i = 0, o = 0;
+
+    while (i < src_length) {
+        unsigned char c = src[i++];
+
+        if (c < 128) {
+            size_t count = c + 1;
+            if (i + count > src_length || o + count > length) {
+                return 0;
+            }
+
+            memcpy(dst + o, src + i, count);
+
+            i += count;
+            o += count;
+        } else {
+            size_t count = c - 125;
+            if (i >= src_length || o + count > length) {
+                return 0;
+            }
+
+            memset(dst + o, src[i++], count);
+
+            o += count;
+        }
+    }
+
+    return o == length;
+}
+
+struct _fbg *fbg_streamSetupFd(int fd, int width, int height, int components) {
+    if (width <= 0 || height <= 0 || (components != 3 && components != 4)) {
+        fprintf(stderr, "fbg_streamSetup: invalid frame format!\n");
+
+        return NULL;
+    }
+
+    struct _fbg_stream_context *stream_context = (struct _fbg_stream_context *)calloc(1, sizeof(struct _fbg_stream_context));
+    if (!stream_context) {
+        fprintf(stderr, "fbg_streamSetup: stream context calloc failed!\n");
+
+        return NULL;
+    }
+
+    stream_context->fd = fd;
+
+    size_t frame_size = (size_t)width * height * components;
+    size_t tile_size = FBG_STREAM_TILE_SIZE * FBG_STREAM_TILE_SIZE * components;
+
+    stream_context->previous = (unsigned char *)calloc(1, frame_size);
+    stream_context->delta = (unsigned char *)malloc(tile_size);
+    if (!stream_context->previous || !stream_context->delta) {
+        fprintf(stderr, "fbg_streamSetup: frame allocation failed!\n");
+
+        free(stream_context->previous);
+        free(stream_context->delta);
+        free(stream_context);
+
+        return NULL;
+    }
+
+    struct _fbg *fbg = fbg_customSetup(width, height, components, 1, 0, (void *)stream_context, fbg_streamDraw, NULL, NULL, fbg_streamFree);
+    if (!fbg) {
+        fprintf(stderr, "fbg_streamSetup: fbg_customSetup failed\n");
+
+        free(stream_context->previous);
+        free(stream_context->delta);
+        free(stream_context);
+
+        return NULL;
+    }
+
+    struct _fbg_stream_header header;
+    memcpy(header.magic, FBG_STREAM_MAGIC, 4);
+    header.version = FBG_STREAM_VERSION;
+    header.components = components;
+    header.width = width;
+    header.height = height;
+    header.tile_size = FBG_STREAM_TILE_SIZE;
+
+    if (!fbg_streamWrite(fd, &header, sizeof(header))) {
+        fprintf(stderr, "fbg_streamSetup: header write failed!\n");
+
+        stream_context->failed = 1;
+    }
+
+    stream_context->bytes = sizeof(header);
+
+    return fbg;
+}
+
+struct _fbg *fbg_streamSetup(char *path, int width, int height, int components) {
+    int fd = -1;
+
+    if (strcmp(path, "-") == 0) {
+        fd = STDOUT_FILENO;
+    } else if (strncmp(path, "unix:", 5) == 0) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        if (strlen(path + 5) >= sizeof(address.sun_path)) {
+            fprintf(stderr, "fbg_streamSetup: socket path '%s' too long!\n", path + 5);
+
+            return NULL;
+        }
+
+        strcpy(address.sun_path, path + 5);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd != -1 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+            close(fd);
+
+            fd = -1;
+        }
+    } else {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (fd == -1) {
+        fprintf(stderr, "fbg_streamSetup: Cannot open '%s'!\n", path);
+
+        return NULL;
+    }
+
+    struct _fbg *fbg = fbg_streamSetupFd(fd, width, height, components);
+    if (!fbg) {
+        if (fd != STDOUT_FILENO) {
+            close(fd);
+        }
+
+        return NULL;
+    }
+
+    struct _fbg_stream_context *stream_context = fbg->user_context;
+    stream_context->owns_fd = (fd != STDOUT_FILENO);
+
+    return fbg;
+}
+
+int fbg_streamReserve(struct _fbg_stream_context *stream_context, size_t length) {
+    if (length <= stream_context->output_capacity) {
+        return 1;
+    }
+
+    size_t capacity = stream_context->output_capacity ? stream_context->output_capacity : 64 * 1024;
+    while (capacity < length) {
+        capacity *= 2;
+    }
+
+    unsigned char *output = (unsigned char *)realloc(stream_context->output, capacity);
+    if (!output) {
+        return 0;
+    }
+
+    stream_context->output = output;
+    stream_context->output_capacity = capacity;
+
+    return 1;
+}
+
+void fbg_streamDraw(struct _fbg *fbg) {
+    struct _fbg_stream_context *stream_context = fbg->user_context;
+
+    if (stream_context->failed) {
+        return;
+    }
+
+    int tile = FBG_STREAM_TILE_SIZE;
+    int tiles_x = (fbg->width + tile - 1) / tile;
+    int tiles_y = (fbg->height + tile - 1) / tile;
+
+    size_t row_size = fbg->width * fbg->components;
+    size_t tile_max = tile * tile * fbg->components;
+
+    struct _fbg_stream_frame frame;
+    memcpy(frame.magic, FBG_STREAM_FRAME_MAGIC, 4);
+    frame.index = stream_context->frames;
+    frame.tiles_count = 0;
+
+    size_t offset = sizeof(frame);
+
+    int tx = 0, ty = 0, y = 0;
+
+    for (ty = 0; ty < tiles_y; ty += 1) {
+        int y0 = ty * tile;
+        int th = _FBG_MIN(tile, fbg->height - y0);
+
+        for (tx = 0; tx < tiles_x; tx += 1) {
+            int x0 = tx * tile;
+            size_t tile_row = _FBG_MIN(tile, fbg->width - x0) * fbg->components;
+
+            // skip unchanged tiles
+            for (y = 0; y < th; y += 1) {
+                const unsigned char *current = fbg->disp_buffer + (y0 + y) * fbg->line_length + x0 * fbg->components;
+                const unsigned char *previous = stream_context->previous + (y0 + y) * row_size + x0 * fbg->components;
+
+                if (memcmp(current, previous, tile_row) != 0) {
+                    break;
+                }
+            }
+
+            if (y == th) {
+                continue;
+            }
+
+            size_t length = 0;
+            for (y = 0; y < th; y += 1) {
+                const unsigned char *current = fbg->disp_buffer + (y0 + y) * fbg->line_length + x0 * fbg->components;
+                unsigned char *previous = stream_context->previous + (y0 + y) * row_size + x0 * fbg->components;
+
+                size_t i = 0;
+                for (i = 0; i < tile_row; i += 1) {
+                    stream_context->delta[length + i] = current[i] ^ previous[i];
+                }
+
+                memcpy(previous, current, tile_row);
+
+                length += tile_row;
+            }
+
+            if (!fbg_streamReserve(stream_context, offset + sizeof(struct _fbg_stream_tile) + tile_max + tile_max / 128 + 1)) {
+                fprintf(stderr, "fbg_streamDraw: output allocation failed!\n");
+
+                stream_context->failed = 1;
+
+                return;
+            }
+
+            struct _fbg_stream_tile tile_header;
+            tile_header.tx = tx;
+            tile_header.ty = ty;
+            tile_header.length = fbg_streamRLE(stream_context->output + offset + sizeof(tile_header), stream_context->delta, length);
+
+            memcpy(stream_context->output + offset, &tile_header, sizeof(tile_header));
+
+            offset += sizeof(tile_header) + tile_header.length;
+
+            frame.tiles_count += 1;
+        }
+    }
+
+    if (!fbg_streamReserve(stream_context, offset)) {
+        stream_context->failed = 1;
+
+        return;
+    }
+
+    frame.length = offset - sizeof(frame);
+    memcpy(stream_context->output, &frame, sizeof(frame));
+
+    if (!fbg_streamWrite(stream_context->fd, stream_context->output, offset)) {
+        fprintf(stderr, "fbg_streamDraw: write failed, stream stopped!\n");
+
+        stream_context->failed = 1;
+
+        return;
+    }
+
+    stream_context->frames += 1;
+    stream_context->bytes += offset;
+}
+
+void fbg_streamFree(struct _fbg *fbg) {
+    struct _fbg_stream_context *stream_context = fbg->user_context;
+
+    if (stream_context->owns_fd) {
+        close(stream_context->fd);
+    }
+
+    free(stream_context->previous);
+    free(stream_context->delta);
+    free(stream_context->output);
+    free(stream_context);
+}
+
+struct _fbg_stream_reader *fbg_streamOpenReader(int fd) {
+    struct _fbg_stream_reader *reader = (struct _fbg_stream_reader *)calloc(1, sizeof(struct _fbg_stream_reader));
+    if (!reader) {
+        fprintf(stderr, "fbg_streamOpenReader: reader calloc failed!\n");
+
+        return NULL;
+    }
+
+    reader->fd = fd;
+
+    struct _fbg_stream_header *header = &reader->header;
+
+    if (!fbg_streamRead(fd, header, sizeof(struct _fbg_stream_header)) ||
+        memcmp(header->magic, FBG_STREAM_MAGIC, 4) != 0 ||
+        header->version != FBG_STREAM_VERSION ||
+        (header->components != 3 && header->components != 4) ||
+        header->width == 0 || header->height == 0 || header->tile_size == 0 ||
+        header->width > 16384 || header->height > 16384 || header->tile_size > 1024) {
+        fprintf(stderr, "fbg_streamOpenReader: invalid stream header!\n");
+
+        free(reader);
+
+        return NULL;
+    }
+
+    reader->frame = (unsigned char *)calloc(1, (size_t)header->width * header->height * header->components);
+    reader->delta = (unsigned char *)malloc((size_t)header->tile_size * header->tile_size * header->components);
+    if (!reader->frame || !reader->delta) {
+        fprintf(stderr, "fbg_streamOpenReader: frame allocation failed!\n");
+
+        free(reader->frame);
+        free(reader->delta);
+        free(reader);
+
+        return NULL;
+    }
+
+    return reader;
+}
+
+int fbg_streamReadFrame(struct _fbg_stream_reader *reader) {
+    struct _fbg_stream_header *header = &reader->header;
+    struct _fbg_stream_frame frame;
+
+    if (!fbg_streamRead(reader->fd, &frame, sizeof(frame))) {
+        return 0;
+    }
+
+    if (memcmp(frame.magic, FBG_STREAM_FRAME_MAGIC, 4) != 0) {
+        fprintf(stderr, "fbg_streamReadFrame: invalid frame header!\n");
+
+        return 0;
+    }
+
+    if (frame.length > reader->data_capacity) {
+        unsigned char *data = (unsigned char *)realloc(reader->data, frame.length);
+        if (!data) {
+            fprintf(stderr, "fbg_streamReadFrame: data realloc failed!\n");
+
+            return 0;
+        }
+
+        reader->data = data;
+        reader->data_capacity = frame.length;
+    }
+
+    if (!fbg_streamRead(reader->fd, reader->data, frame.length)) {
+        return 0;
+    }
+
+    uint32_t tile = header->tile_size;
+    uint32_t tiles_x = (header->width + tile - 1) / tile;
+    uint32_t tiles_y = (header->height + tile - 1) / tile;
+    size_t row_size = header->width * header->components;
+
+    unsigned char *delta = reader->delta;
+
+    size_t offset = 0;
+    uint32_t t = 0, y = 0;
+
+    for (t = 0; t < frame.tiles_count; t += 1) {
+        struct _fbg_stream_tile tile_header;
+
+        if (offset + sizeof(tile_header) > frame.length) {
+            break;
+        }
+
+        memcpy(&tile_header, reader->data + offset, sizeof(tile_header));
+        offset += sizeof(tile_header);
+
+        if (tile_header.tx >= tiles_x || tile_header.ty >= tiles_y || offset + tile_header.length > frame.length) {
+            break;
+        }
+
+        uint32_t x0 = tile_header.tx * tile;
+        uint32_t y0 = tile_header.ty * tile;
+        uint32_t th = _FBG_MIN(tile, header->height - y0);
+        size_t tile_row = _FBG_MIN(tile, header->width - x0) * header->components;
+
+        if (!fbg_streamUnRLE(delta, tile_row * th, reader->data + offset, tile_header.length)) {
+            break;
+        }
+
+        for (y = 0; y < th; y += 1) {
+            unsigned char *dst = reader->frame + (y0 + y) * row_size + x0 * header->components;
+            const unsigned char *src = delta + y * tile_row;
+
+            size_t i = 0;
+            for (i = 0; i < tile_row; i += 1) {
+                dst[i] ^= src[i];
+            }
+        }
+
+        offset += tile_header.length;
+    }
+
+    if (t != frame.tiles_count) {
+        fprintf(stderr, "fbg_streamReadFrame: corrupted frame %u!\n", frame.index);
+
+        return 0;
+    }
+
+    reader->index = frame.index;
+    reader->tiles_count = frame.tiles_count;
+
+    return 1;
+}
+
+void fbg_streamFreeReader(struct _fbg_stream_reader *reader) {
+    free(reader->frame);
+    free(reader->delta);
+    free(reader->data);
+    free(reader);
+}
@@ -0,0 +1,155 @@
+#ifndef FB_GRAPHICS_STREAM_H
+#define FB_GRAPHICS_STREAM_H
+
+    #include <stdint.h>
+    #include "fbgraphics.h"
+
+    //! stream identifier
+    #define FBG_STREAM_MAGIC "FBGS"
+    //! frame identifier
+    #define FBG_STREAM_FRAME_MAGIC "FBGF"
+    //! stream format version
+    #define FBG_STREAM_VERSION 1
+
+    #ifndef FBG_STREAM_TILE_SIZE
+    //! tile width / height in pixels
+    #define FBG_STREAM_TILE_SIZE 32
+    #endif
+
+    //! Stream header data structure (written once at the start of the stream, little-endian)
+    struct _fbg_stream_header {
+        //! FBG_STREAM_MAGIC
+        char magic[4];
+        //! FBG_STREAM_VERSION
+        uint16_t version;
+        //! Pixel components
+        uint16_t components;
+        //! Frame width in pixels
+        uint32_t width;
+        //! Frame height in pixels
+        uint32_t height;
+        //! Tile width / height in pixels
+        uint32_t tile_size;
+    };
+
+    //! Frame header data structure (followed by tiles_count tiles)
+    /*! Each tile is a _fbg_stream_tile followed by its RLE data
+        The tile pixels are XORed with the previous frame (rows packed, clipped at the frame edges) then RLE encoded :
+        a control byte c < 128 is followed by c + 1 literal bytes, c >= 128 is followed by a byte repeated c - 125 times */
+    struct _fbg_stream_frame {
+        //! FBG_STREAM_FRAME_MAGIC
+        char magic[4];
+        //! Frame index
+        uint32_t index;
+        //! Amount of modified tiles
+        uint32_t tiles_count;
+        //! Length of the tiles data in bytes
+        uint32_t length;
+    };
+
+    //! Encoded tile data structure
+    struct _fbg_stream_tile {
+        //! Tile column
+        uint16_t tx;
+        //! Tile row
+        uint16_t ty;
+        //! RLE data length in bytes
+        uint32_t length;
+    };
+
+    //! Stream backend data structure
+    struct _fbg_stream_context {
+        //! Output file descriptor
+        int fd;
+        //! Wether the file descriptor is closed by the backend
+        int owns_fd;
+        //! Flag set once a write failed (the stream is then stopped)
+        int failed;
+
+        //! Last sent frame (packed rows)
+        unsigned char *previous;
+
+        //! XOR delta of the current tile
+        unsigned char *delta;
+
+        //! Encoded frame
+        unsigned char *output;
+        //! Encoded frame allocated length
+        size_t output_capacity;
+
+        //! Sent frames count
+        uint32_t frames;
+        //! Total bytes written
+        uint64_t bytes;
+    };
+
+    //! Stream reader data structure
+    struct _fbg_stream_reader {
+        //! Input file descriptor
+        int fd;
+
+        //! Stream header
+        struct _fbg_stream_header header;
+
+        //! Last decoded frame (packed rows)
+        unsigned char *frame;
+        //! Decoded tile delta (packed rows)
+        unsigned char *delta;
+
+        //! Tiles data of the current frame
+        unsigned char *data;
+        //! Tiles data allocated length
+        size_t data_capacity;
+
+        //! Index of the last decoded frame
+        uint32_t index;
+        //! Amount of tiles modified by the last decoded frame
+        uint32_t tiles_count;
+    };
+
+    //! initialize a FB Graphics context streaming its frames (XOR delta + RLE tiles) to a file descriptor
+    //! note : writing to a closed pipe / socket raise SIGPIPE, ignore it (signal(SIGPIPE, SIG_IGN)) to only stop the stream
+    /*!
+      \param fd output file descriptor (pipe, file, socket etc.), not closed by the backend
+      \param width frame width
+      \param height frame height
+      \param components pixel components (3 = RGB, 4 = RGBA)
+      \return _fbg structure pointer to pass to any FBG library functions
+      \sa fbg_streamSetup()
+    */
+    extern struct _fbg *fbg_streamSetupFd(int fd, int width, int height, int components);
+
+    //! initialize a FB Graphics context streaming its frames to a file, a named pipe, a local socket or the standard output
+    /*!
+      \param path output path ("-" = standard output, "unix:/path" = local stream socket, any other path is created / truncated)
+      \param width frame width
+      \param height frame height
+      \param components pixel components (3 = RGB, 4 = RGBA)
+      \return _fbg structure pointer to pass to any FBG library functions
+      \sa fbg_streamSetupFd()
+    */
+    extern struct _fbg *fbg_streamSetup(char *path, int width, int height, int components);
+
+    //! open a stream for reading (read the stream header)
+    /*!
+      \param fd input file descriptor
+      \return _fbg_stream_reader structure pointer
+      \sa fbg_streamReadFrame(), fbg_streamFreeReader()
+    */
+    extern struct _fbg_stream_reader *fbg_streamOpenReader(int fd);
+
+    //! decode the next frame into reader->frame
+    /*!
+      \param reader _fbg_stream_reader structure pointer
+      \return 1 if a frame was decoded, 0 at the end of the stream or on error
+      \sa fbg_streamOpenReader()
+    */
+    extern int fbg_streamReadFrame(struct _fbg_stream_reader *reader);
+
+    //! free the memory associated with a stream reader (the file descriptor is not closed)
+    /*!
+      \param reader _fbg_stream_reader structure pointer
+      \sa fbg_streamOpenReader()
+    */
+    extern void fbg_streamFreeReader(struct _fbg_stream_reader *reader);
+#endif
@@ -2,9 +2,41 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <limits.h>
+
+#ifndef WITHOUT_PNG
+#include <png.h>
+#endif
+
+#ifndef WITHOUT_JPEG
+#include <jpeglib.h>
+#endif
+
 #include "fbgraphics.h"
 #include "font.h"
 
+#include <stdarg.h>
+
+#ifdef FBG_TRACE
+// record a traced call (outermost calls only, the arguments follow fbg_trace_signatures)
+#define FBG_TRACE_CALL(fbg, op, ...) if ((fbg)->trace && (fbg)->trace->depth == 0) { fbg_traceRecord((fbg), (op), __VA_ARGS__); }
+// record a traced call which use other traced calls
+#define FBG_TRACE_BEGIN(fbg, op, ...) FBG_TRACE_CALL(fbg, op, __VA_ARGS__) if ((fbg)->trace) { (fbg)->trace->depth += 1; }
+#define FBG_TRACE_END(fbg) if ((fbg)->trace) { (fbg)->trace->depth -= 1; }
+
+void fbg_traceRecord(struct _fbg *fbg, int op, ...);
+#else
+#define FBG_TRACE_CALL(fbg, op, ...)
+#define FBG_TRACE_BEGIN(fbg, op, ...)
+#define FBG_TRACE_END(fbg)
+#endif
+
 struct _fbg *fbg_customSetup(
         int width, int height,
         int components,
@@ -33,49 +65,66 @@ struct _fbg *fbg_customSetup(
     fbg->components = components;
     fbg->comp_offset = components - 3;
 
-    fbg->line_length = fbg->width * fbg->components;
+    fbg->line_length = _FBG_ALIGN(fbg->width * fbg->components, FBG_STRIDE_ALIGNMENT);
 
     fbg->width_n_height = fbg->width * fbg->height;
 
-    fbg->size = fbg->width * fbg->height * fbg->components;
+    fbg->size = fbg->line_length * fbg->height;
 
     fbg->user_context = user_context;
 
     if (initialize_buffers) {
-        fbg->back_buffer = calloc(1, fbg->size * sizeof(char));
+        fbg->back_buffer = fbg_alignedAlloc(fbg->size * sizeof(char));
         if (!fbg->back_buffer) {
-            fprintf(stderr, "fbg_customSetup: back_buffer calloc failed!\n");
+            fprintf(stderr, "fbg_customSetup: back_buffer allocation failed!\n");
 
-            user_free(fbg);
+            if (user_free) {
+                user_free(fbg);
+            }
 
             free(fbg);
 
             return NULL;
         }
 
-        fbg->disp_buffer = calloc(1, fbg->size * sizeof(char));
+        fbg->disp_buffer = fbg_alignedAlloc(fbg->size * sizeof(char));
         if (!fbg->disp_buffer) {
-            fprintf(stderr, "fbg_customSetup: disp_buffer calloc failed!\n");
+            fprintf(stderr, "fbg_customSetup: disp_buffer allocation failed!\n");
 
-            user_free(fbg);
+            if (user_free) {
+                user_free(fbg);
+            }
 
             free(fbg->back_buffer);
             free(fbg);
 
             return NULL;
         }
+
+        fbg->buffers[0] = fbg->back_buffer;
+        fbg->buffers[1] = fbg->disp_buffer;
+        fbg->capacities[0] = fbg->size;
+        fbg->capacities[1] = fbg->size;
     }
 
     fbg->initialize_buffers = initialize_buffers;
 
     gettimeofday(&fbg->fps_start, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &fbg->frame_start);
 
     fbg_textColor(fbg, 255, 255, 255);
 
     fbg->allow_resizing = allow_resizing;
 
-    fbg->new_width = 0;
-    fbg->new_height = 0;
+    atomic_init(&fbg->pending_resize, NULL);
+
+#ifdef FBG_TRACE
+    // capture any application without modifying it
+    const char *trace_path = getenv("FBG_TRACE_FILE");
+    if (trace_path) {
+        fbg_traceStart(fbg, trace_path);
+    }
+#endif
 
     return fbg;
 }
@@ -84,7 +133,35 @@ void fbg_setResizeCallback(struct _fbg *fbg, void (*user_resize)(struct _fbg *fb
     fbg->user_resize = user_resize;
 }
 
+int fbg_bufferCapacity(struct _fbg *fbg, const unsigned char *buffer) {
+    int i = 0;
+    for (i = 0; i < 2; i += 1) {
+        if (fbg->buffers[i] == buffer) {
+            return fbg->capacities[i];
+        }
+    }
+
+    return 0;
+}
+
+// replace an internal buffer and record the new buffer allocated length
+void fbg_replaceBuffer(struct _fbg *fbg, unsigned char **buffer, unsigned char *new_buffer, int capacity) {
+    int i = 0;
+    for (i = 0; i < 2; i += 1) {
+        if (fbg->buffers[i] == *buffer) {
+            fbg->buffers[i] = new_buffer;
+            fbg->capacities[i] = capacity;
+
+            break;
+        }
+    }
+
+    *buffer = new_buffer;
+}
+
 void fbg_resize(struct _fbg *fbg, int new_width, int new_height) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_RESIZE, new_width, new_height)
+
     if (fbg->backend_resize) {
         fbg->backend_resize(fbg, new_width, new_height);
     }
@@ -99,39 +176,45 @@ void fbg_resize(struct _fbg *fbg, int new_width, int new_height) {
         void (*user_fragment_stop)(struct _fbg *fbg, void *user_data) = NULL;
 #endif
 
-        int new_size = new_width * new_height * fbg->components;
+        int new_line_length = _FBG_ALIGN(new_width * fbg->components, FBG_STRIDE_ALIGNMENT);
+        int new_size = new_line_length * new_height;
 
         if (fbg->initialize_buffers) {
-            unsigned char *back_buffer = calloc(1, new_size * sizeof(char));
-            if (!back_buffer) {
-                fprintf(stderr, "fbg_resize: back_buffer realloc failed!\n");
+            // buffers are replaced one after the other so that the peak memory usage is a single buffer larger than the current ones,
+            // the capacity of each buffer is recorded as it is replaced so that a failure leave consistent capacities
+            if (new_size > fbg_bufferCapacity(fbg, fbg->back_buffer)) {
+                unsigned char *back_buffer = fbg_alignedAlloc(new_size * sizeof(char));
+                if (!back_buffer) {
+                    fprintf(stderr, "fbg_resize: back_buffer allocation failed!\n");
+
+                    return;
+                }
 
-                return;
+                free(fbg->back_buffer);
+                fbg_replaceBuffer(fbg, &fbg->back_buffer, back_buffer, new_size);
             }
 
-            unsigned char *disp_buffer = calloc(1, new_size * sizeof(char));
-            if (!disp_buffer) {
-                fprintf(stderr, "fbg_resize: disp_buffer realloc failed!\n");
+            if (new_size > fbg_bufferCapacity(fbg, fbg->disp_buffer)) {
+                unsigned char *disp_buffer = fbg_alignedAlloc(new_size * sizeof(char));
+                if (!disp_buffer) {
+                    fprintf(stderr, "fbg_resize: disp_buffer allocation failed!\n");
 
-                free(back_buffer);
+                    return;
+                }
 
-                return;
+                free(fbg->disp_buffer);
+                fbg_replaceBuffer(fbg, &fbg->disp_buffer, disp_buffer, new_size);
             }
 
-            unsigned char *old_back_buffer = fbg->back_buffer;
-            unsigned char *old_disp_buffer = fbg->disp_buffer;
-
-            fbg->back_buffer = back_buffer;
-            fbg->disp_buffer = disp_buffer;
-
-            free(old_back_buffer);
-            free(old_disp_buffer);
+            // the buffers capacity is reused when shrinking
+            memset(fbg->back_buffer, 0, new_size * sizeof(char));
+            memset(fbg->disp_buffer, 0, new_size * sizeof(char));
         }
 
         fbg->width = new_width;
         fbg->height = new_height;
 
-        fbg->line_length = fbg->width * fbg->components;
+        fbg->line_length = new_line_length;
 
         fbg->width_n_height = fbg->width * fbg->height;
 
@@ -148,14 +231,293 @@ void fbg_resize(struct _fbg *fbg, int new_width, int new_height) {
     }
 }
 
+void fbg_freeResize(struct _fbg_resize *resize) {
+    free(resize->back_buffer);
+    free(resize->disp_buffer);
+    free(resize);
+}
+
 void fbg_pushResize(struct _fbg *fbg, int new_width, int new_height) {
-    if (new_width > 0 && new_height > 0) {
-        fbg->new_width = new_width;
-        fbg->new_height = new_height;
+    if (new_width <= 0 || new_height <= 0) {
+        return;
+    }
+
+    struct _fbg_resize *resize = (struct _fbg_resize *)calloc(1, sizeof(struct _fbg_resize));
+    if (!resize) {
+        fprintf(stderr, "fbg_pushResize: resize calloc failed!\n");
+
+        return;
+    }
+
+    resize->width = new_width;
+    resize->height = new_height;
+    resize->line_length = _FBG_ALIGN(new_width * fbg->components, FBG_STRIDE_ALIGNMENT);
+    resize->size = resize->line_length * new_height;
+
+    // allocate here so that the render thread does not stall on it
+    if (fbg->initialize_buffers && fbg->allow_resizing) {
+        resize->back_buffer = fbg_alignedAlloc(resize->size * sizeof(char));
+        resize->disp_buffer = fbg_alignedAlloc(resize->size * sizeof(char));
+
+        if (!resize->back_buffer || !resize->disp_buffer) {
+            fprintf(stderr, "fbg_pushResize: buffers allocation failed!\n");
+
+            fbg_freeResize(resize);
+
+            return;
+        }
+    }
+
+    // a pending event which was not taken yet is superseded
+    struct _fbg_resize *superseded = atomic_exchange_explicit(&fbg->pending_resize, resize, memory_order_acq_rel);
+    if (superseded) {
+        fbg_freeResize(superseded);
+    }
+}
+
+void fbg_retireBuffers(struct _fbg *fbg) {
+    free(fbg->retired_buffers[0]);
+    free(fbg->retired_buffers[1]);
+
+    fbg->retired_buffers[0] = NULL;
+    fbg->retired_buffers[1] = NULL;
+}
+
+void fbg_commitResize(struct _fbg *fbg, struct _fbg_resize *resize) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_RESIZE, resize->width, resize->height)
+
+    if (fbg->backend_resize) {
+        fbg->backend_resize(fbg, resize->width, resize->height);
+    }
+
+    if (fbg->allow_resizing) {
+        if (resize->back_buffer) {
+            // the presenter may still reference the current buffers
+            fbg_retireBuffers(fbg);
+
+            fbg->retired_buffers[0] = fbg->back_buffer;
+            fbg->retired_buffers[1] = fbg->disp_buffer;
+
+            fbg_replaceBuffer(fbg, &fbg->back_buffer, resize->back_buffer, resize->size);
+            fbg_replaceBuffer(fbg, &fbg->disp_buffer, resize->disp_buffer, resize->size);
+
+            resize->back_buffer = NULL;
+            resize->disp_buffer = NULL;
+        }
+
+        fbg->width = resize->width;
+        fbg->height = resize->height;
+
+        fbg->line_length = resize->line_length;
+
+        fbg->width_n_height = fbg->width * fbg->height;
+
+        fbg->size = resize->size;
+    }
+
+    if (fbg->user_resize) {
+        fbg->user_resize(fbg, resize->width, resize->height);
+    }
+}
+
+#ifndef WITHOUT_THREADS
+// take the next band of a participant range, return -1 when the range is exhausted
+int fbg_poolTake(struct _fbg_pool_range *range) {
+    if (atomic_load_explicit(&range->next, memory_order_relaxed) >= range->end) {
+        return -1;
+    }
+
+    int band = atomic_fetch_add_explicit(&range->next, 1, memory_order_relaxed);
+
+    return band < range->end ? band : -1;
+}
+
+void fbg_poolWork(struct _fbg_pool *pool, int participant) {
+    int participants = pool->threads_count + 1;
+
+    struct _fbg_pool_range *own = &pool->ranges[participant];
+
+    int band = 0;
+    int i = 0;
+
+    // own bands first then steal from the others (starting with the next participant)
+    for (i = 0; i < participants; i += 1) {
+        struct _fbg_pool_range *range = (i == 0) ? own : &pool->ranges[(participant + i) % participants];
+
+        while ((band = fbg_poolTake(range)) >= 0) {
+            int y_start = band * pool->band_height;
+            int y_end = _FBG_MIN(y_start + pool->band_height, pool->job_height);
+
+            pool->job(pool->fbg, y_start, y_end, pool->job_data);
+        }
+    }
+}
+
+void *fbg_poolThread(void *user_data) {
+    struct _fbg_pool_worker *worker = (struct _fbg_pool_worker *)user_data;
+    struct _fbg_pool *pool = worker->pool;
+
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;) {
+        while (pool->generation == generation && !pool->stop) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+
+        if (pool->stop) {
+            break;
+        }
+
+        generation = pool->generation;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        fbg_poolWork(pool, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+
+        pool->pending -= 1;
+        if (pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+void fbg_freePool(struct _fbg_pool *pool) {
+    int i = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->threads_count; i += 1) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->ranges);
+    free(pool->workers);
+    free(pool);
+}
+
+struct _fbg_pool *fbg_createPool(int threads_count) {
+    struct _fbg_pool *pool = (struct _fbg_pool *)calloc(1, sizeof(struct _fbg_pool));
+    if (!pool) {
+        fprintf(stderr, "fbg_createPool: pool calloc failed!\n");
+
+        return NULL;
+    }
+
+    pool->workers = (struct _fbg_pool_worker *)calloc(threads_count, sizeof(struct _fbg_pool_worker));
+    // one more range for the calling thread
+    pool->ranges = (struct _fbg_pool_range *)fbg_alignedAlloc((threads_count + 1) * sizeof(struct _fbg_pool_range));
+    if (!pool->workers || !pool->ranges) {
+        fprintf(stderr, "fbg_createPool: workers allocation failed!\n");
+
+        free(pool->workers);
+        free(pool->ranges);
+        free(pool);
+
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    int i = 0;
+    for (i = 0; i < threads_count; i += 1) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+
+        if (pthread_create(&pool->workers[i].thread, NULL, fbg_poolThread, &pool->workers[i]) != 0) {
+            fprintf(stderr, "fbg_createPool: pthread_create failed (%d threads started)!\n", i);
+
+            break;
+        }
+
+        pool->threads_count += 1;
+    }
+
+    return pool;
+}
+#endif
+
+void fbg_setThreads(struct _fbg *fbg, int threads) {
+#ifndef WITHOUT_THREADS
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (fbg->pool) {
+        fbg_freePool(fbg->pool);
+        fbg->pool = NULL;
+    }
+
+    // the calling thread take part in the work
+    if (threads > 1) {
+        fbg->pool = fbg_createPool(threads - 1);
+    }
+#endif
+}
+
+void fbg_parallelRows(struct _fbg *fbg, void (*job)(struct _fbg *fbg, int y_start, int y_end, void *user_data), void *user_data) {
+#ifndef WITHOUT_THREADS
+    struct _fbg_pool *pool = fbg->pool;
+
+    if (pool && pool->threads_count > 0 && fbg->line_length * fbg->height >= FBG_PARALLEL_THRESHOLD) {
+        int participants = pool->threads_count + 1;
+
+        // a few bands per participant so that stealing can balance uneven cores
+        int band_height = _FBG_MAX(fbg->height / (participants * 4), 8);
+        int bands = (fbg->height + band_height - 1) / band_height;
+
+        pool->fbg = fbg;
+        pool->job = job;
+        pool->job_data = user_data;
+        pool->job_height = fbg->height;
+        pool->band_height = band_height;
+
+        int i = 0;
+        for (i = 0; i < participants; i += 1) {
+            atomic_store_explicit(&pool->ranges[i].next, bands * i / participants, memory_order_relaxed);
+            pool->ranges[i].end = bands * (i + 1) / participants;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->pending = pool->threads_count;
+        pool->generation += 1;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+
+        fbg_poolWork(pool, pool->threads_count);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        return;
     }
+#endif
+
+    job(fbg, 0, fbg->height, user_data);
 }
 
 void fbg_close(struct _fbg *fbg) {
+    fbg_traceStop(fbg);
+
     if (fbg->user_free) {
         fbg->user_free(fbg);
     }
@@ -165,9 +527,183 @@ void fbg_close(struct _fbg *fbg) {
         free(fbg->disp_buffer);
     }
 
+    if (fbg->scratch_arena) {
+        fbg_freeArena(fbg->scratch_arena);
+    }
+
+    struct _fbg_resize *resize = atomic_exchange(&fbg->pending_resize, NULL);
+    if (resize) {
+        fbg_freeResize(resize);
+    }
+
+    fbg_retireBuffers(fbg);
+
+#ifndef WITHOUT_THREADS
+    if (fbg->pool) {
+        fbg_freePool(fbg->pool);
+    }
+#endif
+
     free(fbg);
 }
 
+void *fbg_alignedAlloc(size_t size) {
+    // aligned_alloc require the size to be a multiple of the alignment
+    size_t aligned_size = _FBG_ALIGN(_FBG_MAX(size, 1), FBG_BUFFER_ALIGNMENT);
+
+    void *ptr = aligned_alloc(FBG_BUFFER_ALIGNMENT, aligned_size);
+    if (!ptr) {
+        return NULL;
+    }
+
+    memset(ptr, 0, aligned_size);
+
+    return ptr;
+}
+
+struct _fbg_arena_block *fbg_createArenaBlock(size_t size) {
+    struct _fbg_arena_block *block = (struct _fbg_arena_block *)malloc(sizeof(struct _fbg_arena_block) + size);
+    if (!block) {
+        fprintf(stderr, "fbg_createArenaBlock (%lu): malloc failed!\n", (long unsigned int)size);
+
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->offset = 0;
+
+    return block;
+}
+
+struct _fbg_arena *fbg_createArena(size_t block_size) {
+    struct _fbg_arena *arena = (struct _fbg_arena *)calloc(1, sizeof(struct _fbg_arena));
+    if (!arena) {
+        fprintf(stderr, "fbg_createArena: calloc failed!\n");
+
+        return NULL;
+    }
+
+    arena->block_size = block_size ? block_size : FBG_ARENA_BLOCK_SIZE;
+
+    arena->first = fbg_createArenaBlock(arena->block_size);
+    if (!arena->first) {
+        free(arena);
+
+        return NULL;
+    }
+
+    arena->current = arena->first;
+
+    return arena;
+}
+
+void *fbg_arenaAlloc(struct _fbg_arena *arena, size_t size) {
+    return fbg_arenaAllocAligned(arena, size, FBG_ARENA_ALIGNMENT);
+}
+
+void *fbg_arenaAllocAligned(struct _fbg_arena *arena, size_t size, size_t alignment) {
+    struct _fbg_arena_block *block = arena->current;
+    if (!block) {
+        block = fbg_createArenaBlock(_FBG_MAX(size + alignment, arena->block_size));
+        if (!block) {
+            return NULL;
+        }
+
+        arena->first = block;
+        arena->current = block;
+    }
+
+    uintptr_t base = (uintptr_t)block->data;
+    size_t offset = _FBG_ALIGN(base + block->offset, alignment) - base;
+
+    while (offset + size > block->size) {
+        if (!block->next) {
+            block->next = fbg_createArenaBlock(_FBG_MAX(size + alignment, arena->block_size));
+            if (!block->next) {
+                return NULL;
+            }
+        }
+
+        block = block->next;
+
+        base = (uintptr_t)block->data;
+        offset = _FBG_ALIGN(base, alignment) - base;
+
+        arena->current = block;
+    }
+
+    void *ptr = block->data + offset;
+
+    block->offset = offset + size;
+
+    arena->used += size;
+    arena->peak = _FBG_MAX(arena->peak, arena->used);
+
+    memset(ptr, 0, size);
+
+    return ptr;
+}
+
+void fbg_arenaReset(struct _fbg_arena *arena) {
+    struct _fbg_arena_block *block = arena->first;
+
+    if (block && block->next) {
+        // merge the chain into a single block large enough for the whole chain
+        size_t size = 0;
+
+        while (block) {
+            struct _fbg_arena_block *next = block->next;
+
+            size += block->size;
+
+            free(block);
+
+            block = next;
+        }
+
+        arena->first = fbg_createArenaBlock(size);
+        if (!arena->first) {
+            // fallback to a default block, this may fail as well and will then be retried upon the next allocation
+            arena->first = fbg_createArenaBlock(arena->block_size);
+        }
+    } else if (block) {
+        block->offset = 0;
+    }
+
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+void fbg_freeArena(struct _fbg_arena *arena) {
+    struct _fbg_arena_block *block = arena->first;
+
+    while (block) {
+        struct _fbg_arena_block *next = block->next;
+
+        free(block);
+
+        block = next;
+    }
+
+    free(arena);
+}
+
+void fbg_setAssetsArena(struct _fbg *fbg, struct _fbg_arena *arena) {
+    fbg->assets_arena = arena;
+}
+
+void *fbg_scratchAlloc(struct _fbg *fbg, size_t size) {
+    if (!fbg->scratch_arena) {
+        fbg->scratch_arena = fbg_createArena(0);
+        if (!fbg->scratch_arena) {
+            return NULL;
+        }
+    }
+
+    return fbg_arenaAlloc(fbg->scratch_arena, size);
+}
+
 void fbg_computeFramerate(struct _fbg *fbg, int to_string) {
     gettimeofday(&fbg->fps_stop, NULL);
 
@@ -200,12 +736,16 @@ int fbg_getFramerate(struct _fbg *fbg, int task) {
 }
 
 void fbg_fill(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FILL, r, g, b)
+
     fbg->fill_color.r = r;
     fbg->fill_color.g = g;
     fbg->fill_color.b = b;
 }
 
 void fbg_pixel(struct _fbg *fbg, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_PIXEL, x, y, r, g, b)
+
     char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
     *pix_pointer++ = r;
@@ -215,6 +755,8 @@ void fbg_pixel(struct _fbg *fbg, int x, int y, unsigned char r, unsigned char g,
 }
 
 void fbg_pixela(struct _fbg *fbg, int x, int y, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_PIXELA, x, y, r, g, b, a)
+
     char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
     *pix_pointer = ((a * r + (255 - a) * (*pix_pointer)) >> 8);
@@ -227,16 +769,22 @@ void fbg_pixela(struct _fbg *fbg, int x, int y, unsigned char r, unsigned char g
 }
 
 void fbg_fpixel(struct _fbg *fbg, int x, int y) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FPIXEL, x, y)
+
     char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length));
 
     memcpy(pix_pointer, &fbg->fill_color, fbg->components);
 }
 
 void fbg_plot(struct _fbg *fbg, int index, unsigned char value) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_plot")
+
     fbg->back_buffer[index] = value;
 }
 
 void fbg_hline(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_HLINE, x, y, w, r, g, b)
+
     int xx;
 
     char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
@@ -249,25 +797,114 @@ void fbg_hline(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned
     }
 }
 
-void fbg_vline(struct _fbg *fbg, int x, int y, int h, unsigned char r, unsigned char g, unsigned char b) {
-    int yy;
+void fbg_span(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_SPAN, x, y, w, r, g, b)
 
-    char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
+    if (y < 0 || y >= fbg->height) {
+        return;
+    }
 
-    for (yy = 0; yy < h; yy += 1) {
-        *pix_pointer++ = r;
-        *pix_pointer++ = g;
-        *pix_pointer++ = b;
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
 
-        pix_pointer += fbg->line_length - 3;
+    w = _FBG_MIN(w, fbg->width - x);
+    if (w <= 0) {
+        return;
     }
-}
 
-// source : http://www.brackeen.com/vga/shapes.html
-void fbg_line(struct _fbg *fbg, int x1, int y1, int x2, int y2, unsigned char r, unsigned char g, unsigned char b) {
-    int i, dx, dy, sdx, sdy, dxabs, dyabs, x, y, px, py;
+    unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
-    dx = x2 - x1;
+    int xx;
+
+    if (fbg->components == 4) {
+        // single 32 bits store per pixel
+        unsigned char pixel[4] = { r, g, b, 0 };
+        uint32_t value;
+        memcpy(&value, pixel, 4);
+
+        for (xx = 0; xx < w; xx += 1) {
+            memcpy(pix_pointer, &value, 4);
+            pix_pointer += 4;
+        }
+    } else {
+        for (xx = 0; xx < w; xx += 1) {
+            *pix_pointer++ = r;
+            *pix_pointer++ = g;
+            *pix_pointer++ = b;
+            pix_pointer += fbg->comp_offset;
+        }
+    }
+}
+
+void fbg_spanaBlend(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    if (a == 255) {
+        fbg_span(fbg, x, y, w, r, g, b);
+
+        return;
+    }
+
+    if (y < 0 || y >= fbg->height) {
+        return;
+    }
+
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+
+    w = _FBG_MIN(w, fbg->width - x);
+    if (w <= 0) {
+        return;
+    }
+
+    unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
+
+    // same blend as fbg_recta
+    int ar = a * r, ag = a * g, ab = a * b, ia = 255 - a;
+
+    int xx;
+    for (xx = 0; xx < w; xx += 1) {
+        pix_pointer[0] = (ar + ia * pix_pointer[0]) >> 8;
+        pix_pointer[1] = (ag + ia * pix_pointer[1]) >> 8;
+        pix_pointer[2] = (ab + ia * pix_pointer[2]) >> 8;
+
+        pix_pointer += fbg->components;
+    }
+}
+
+void fbg_spana(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    FBG_TRACE_BEGIN(fbg, FBG_TRACE_SPANA, x, y, w, r, g, b, a)
+
+    fbg_spanaBlend(fbg, x, y, w, r, g, b, a);
+
+    FBG_TRACE_END(fbg)
+}
+
+void fbg_vline(struct _fbg *fbg, int x, int y, int h, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_VLINE, x, y, h, r, g, b)
+
+    int yy;
+
+    char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
+
+    for (yy = 0; yy < h; yy += 1) {
+        *pix_pointer++ = r;
+        *pix_pointer++ = g;
+        *pix_pointer++ = b;
+
+        pix_pointer += fbg->line_length - 3;
+    }
+}
+
+// source : http://www.brackeen.com/vga/shapes.html
+void fbg_line(struct _fbg *fbg, int x1, int y1, int x2, int y2, unsigned char r, unsigned char g, unsigned char b) {
+    int i, dx, dy, sdx, sdy, dxabs, dyabs, x, y, px, py;
+
+    FBG_TRACE_BEGIN(fbg, FBG_TRACE_LINE, x1, y1, x2, y2, r, g, b)
+
+    dx = x2 - x1;
     dy = y2 - y1;
     dxabs = abs(dx);
     dyabs = abs(dy);
@@ -310,11 +947,15 @@ void fbg_line(struct _fbg *fbg, int x1, int y1, int x2, int y2, unsigned char r,
             fbg_pixel(fbg, px, py, r, g, b);
         }
     }
+
+    FBG_TRACE_END(fbg)
 }
 
 void fbg_polygon(struct _fbg *fbg, int num_vertices, int *vertices, unsigned char r, unsigned char g, unsigned char b) {
     int i;
 
+    FBG_TRACE_BEGIN(fbg, FBG_TRACE_POLYGON, num_vertices, vertices, r, g, b)
+
     for (i = 0; i < num_vertices - 1; i += 1) {
         fbg_line(fbg, vertices[(i << 1) + 0],
             vertices[(i << 1) + 1],
@@ -328,12 +969,16 @@ void fbg_polygon(struct _fbg *fbg, int num_vertices, int *vertices, unsigned cha
          vertices[(num_vertices << 1) - 2],
          vertices[(num_vertices << 1) - 1],
          r, g, b);
+
+    FBG_TRACE_END(fbg)
 }
 
 void fbg_recta(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_RECTA, x, y, w, h, r, g, b, a)
+
     int xx = 0, yy = 0, w3 = w * fbg->components;
 
-    char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
+    unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
     for (yy = 0; yy < h; yy += 1) {
         for (xx = 0; xx < w; xx += 1) {
@@ -351,6 +996,8 @@ void fbg_recta(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, un
 }
 
 void fbg_rect(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_RECT, x, y, w, h, r, g, b)
+
     int xx = 0, yy = 0, w3 = w * fbg->components;
 
     char *pix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
@@ -368,6 +1015,8 @@ void fbg_rect(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, uns
 }
 
 void fbg_frect(struct _fbg *fbg, int x, int y, int w, int h) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FRECT, x, y, w, h)
+
     int xx, yy, w3 = w * fbg->components;
 
     char *fpix_pointer = (char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
@@ -389,351 +1038,4048 @@ void fbg_frect(struct _fbg *fbg, int x, int y, int w, int h) {
     }
 }
 
-void fbg_getPixel(struct _fbg *fbg, int x, int y, struct _fbg_rgb *color) {
-    int ofs = y * fbg->line_length + x * fbg->components;
+// half widths of the rows [0, ry] of an ellipse centered on row 0 (midpoint algorithms, the circle only compute one octant)
+void fbg_ellipseHalfWidths(int *half, int rx, int ry) {
+    if (rx == ry) {
+        int x = rx, y = 0, err = 1 - rx;
 
-    memcpy(color, (char *)(fbg->back_buffer + ofs), fbg->components);
-}
+        while (x >= y) {
+            // octant symmetry : (x, y) and (y, x)
+            half[y] = _FBG_MAX(half[y], x);
+            half[x] = _FBG_MAX(half[x], y);
 
+            y += 1;
 
-void fbg_draw(struct _fbg *fbg) {
-    if (fbg->user_draw) {
-        fbg->user_draw(fbg);
+            if (err < 0) {
+                err += 2 * y + 1;
+            } else {
+                x -= 1;
+                err += 2 * (y - x) + 1;
+            }
+        }
+
+        return;
     }
 
-    // resize the context (registered) by fbg_pushResize if needed
-    // note : we process the resize event here to be sure that a single resize is processed in the main thread, avoiding potential issues with fragments / caller thread
-    if (fbg->new_width > 0 && fbg->new_height > 0) {
-        fbg_resize(fbg, fbg->new_width, fbg->new_height);
+    if (ry == 0) {
+        half[0] = rx;
 
-        fbg->new_width = 0;
-        fbg->new_height = 0;
+        return;
     }
-}
 
-void fbg_flip(struct _fbg *fbg) {
-    if (fbg->user_flip) {
-        fbg->user_flip(fbg);
-    } else {
-        unsigned char *tmp_buffer = fbg->disp_buffer;
-        fbg->disp_buffer = fbg->back_buffer;
-        fbg->back_buffer = tmp_buffer;
-    }
+    if (rx == 0) {
+        memset(half, 0, (ry + 1) * sizeof(int));
 
-    fbg_computeFramerate(fbg, 1);
-}
+        return;
+    }
 
-void fbg_clear(struct _fbg *fbg, unsigned char color) {
-    memset(fbg->back_buffer, color, fbg->size);
-}
+    int64_t rx2 = (int64_t)rx * rx, ry2 = (int64_t)ry * ry;
+    int64_t x = 0, y = ry;
+    int64_t px = 0, py = 2 * rx2 * y;
 
-void fbg_fadeDown(struct _fbg *fbg, unsigned char rgb_fade_amount) {
-    int i = 0;
+    // region 1 (slope above -1), x step every iteration
+    int64_t p = ry2 - rx2 * ry + rx2 / 4;
+    while (px < py) {
+        half[y] = x;
 
-    char *pix_pointer = (char *)(fbg->back_buffer);
+        x += 1;
+        px += 2 * ry2;
 
-    for (i = 0; i < fbg->width_n_height; i += 1) {
-        *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
-        pix_pointer++;
-        *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
-        pix_pointer++;
-        *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
-        pix_pointer++;
-        pix_pointer += fbg->comp_offset;
+        if (p < 0) {
+            p += ry2 + px;
+        } else {
+            y -= 1;
+            py -= 2 * rx2;
+            p += ry2 + px - py;
+        }
     }
-}
 
-void fbg_fadeUp(struct _fbg *fbg, unsigned char rgb_fade_amount) {
-    int i = 0;
+    // region 2, y step every iteration
+    p = ry2 * (2 * x + 1) * (2 * x + 1) / 4 + rx2 * (y - 1) * (y - 1) - rx2 * ry2;
+    while (y >= 0) {
+        half[y] = _FBG_MAX(half[y], x);
 
-    char *pix_pointer = (char *)(fbg->back_buffer);
+        y -= 1;
+        py -= 2 * rx2;
 
-    for (i = 0; i < fbg->width_n_height; i += 1) {
-        *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
-        pix_pointer++;
-        *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
-        pix_pointer++;
-        *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
-        pix_pointer++;
-        pix_pointer += fbg->comp_offset;
+        if (p > 0) {
+            p += rx2 - py;
+        } else {
+            x += 1;
+            px += 2 * ry2;
+            p += rx2 - py + px;
+        }
     }
+    // very flat ellipses leave region 2 before reaching the end of the axis
+    half[0] = rx;
 }
 
-void fbg_background(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b) {
-    int i = 0;
-
-    char *pix_pointer = (char *)(fbg->back_buffer);
+// emit the rows of a shape symmetric around its vertical axis, insets[i] is the amount of pixels left out on each side of the row y + i
+// outlines only emit the pixels having an outside 4-neighbour (left and right runs never overlap so alpha blending stay uniform)
+void fbg_shapeRows(struct _fbg *fbg, int x, int y, int w, int h, const int *insets, int outline, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    int i_start = _FBG_MAX(0, -y);
+    int i_end = _FBG_MIN(h, fbg->height - y);
 
-    for (i = 0; i < fbg->width_n_height; i += 1) {
-        *pix_pointer = r;
-        pix_pointer++;
-        *pix_pointer = g;
-        pix_pointer++;
-        *pix_pointer = b;
-        pix_pointer++;
-        pix_pointer += fbg->comp_offset;
-    }
-}
-
-float fbg_hue2rgb(float v1, float v2, float vH) {
-    if (vH < 0)
-        vH += 1;
+    int i;
+    for (i = i_start; i < i_end; i += 1) {
+        int s = insets[i];
 
-    if (vH > 1)
-        vH -= 1;
+        if (!outline) {
+            fbg_spana(fbg, x + s, y + i, w - 2 * s, r, g, b, a);
 
-    if ((6 * vH) < 1)
-        return (v1 + (v2 - v1) * 6 * vH);
+            continue;
+        }
 
-    if ((2 * vH) < 1)
-        return v2;
+        int above = (i > 0) ? insets[i - 1] : w;
+        int below = (i < h - 1) ? insets[i + 1] : w;
 
-    if ((3 * vH) < 2)
-        return (v1 + (v2 - v1) * ((2.0f / 3) - vH) * 6);
+        // last column of the left run
+        int e = _FBG_MAX(s, _FBG_MAX(above, below) - 1);
 
-    return v1;
+        if (e >= w - 2 - e) {
+            fbg_spana(fbg, x + s, y + i, w - 2 * s, r, g, b, a);
+        } else {
+            fbg_spana(fbg, x + s, y + i, e - s + 1, r, g, b, a);
+            fbg_spana(fbg, x + w - 1 - e, y + i, e - s + 1, r, g, b, a);
+        }
+    }
 }
 
-void fbg_hslToRGB(struct _fbg_rgb *color, float h, float s, float l) {
-    if (s == 0) {
-        color->r = color->g = color->b = (unsigned char)(l * 255);
-    } else {
-        float v1, v2;
-        float hue = (float)h / 360;
-
-        v2 = (l < 0.5) ? (l * (1 + s)) : ((l + s) - (l * s));
-        v1 = 2 * l - v2;
-
-        color->r = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue + (1.0f / 3)));
-        color->g = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue));
-        color->b = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue - (1.0f / 3)));
+void fbg_ellipseShape(struct _fbg *fbg, int x, int y, int rx, int ry, int outline, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    // fully out of the display
+    if (rx < 0 || ry < 0 || x + rx < 0 || y + ry < 0 || x - rx >= fbg->width || y - ry >= fbg->height) {
+        return;
     }
-}
 
-void fbg_rgbToHsl(struct _fbg_hsl *color, float r, float g, float b) {
-    r /= 255.0f, g /= 255.0f, b /= 255.0f;
-    int max = fmaxf(fmaxf(r, g), b), min = fminf(fminf(r, g), b);
-    float h = 0, s, l = (max + min) / 2.0f;
+    FBG_TRACE_BEGIN(fbg, FBG_TRACE_ELLIPSE, x, y, rx, ry, outline, r, g, b, a)
 
-    int ri = r, gi = g, bi = b;
+    int h = 2 * ry + 1;
 
-    if (max == min){
-        h = s = 0; // achromatic
-    } else {
-        float d = max - min;
-        s = l > 0.5f ? d / (2.0f - max - min) : d / (max + min);
+    int *half = (int *)fbg_scratchAlloc(fbg, (ry + 1) * sizeof(int));
+    int *insets = (int *)fbg_scratchAlloc(fbg, h * sizeof(int));
+    if (!half || !insets) {
+        FBG_TRACE_END(fbg)
 
-        if (max == ri)
-            h = (g - b) / d + (g < b ? 6.0f : 0);
-        else if (max == gi)
-            h = (b - r) / d + 2.0f;
-        else if (max == bi)
-            h = (r - g) / d + 4.0f;
+        return;
+    }
 
-        h /= 6.0f;
+    fbg_ellipseHalfWidths(half, rx, ry);
+
+    int i;
+    for (i = 0; i < h; i += 1) {
+        insets[i] = rx - half[abs(ry - i)];
     }
 
-    color->h = h;
-    color->s = s;
-    color->l = l;
+    fbg_shapeRows(fbg, x - rx, y - ry, 2 * rx + 1, h, insets, outline, r, g, b, a);
+
+    FBG_TRACE_END(fbg)
 }
 
-struct _fbg_font *fbg_createFont(struct _fbg *fbg, struct _fbg_img *img, int glyph_width, int glyph_height, unsigned char first_char) {
-    struct _fbg_font *fnt = (struct _fbg_font *)calloc(1, sizeof(struct _fbg_font));
-    if (!fnt) {
-        fprintf(stderr, "fbg_createFont : calloc failed!\n");
+void fbg_roundRectShape(struct _fbg *fbg, int x, int y, int w, int h, int radius, int outline, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    if (w <= 0 || h <= 0 || x + w <= 0 || y + h <= 0 || x >= fbg->width || y >= fbg->height) {
+        return;
     }
 
-    int glyph_count = (img->width / glyph_width) * (img->height / glyph_height);
+    FBG_TRACE_BEGIN(fbg, FBG_TRACE_ROUND_RECT, x, y, w, h, radius, outline, r, g, b, a)
 
-    fnt->glyph_coord_x = calloc(1, glyph_count * sizeof(int));
-    if (!fnt->glyph_coord_x) {
-        fprintf(stderr, "fbg_createFont (%ix%i '%c'): glyph_coord_x calloc failed!\n", glyph_width, glyph_height, first_char);
+    radius = _FBG_MAX(_FBG_MIN(radius, _FBG_MIN((w - 1) / 2, (h - 1) / 2)), 0);
 
-        free(fnt);
+    int *half = (int *)fbg_scratchAlloc(fbg, (radius + 1) * sizeof(int));
+    int *insets = (int *)fbg_scratchAlloc(fbg, h * sizeof(int));
+    if (!half || !insets) {
+        FBG_TRACE_END(fbg)
 
-        return NULL;
+        return;
     }
 
-    fnt->glyph_coord_y = calloc(1, glyph_count * sizeof(int));
-    if (!fnt->glyph_coord_y) {
-        fprintf(stderr, "fbg_createFont (%ix%i '%c'): glyph_coord_y calloc failed!\n", glyph_width, glyph_height, first_char);
+    fbg_ellipseHalfWidths(half, radius, radius);
 
-        free(fnt->glyph_coord_x);
-        free(fnt);
+    // corners are the quadrants of a circle, the rows between them are full
+    int i;
+    for (i = 0; i < h; i += 1) {
+        int dy = _FBG_MAX(radius - i, i - (h - 1 - radius));
 
-        return NULL;
+        insets[i] = (dy > 0) ? radius - half[dy] : 0;
     }
 
-    fnt->glyph_width = glyph_width;
-    fnt->glyph_height = glyph_height;
-    fnt->first_char = first_char;
+    fbg_shapeRows(fbg, x, y, w, h, insets, outline, r, g, b, a);
 
-    int i = 0;
+    FBG_TRACE_END(fbg)
+}
 
-    for (i = 0; i < glyph_count; i += 1) {
-        int gcoord = i * glyph_width;
-        int gcoordx = gcoord % img->width;
-        int gcoordy = (gcoord / img->width) * glyph_height;
+void fbg_circle(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_ellipseShape(fbg, x, y, radius, radius, 1, r, g, b, 255);
+}
 
-        fnt->glyph_coord_x[i] = gcoordx;
-        fnt->glyph_coord_y[i] = gcoordy;
-    }
+void fbg_circlea(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_ellipseShape(fbg, x, y, radius, radius, 1, r, g, b, a);
+}
 
-    fnt->bitmap = img;
+void fbg_circleFill(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_ellipseShape(fbg, x, y, radius, radius, 0, r, g, b, 255);
+}
 
-    // assign it by default if there is no default fonts
-    if (fbg->current_font.bitmap == 0) {
-        fbg_textFont(fbg, fnt);
-    }
+void fbg_circleFilla(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_ellipseShape(fbg, x, y, radius, radius, 0, r, g, b, a);
+}
 
-    return fnt;
+void fbg_ellipse(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_ellipseShape(fbg, x, y, rx, ry, 1, r, g, b, 255);
 }
 
-void fbg_textFont(struct _fbg *fbg, struct _fbg_font *fnt) {
-    fbg->current_font = *fnt;
+void fbg_ellipsea(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_ellipseShape(fbg, x, y, rx, ry, 1, r, g, b, a);
 }
 
-void fbg_textColor(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b) {
-    fbg->text_color.r = r;
-    fbg->text_color.g = g;
-    fbg->text_color.b = b;
+void fbg_ellipseFill(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_ellipseShape(fbg, x, y, rx, ry, 0, r, g, b, 255);
 }
 
-void fbg_textColorKey(struct _fbg *fbg, unsigned char v) {
-    fbg->text_colorkey = v;
+void fbg_ellipseFilla(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_ellipseShape(fbg, x, y, rx, ry, 0, r, g, b, a);
 }
 
-void fbg_textBackground(struct _fbg *fbg, int r, int g, int b, int a) {
-    fbg->text_background.r = r;
-    fbg->text_background.g = g;
-    fbg->text_background.b = b;
-    fbg->text_alpha = a;
+void fbg_roundRect(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_roundRectShape(fbg, x, y, w, h, radius, 1, r, g, b, 255);
 }
 
-void fbg_text(struct _fbg *fbg, struct _fbg_font *fnt, char *text, int x, int y, int r, int g, int b) {
-    int i = 0, c = 0, gx, gy;
+void fbg_roundRecta(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_roundRectShape(fbg, x, y, w, h, radius, 1, r, g, b, a);
+}
 
-    if (!fnt) {
-        fnt = &fbg->current_font;
-    }
+void fbg_roundRectFill(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b) {
+    fbg_roundRectShape(fbg, x, y, w, h, radius, 0, r, g, b, 255);
+}
 
-    for (i = 0; i < strlen(text); i += 1) {
-        char glyph = text[i];
+void fbg_roundRectFilla(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    fbg_roundRectShape(fbg, x, y, w, h, radius, 0, r, g, b, a);
+}
 
-        if (glyph == ' ') {
-            fbg_recta(fbg, x + c * fnt->glyph_width, y, fnt->glyph_width, fnt->glyph_height, fbg->text_background.r, fbg->text_background.g, fbg->text_background.b, fbg->text_alpha);
-            
-            c += 1;
+void fbg_getPixel(struct _fbg *fbg, int x, int y, struct _fbg_rgb *color) {
+    int ofs = y * fbg->line_length + x * fbg->components;
 
-            continue;
-        }
+    memcpy(color, (char *)(fbg->back_buffer + ofs), fbg->components);
+}
 
-        if (glyph == '\n') {
-            c = 0;
-            y += fnt->glyph_height;
 
-            continue;
-        }
+long fbg_timespecDiff(const struct timespec *a, const struct timespec *b) {
+    return (a->tv_sec - b->tv_sec) * 1000000000L + (a->tv_nsec - b->tv_nsec);
+}
 
-        unsigned char font_glyph = glyph - fnt->first_char;
+void fbg_timespecAdd(struct timespec *t, long ns) {
+    t->tv_nsec += ns;
 
-        int gcoordx = fnt->glyph_coord_x[font_glyph];
-        int gcoordy = fnt->glyph_coord_y[font_glyph];
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec += 1;
+    }
 
-        for (gy = 0; gy < fnt->glyph_height; gy += 1) {
-            int ly = gcoordy + gy;
-            int fly = ly * fnt->bitmap->width;
-            int py = y + gy;
+    while (t->tv_nsec < 0) {
+        t->tv_nsec += 1000000000L;
+        t->tv_sec -= 1;
+    }
+}
 
-            for (gx = 0; gx < fnt->glyph_width; gx += 1) {
-                int lx = gcoordx + gx;
-                unsigned char fl = fnt->bitmap->data[(fly + lx) * fbg->components];
+void fbg_setTargetFramerate(struct _fbg *fbg, int fps) {
+    fbg->target_fps = _FBG_MAX(fps, 0);
 
-                if (fl == fbg->text_colorkey) {
-                    fbg_pixela(fbg, x + gx + c * fnt->glyph_width, py, fbg->text_background.r, fbg->text_background.g, fbg->text_background.b, fbg->text_alpha);
-                } else {
-                    fbg_pixel(fbg, x + gx + c * fnt->glyph_width, py, r, g, b);
-                }
-            }
-        }
+    fbg->late_frames = 0;
+    fbg->frame_late = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &fbg->frame_deadline);
+    fbg->frame_start = fbg->frame_deadline;
+}
+
+unsigned int fbg_getLateFrames(struct _fbg *fbg) {
+    return fbg->late_frames;
+}
+
+struct _fbg_governor *fbg_createGovernor(float budget) {
+    struct _fbg_governor *governor = (struct _fbg_governor *)calloc(1, sizeof(struct _fbg_governor));
+    if (!governor) {
+        fprintf(stderr, "fbg_createGovernor: governor calloc failed!\n");
+
+        return NULL;
+    }
+
+    governor->budget = budget;
+    governor->smoothing = 0.1f;
+    governor->degrade_ratio = 0.95f;
+    governor->restore_ratio = 0.7f;
+    governor->degrade_hold = 15;
+    governor->restore_hold = 120;
+
+    return governor;
+}
+
+int fbg_governorAddKnob(struct _fbg_governor *governor, int *value, int min, int max, int step, void (*apply)(struct _fbg *fbg, int value, void *user_data), void *user_data) {
+    if (!value || min > max || step <= 0) {
+        fprintf(stderr, "fbg_governorAddKnob: invalid knob!\n");
+
+        return -1;
+    }
+
+    if (governor->knobs_count == governor->knobs_capacity) {
+        int capacity = governor->knobs_capacity ? governor->knobs_capacity * 2 : 4;
+
+        struct _fbg_governor_knob *knobs = (struct _fbg_governor_knob *)realloc(governor->knobs, capacity * sizeof(struct _fbg_governor_knob));
+        if (!knobs) {
+            fprintf(stderr, "fbg_governorAddKnob: knobs realloc failed!\n");
+
+            return -1;
+        }
+
+        governor->knobs = knobs;
+        governor->knobs_capacity = capacity;
+    }
+
+    struct _fbg_governor_knob *knob = &governor->knobs[governor->knobs_count];
+    knob->value = value;
+    knob->min = min;
+    knob->max = max;
+    knob->step = step;
+    knob->apply = apply;
+    knob->user_data = user_data;
+
+    *value = _FBG_MAX(_FBG_MIN(*value, max), min);
+
+    return governor->knobs_count++;
+}
+
+int fbg_governorStep(struct _fbg *fbg, struct _fbg_governor_knob *knob, int direction) {
+    int value = *knob->value + knob->step * direction;
+    value = _FBG_MAX(_FBG_MIN(value, knob->max), knob->min);
+
+    if (value == *knob->value) {
+        return 0;
+    }
+
+    *knob->value = value;
+
+    if (knob->apply) {
+        knob->apply(fbg, value, knob->user_data);
+    }
+
+    return 1;
+}
+
+int fbg_governorUpdate(struct _fbg *fbg, struct _fbg_governor *governor, float frame_time) {
+    float budget = governor->budget;
+    if (budget <= 0) {
+        if (fbg->target_fps <= 0) {
+            return 0;
+        }
+
+        budget = 1000.0f / fbg->target_fps;
+    }
+
+    if (governor->frames++ == 0) {
+        governor->average = frame_time;
+    } else {
+        governor->average += (frame_time - governor->average) * governor->smoothing;
+    }
+
+    governor->frames_since_change += 1;
+
+    if (governor->average > budget * governor->degrade_ratio) {
+        governor->frames_under = 0;
+
+        // give the last change time to show in the average
+        if (governor->frames_since_change < governor->degrade_hold) {
+            return 0;
+        }
+
+        for (int i = 0; i < governor->knobs_count; i += 1) {
+            if (fbg_governorStep(fbg, &governor->knobs[i], -1)) {
+                governor->level += 1;
+                governor->frames_since_change = 0;
+
+                return -1;
+            }
+        }
+    } else if (governor->average < budget * governor->restore_ratio) {
+        governor->frames_under += 1;
+
+        if (governor->frames_under < governor->restore_hold || governor->level == 0) {
+            return 0;
+        }
+
+        for (int i = governor->knobs_count - 1; i >= 0; i -= 1) {
+            if (fbg_governorStep(fbg, &governor->knobs[i], 1)) {
+                governor->level -= 1;
+                governor->frames_since_change = 0;
+                governor->frames_under = 0;
+
+                return 1;
+            }
+        }
+    } else {
+        governor->frames_under = 0;
+    }
+
+    return 0;
+}
+
+void fbg_setGovernor(struct _fbg *fbg, struct _fbg_governor *governor) {
+    fbg->governor = governor;
+}
+
+void fbg_freeGovernor(struct _fbg_governor *governor) {
+    free(governor->knobs);
+    free(governor);
+}
+
+void fbg_waitFrame(struct _fbg *fbg) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    fbg->frame_time = fbg_timespecDiff(&now, &fbg->frame_start) / 1000000.0f;
+
+    if (fbg->governor) {
+        fbg_governorUpdate(fbg, fbg->governor, fbg->frame_time);
+    }
+
+    int vsync = (fbg->backend_vsync && !fbg->vsync_failed);
+
+    long period = 0;
+    if (fbg->target_fps > 0) {
+        period = 1000000000L / fbg->target_fps;
+
+        long lateness = fbg_timespecDiff(&now, &fbg->frame_deadline);
+        if (lateness > 0) {
+            // missed deadlines are not caught up, the schedule restart from now
+            fbg->frame_late = 1;
+            fbg->late_frames += 1 + lateness / period;
+
+            fbg->frame_deadline = now;
+        } else {
+            fbg->frame_late = 0;
+
+            // absolute deadline so that the wake up latency does not accumulate
+            // with vertical sync the timer only wake up half a period early and the vertical blank end the wait
+            struct timespec wake = fbg->frame_deadline;
+            if (vsync) {
+                fbg_timespecAdd(&wake, -period / 2);
+            }
+
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR);
+        }
+    }
+
+    if (vsync) {
+        if (fbg->backend_vsync(fbg) != 0) {
+            fbg->vsync_failed = 1;
+
+            vsync = 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &fbg->frame_start);
+
+    if (period) {
+        if (vsync) {
+            // follow the display clock
+            fbg->frame_deadline = fbg->frame_start;
+        }
+
+        fbg_timespecAdd(&fbg->frame_deadline, period);
+    }
+}
+
+void fbg_draw(struct _fbg *fbg) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_DRAW, 0)
+
+    // the frame content is complete before the deadline / vertical sync wait, only the backend copy follow it
+    if (fbg->indexed) {
+        fbg_indexedDraw(fbg, fbg->indexed, 0, 0);
+    }
+
+    fbg_waitFrame(fbg);
+
+    if (fbg->user_draw) {
+        fbg->user_draw(fbg);
+    }
+
+    // the presenter is done with the buffers replaced by the previous resize
+    if (fbg->retired_buffers[0]) {
+        fbg_retireBuffers(fbg);
+    }
+
+    // resize the context (registered) by fbg_pushResize if needed
+    // note : we process the resize event here to be sure that a single resize is processed in the main thread, avoiding potential issues with fragments / caller thread
+    if (atomic_load_explicit(&fbg->pending_resize, memory_order_relaxed)) {
+        struct _fbg_resize *resize = atomic_exchange_explicit(&fbg->pending_resize, NULL, memory_order_acq_rel);
+        if (resize) {
+            fbg_commitResize(fbg, resize);
+
+            fbg_freeResize(resize);
+        }
+    }
+}
+
+void fbg_flip(struct _fbg *fbg) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FLIP, 0)
+
+    if (fbg->user_flip) {
+        fbg->user_flip(fbg);
+    } else {
+        unsigned char *tmp_buffer = fbg->disp_buffer;
+        fbg->disp_buffer = fbg->back_buffer;
+        fbg->back_buffer = tmp_buffer;
+    }
+
+    fbg_computeFramerate(fbg, 1);
+
+    if (fbg->scratch_arena) {
+        fbg_arenaReset(fbg->scratch_arena);
+    }
+}
+
+void fbg_clearRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    unsigned char color = *(unsigned char *)user_data;
+
+    memset(fbg->back_buffer + y_start * fbg->line_length, color, (y_end - y_start) * fbg->line_length);
+}
+
+void fbg_clear(struct _fbg *fbg, unsigned char color) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_CLEAR, color)
+
+    fbg_parallelRows(fbg, fbg_clearRows, &color);
+}
+
+void fbg_fadeDownRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    unsigned char rgb_fade_amount = *(unsigned char *)user_data;
+
+    int x = 0, y = 0;
+
+    for (y = y_start; y < y_end; y += 1) {
+        unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + y * fbg->line_length);
+
+        for (x = 0; x < fbg->width; x += 1) {
+            *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
+            pix_pointer++;
+            *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
+            pix_pointer++;
+            *pix_pointer = _FBG_MAX(*pix_pointer - rgb_fade_amount, 0);
+            pix_pointer++;
+            pix_pointer += fbg->comp_offset;
+        }
+    }
+}
+
+void fbg_fadeDown(struct _fbg *fbg, unsigned char rgb_fade_amount) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FADE_DOWN, rgb_fade_amount)
+
+    fbg_parallelRows(fbg, fbg_fadeDownRows, &rgb_fade_amount);
+}
+
+void fbg_fadeUpRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    unsigned char rgb_fade_amount = *(unsigned char *)user_data;
+
+    int x = 0, y = 0;
+
+    for (y = y_start; y < y_end; y += 1) {
+        unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + y * fbg->line_length);
+
+        for (x = 0; x < fbg->width; x += 1) {
+            *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
+            pix_pointer++;
+            *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
+            pix_pointer++;
+            *pix_pointer = _FBG_MIN(*pix_pointer + rgb_fade_amount, 255);
+            pix_pointer++;
+            pix_pointer += fbg->comp_offset;
+        }
+    }
+}
+
+void fbg_fadeUp(struct _fbg *fbg, unsigned char rgb_fade_amount) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_FADE_UP, rgb_fade_amount)
+
+    fbg_parallelRows(fbg, fbg_fadeUpRows, &rgb_fade_amount);
+}
+
+void fbg_backgroundRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_rgb *color = (struct _fbg_rgb *)user_data;
+
+    int x = 0, y = 0;
+
+    for (y = y_start; y < y_end; y += 1) {
+        unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + y * fbg->line_length);
+
+        for (x = 0; x < fbg->width; x += 1) {
+            *pix_pointer = color->r;
+            pix_pointer++;
+            *pix_pointer = color->g;
+            pix_pointer++;
+            *pix_pointer = color->b;
+            pix_pointer++;
+            pix_pointer += fbg->comp_offset;
+        }
+    }
+}
+
+void fbg_background(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_BACKGROUND, r, g, b)
+
+    struct _fbg_rgb color = { r, g, b, 0 };
+
+    fbg_parallelRows(fbg, fbg_backgroundRows, &color);
+}
+
+float fbg_hue2rgb(float v1, float v2, float vH) {
+    if (vH < 0)
+        vH += 1;
+
+    if (vH > 1)
+        vH -= 1;
+
+    if ((6 * vH) < 1)
+        return (v1 + (v2 - v1) * 6 * vH);
+
+    if ((2 * vH) < 1)
+        return v2;
+
+    if ((3 * vH) < 2)
+        return (v1 + (v2 - v1) * ((2.0f / 3) - vH) * 6);
+
+    return v1;
+}
+
+void fbg_hslToRGB(struct _fbg_rgb *color, float h, float s, float l) {
+    if (s == 0) {
+        color->r = color->g = color->b = (unsigned char)(l * 255);
+    } else {
+        float v1, v2;
+        float hue = (float)h / 360;
+
+        v2 = (l < 0.5) ? (l * (1 + s)) : ((l + s) - (l * s));
+        v1 = 2 * l - v2;
+
+        color->r = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue + (1.0f / 3)));
+        color->g = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue));
+        color->b = (unsigned char)(255 * fbg_hue2rgb(v1, v2, hue - (1.0f / 3)));
+    }
+}
+
+void fbg_rgbToHsl(struct _fbg_hsl *color, float r, float g, float b) {
+    r /= 255.0f, g /= 255.0f, b /= 255.0f;
+    float max = fmaxf(fmaxf(r, g), b), min = fminf(fminf(r, g), b);
+    float h = 0, s, l = (max + min) / 2.0f;
+
+    if (max == min){
+        h = s = 0; // achromatic
+    } else {
+        float d = max - min;
+        s = l > 0.5f ? d / (2.0f - max - min) : d / (max + min);
+
+        if (max == r)
+            h = (g - b) / d + (g < b ? 6.0f : 0);
+        else if (max == g)
+            h = (b - r) / d + 2.0f;
+        else
+            h = (r - g) / d + 4.0f;
+
+        h /= 6.0f;
+    }
+
+    // hue in degrees (as fbg_hslToRGB expect it)
+    color->h = (int)lroundf(h * 360.0f) % 360;
+    color->s = s;
+    color->l = l;
+}
+
+int fbg_hueWeight(int hue) {
+    // hue2rgb ramp as a weight in [0, 60] : rise on [0, 60), 60 on [60, 180), fall on [180, 240), 0 after (branchless)
+    int w = _FBG_MIN(hue, 240 - hue);
+
+    return _FBG_MIN(_FBG_MAX(w, 0), 60);
+}
+
+void fbg_hslToRGB16(struct _fbg_rgb *color, int h, int s, int l) {
+    // saturation / lightness 16-bit fixed point (65536 = 1.0)
+    h %= 360;
+    h += (h < 0) ? 360 : 0;
+
+    int ls = (int)(((int64_t)l * s) >> 16);
+    int v2 = (l < 32768) ? l + ls : l + s - ls;
+    int v1 = 2 * l - v2;
+    int d = v2 - v1;
+
+    int hr = h + 120, hb = h - 120;
+    hr -= (hr >= 360) ? 360 : 0;
+    hb += (hb < 0) ? 360 : 0;
+
+    // 16-bit to 8-bit with rounding
+    color->r = ((v1 + d * fbg_hueWeight(hr) / 60) * 255 + 32768) >> 16;
+    color->g = ((v1 + d * fbg_hueWeight(h) / 60) * 255 + 32768) >> 16;
+    color->b = ((v1 + d * fbg_hueWeight(hb) / 60) * 255 + 32768) >> 16;
+}
+
+void fbg_hslToRGBFixed(struct _fbg_rgb *color, int h, int s, int l) {
+    fbg_hslToRGB16(color, h, (s * 65793 + 128) >> 8, (l * 65793 + 128) >> 8);
+}
+
+void fbg_hslToRGBArray(struct _fbg_rgb *colors, const struct _fbg_hsl *hsl, int count) {
+    int i;
+    for (i = 0; i < count; i += 1) {
+        fbg_hslToRGB16(&colors[i], hsl[i].h, (int)(hsl[i].s * 65536.0f + 0.5f), (int)(hsl[i].l * 65536.0f + 0.5f));
+    }
+}
+
+int fbg_divRound(int n, int d) {
+    // rounded division (half away from zero), d > 0
+    return (n >= 0) ? (2 * n + d) / (2 * d) : -((2 * -n + d) / (2 * d));
+}
+
+void fbg_rgbToHslArray(struct _fbg_hsl *hsl, const struct _fbg_rgb *colors, int count) {
+    int i;
+    for (i = 0; i < count; i += 1) {
+        int r = colors[i].r, g = colors[i].g, b = colors[i].b;
+        int max = _FBG_MAX(_FBG_MAX(r, g), b), min = _FBG_MIN(_FBG_MIN(r, g), b);
+        int d = max - min, sum = max + min;
+
+        hsl[i].l = sum / 510.0f;
+
+        if (d == 0) {
+            hsl[i].h = 0;
+            hsl[i].s = 0;
+
+            continue;
+        }
+
+        hsl[i].s = (float)d / (sum > 255 ? 510 - sum : sum);
+
+        // hue in degrees, rounded
+        int h;
+        if (max == r)
+            h = fbg_divRound(60 * (g - b), d);
+        else if (max == g)
+            h = fbg_divRound(60 * (b - r), d) + 120;
+        else
+            h = fbg_divRound(60 * (r - g), d) + 240;
+
+        if (h < 0) {
+            h += 360;
+        }
+
+        hsl[i].h = h % 360;
+    }
+}
+
+void fbg_hslGradient(struct _fbg_rgb *colors, int count, const struct _fbg_hsl *from, const struct _fbg_hsl *to) {
+    int s_from = from->s * 65536.0f + 0.5f, s_to = to->s * 65536.0f + 0.5f;
+    int l_from = from->l * 65536.0f + 0.5f, l_to = to->l * 65536.0f + 0.5f;
+
+    int steps = _FBG_MAX(count - 1, 1);
+
+    // incremental interpolation with 16 bits of fraction (no division per color)
+    int64_t h = (int64_t)from->h * 65536, s = (int64_t)s_from * 65536, l = (int64_t)l_from * 65536;
+    int64_t dh = (int64_t)(to->h - from->h) * 65536 / steps;
+    int64_t ds = (int64_t)(s_to - s_from) * 65536 / steps;
+    int64_t dl = (int64_t)(l_to - l_from) * 65536 / steps;
+
+    int i;
+    for (i = 0; i < count; i += 1) {
+        fbg_hslToRGB16(&colors[i], (int)((h + 32768) >> 16), (int)((s + 32768) >> 16), (int)((l + 32768) >> 16));
+
+        h += dh;
+        s += ds;
+        l += dl;
+    }
+}
+
+void fbg_rgbGradient(struct _fbg_rgb *colors, int count, const struct _fbg_rgb *from, const struct _fbg_rgb *to) {
+    int steps = _FBG_MAX(count - 1, 1);
+
+    // exact interpolation (not stepped in fixed point), the gradient stops rely on the end colors being reached
+    int i;
+    for (i = 0; i < count; i += 1) {
+        colors[i].r = from->r + (to->r - from->r) * i / steps;
+        colors[i].g = from->g + (to->g - from->g) * i / steps;
+        colors[i].b = from->b + (to->b - from->b) * i / steps;
+    }
+}
+
+struct _fbg_font *fbg_initFont(struct _fbg *fbg, struct _fbg_font *fnt, struct _fbg_img *img, int glyph_count, int glyph_width, int glyph_height, unsigned char first_char) {
+    fnt->glyph_width = glyph_width;
+    fnt->glyph_height = glyph_height;
+    fnt->first_char = first_char;
+
+    int i = 0;
+
+    for (i = 0; i < glyph_count; i += 1) {
+        int gcoord = i * glyph_width;
+        int gcoordx = gcoord % img->width;
+        int gcoordy = (gcoord / img->width) * glyph_height;
+
+        fnt->glyph_coord_x[i] = gcoordx;
+        fnt->glyph_coord_y[i] = gcoordy;
+    }
+
+    fnt->bitmap = img;
+
+    // assign it by default if there is no default fonts
+    if (fbg->current_font.bitmap == 0) {
+        fbg_textFont(fbg, fnt);
+    }
+
+    return fnt;
+}
+
+struct _fbg_font *fbg_createFont(struct _fbg *fbg, struct _fbg_img *img, int glyph_width, int glyph_height, unsigned char first_char) {
+    struct _fbg_arena *arena = fbg->assets_arena;
+
+    int glyph_count = (img->width / glyph_width) * (img->height / glyph_height);
+
+    if (arena) {
+        struct _fbg_font *fnt = (struct _fbg_font *)fbg_arenaAlloc(arena, sizeof(struct _fbg_font));
+        if (!fnt) {
+            fprintf(stderr, "fbg_createFont : arena allocation failed!\n");
+
+            return NULL;
+        }
+
+        fnt->glyph_coord_x = fbg_arenaAlloc(arena, glyph_count * sizeof(int));
+        fnt->glyph_coord_y = fbg_arenaAlloc(arena, glyph_count * sizeof(int));
+        if (!fnt->glyph_coord_x || !fnt->glyph_coord_y) {
+            fprintf(stderr, "fbg_createFont (%ix%i '%c'): glyph coordinates arena allocation failed!\n", glyph_width, glyph_height, first_char);
+
+            return NULL;
+        }
+
+        fnt->arena = arena;
+
+        return fbg_initFont(fbg, fnt, img, glyph_count, glyph_width, glyph_height, first_char);
+    }
+
+    struct _fbg_font *fnt = (struct _fbg_font *)calloc(1, sizeof(struct _fbg_font));
+    if (!fnt) {
+        fprintf(stderr, "fbg_createFont : calloc failed!\n");
+
+        return NULL;
+    }
+
+    fnt->glyph_coord_x = calloc(1, glyph_count * sizeof(int));
+    if (!fnt->glyph_coord_x) {
+        fprintf(stderr, "fbg_createFont (%ix%i '%c'): glyph_coord_x calloc failed!\n", glyph_width, glyph_height, first_char);
+
+        free(fnt);
+
+        return NULL;
+    }
+
+    fnt->glyph_coord_y = calloc(1, glyph_count * sizeof(int));
+    if (!fnt->glyph_coord_y) {
+        fprintf(stderr, "fbg_createFont (%ix%i '%c'): glyph_coord_y calloc failed!\n", glyph_width, glyph_height, first_char);
+
+        free(fnt->glyph_coord_x);
+        free(fnt);
+
+        return NULL;
+    }
+
+    return fbg_initFont(fbg, fnt, img, glyph_count, glyph_width, glyph_height, first_char);
+}
+
+void fbg_textFont(struct _fbg *fbg, struct _fbg_font *fnt) {
+    fbg->current_font = *fnt;
+}
+
+void fbg_textColor(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b) {
+    fbg->text_color.r = r;
+    fbg->text_color.g = g;
+    fbg->text_color.b = b;
+}
+
+void fbg_textColorKey(struct _fbg *fbg, unsigned char v) {
+    fbg->text_colorkey = v;
+}
+
+void fbg_textBackground(struct _fbg *fbg, int r, int g, int b, int a) {
+    fbg->text_background.r = r;
+    fbg->text_background.g = g;
+    fbg->text_background.b = b;
+    fbg->text_alpha = a;
+}
+
+void fbg_text(struct _fbg *fbg, struct _fbg_font *fnt, char *text, int x, int y, int r, int g, int b) {
+    int i = 0, c = 0, gx, gy;
+
+    if (!fnt) {
+        fnt = &fbg->current_font;
+    }
+
+    int length = strlen(text);
+
+    for (i = 0; i < length; i += 1) {
+        char glyph = text[i];
+
+        if (glyph == ' ') {
+            fbg_recta(fbg, x + c * fnt->glyph_width, y, fnt->glyph_width, fnt->glyph_height, fbg->text_background.r, fbg->text_background.g, fbg->text_background.b, fbg->text_alpha);
+            
+            c += 1;
+
+            continue;
+        }
+
+        if (glyph == '\n') {
+            c = 0;
+            y += fnt->glyph_height;
+
+            continue;
+        }
+
+        unsigned char font_glyph = glyph - fnt->first_char;
+
+        int gcoordx = fnt->glyph_coord_x[font_glyph];
+        int gcoordy = fnt->glyph_coord_y[font_glyph];
+
+        for (gy = 0; gy < fnt->glyph_height; gy += 1) {
+            int ly = gcoordy + gy;
+            int fly = ly * fnt->bitmap->width;
+            int py = y + gy;
+
+            for (gx = 0; gx < fnt->glyph_width; gx += 1) {
+                int lx = gcoordx + gx;
+                unsigned char fl = fnt->bitmap->data[(fly + lx) * fbg->components];
+
+                if (fl == fbg->text_colorkey) {
+                    fbg_pixela(fbg, x + gx + c * fnt->glyph_width, py, fbg->text_background.r, fbg->text_background.g, fbg->text_background.b, fbg->text_alpha);
+                } else {
+                    fbg_pixel(fbg, x + gx + c * fnt->glyph_width, py, r, g, b);
+                }
+            }
+        }
 
         c += 1;
     }
-}
+}
+
+void fbg_text_new(struct _fbg *fbg, const char *text, int x, int y, int font_size, uint8_t r, uint8_t g, uint8_t b) {
+  int char_width = FONT_WIDTH * font_size;   // Calculate scaled character width
+  int char_height = FONT_HEIGHT * font_size; // Calculate scaled character height
+
+  FBG_TRACE_BEGIN(fbg, FBG_TRACE_TEXT_NEW, text, x, y, font_size, r, g, b)
+
+  while (*text) {
+    char c = *text++;
+
+    // Only render printable ASCII characters (32 to 126)
+    if (c < 32 || c > 126) {
+      continue;
+    }
+
+    // Get the character's bitmap from the font array
+    const uint8_t *char_bitmap = font[c - FONT_FIRST_CHAR];
+
+    // Render the character
+    for (int row = 0; row < FONT_HEIGHT; row++) {  // Iterate over original character height
+      for (int col = 0; col < FONT_WIDTH; col++) { // Iterate over original character width
+        if (char_bitmap[row] & (1 << (7 - col))) {
+          // Scale the pixel by `font_size`
+          for (int dy = 0; dy < font_size; dy++) {   // Scale vertically
+            for (int dx = 0; dx < font_size; dx++) { // Scale horizontally
+              fbg_pixel(fbg, x + col * font_size + dx, y + row * font_size + dy, r, g, b);
+            }
+          }
+        }
+      }
+    }
+
+    // Move the x position for the next character
+    x += char_width;
+  }
+
+  FBG_TRACE_END(fbg)
+}
+
+  void fbg_freeFont(struct _fbg_font * font) {
+    if (font->arena) {
+        return;
+    }
+
+    free(font->glyph_coord_x);
+    free(font->glyph_coord_y);
+
+    free(font);
+}
+
+struct _fbg_text_cache *fbg_createTextCache(int entries_count) {
+    struct _fbg_text_cache *cache = (struct _fbg_text_cache *)calloc(1, sizeof(struct _fbg_text_cache));
+    if (!cache) {
+        fprintf(stderr, "fbg_createTextCache: calloc failed!\n");
+
+        return NULL;
+    }
+
+    // power of two so that the slot is a mask of the hash
+    int capacity = 8;
+    while (capacity < entries_count) {
+        capacity <<= 1;
+    }
+
+    cache->entries = (struct _fbg_text_run *)calloc(capacity, sizeof(struct _fbg_text_run));
+    if (!cache->entries) {
+        fprintf(stderr, "fbg_createTextCache: entries calloc failed!\n");
+
+        free(cache);
+
+        return NULL;
+    }
+
+    cache->entries_count = capacity;
+
+    return cache;
+}
+
+void fbg_freeTextCache(struct _fbg_text_cache *cache) {
+    int i = 0;
+
+    for (i = 0; i < cache->entries_count; i += 1) {
+        free(cache->entries[i].text);
+        free(cache->entries[i].runs);
+    }
+
+    free(cache->entries);
+
+    free(cache);
+}
+
+uint32_t fbg_textHash(const char *text, int length, const void *font, int size) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    int i = 0;
+
+    for (i = 0; i < length; i += 1) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+
+    hash = (hash ^ (uint32_t)(uintptr_t)font) * 16777619u;
+    hash = (hash ^ (uint32_t)size) * 16777619u;
+
+    return hash;
+}
+
+// add a run, merged with the previous one when they are contiguous on the same rows
+int fbg_textRunAdd(struct _fbg_text_run *entry, int x, int y, int w, int h) {
+    if (entry->runs_count > 0) {
+        struct _fbg_rect *last = &entry->runs[entry->runs_count - 1];
+
+        if (last->y == y && last->h == h && last->x + last->w == x) {
+            last->w += w;
+
+            return 1;
+        }
+    }
+
+    if (entry->runs_count == entry->runs_capacity) {
+        int runs_capacity = _FBG_MAX(entry->runs_capacity * 2, 64);
+
+        struct _fbg_rect *runs = (struct _fbg_rect *)realloc(entry->runs, runs_capacity * sizeof(struct _fbg_rect));
+        if (!runs) {
+            fprintf(stderr, "fbg_textRunAdd: runs realloc failed!\n");
+
+            return 0;
+        }
+
+        entry->runs = runs;
+        entry->runs_capacity = runs_capacity;
+    }
+
+    struct _fbg_rect *run = &entry->runs[entry->runs_count++];
+    run->x = x;
+    run->y = y;
+    run->w = w;
+    run->h = h;
+
+    return 1;
+}
+
+// rasterize a text line by line into runs, glyph rows are visited left to right so that runs spanning several glyphs are merged
+int fbg_textRasterize(struct _fbg_text_run *entry, struct _fbg_pfont *pfont, const char *text, int font_size) {
+    const char *line = text;
+    int line_y = 0;
+
+    entry->runs_count = 0;
+
+    while (*line) {
+        // fbg_text_new has no line breaks
+        int line_length = pfont ? (int)strcspn(line, "\n") : (int)strlen(line);
+        int rows = pfont ? pfont->line_height : FONT_HEIGHT;
+        int row = 0, i = 0;
+
+        // glyph rows can extend above the line top (negative bearing) or below the line height
+        int row_start = 0, row_end = rows;
+        if (pfont) {
+            row_start = INT_MAX;
+            row_end = INT_MIN;
+
+            for (i = 0; i < line_length; i += 1) {
+                int index = (unsigned char)line[i] - pfont->first_char;
+                if (index < 0 || index >= pfont->glyphs_count) {
+                    continue;
+                }
+
+                const struct _fbg_glyph *glyph = &pfont->glyphs[index];
+
+                row_start = _FBG_MIN(row_start, glyph->bearing_y);
+                row_end = _FBG_MAX(row_end, glyph->bearing_y + glyph->height);
+            }
+        }
+
+        for (row = row_start; row < row_end; row += 1) {
+            int pen_x = 0;
+            int previous = -1;
+
+            for (i = 0; i < line_length; i += 1) {
+                unsigned char c = line[i];
+                uint32_t bits = 0;
+                int gx = 0;
+
+                if (pfont) {
+                    int index = c - pfont->first_char;
+                    if (index < 0 || index >= pfont->glyphs_count) {
+                        previous = -1;
+
+                        continue;
+                    }
+
+                    if (pfont->kerning && previous >= 0) {
+                        pen_x += pfont->kerning[previous * pfont->glyphs_count + index];
+                    }
+
+                    const struct _fbg_glyph *glyph = &pfont->glyphs[index];
+
+                    int glyph_row = row - glyph->bearing_y;
+                    if (glyph_row >= 0 && glyph_row < glyph->height) {
+                        bits = pfont->bitmap[glyph->offset + glyph_row];
+                    }
+
+                    gx = pen_x + glyph->bearing_x;
+
+                    pen_x += glyph->advance;
+
+                    previous = index;
+                } else {
+                    // same rules as fbg_text_new
+                    if (c < 32 || c > 126) {
+                        continue;
+                    }
+
+                    bits = (uint32_t)font[c - FONT_FIRST_CHAR][row] << 24;
+
+                    gx = pen_x;
+
+                    pen_x += FONT_WIDTH;
+                }
+
+                while (bits) {
+                    int start = __builtin_clz(bits);
+                    uint32_t rest = ~(bits << start);
+                    int run = rest ? __builtin_clz(rest) : 32 - start;
+
+                    if (!fbg_textRunAdd(entry, (gx + start) * font_size, (line_y + row) * font_size, run * font_size, font_size)) {
+                        return 0;
+                    }
+
+                    bits &= (start + run >= 32) ? 0 : (0xffffffffu >> (start + run));
+                }
+            }
+        }
+
+        line += line_length;
+        if (*line == '\n') {
+            line += 1;
+        }
+
+        line_y += rows;
+    }
+
+    return 1;
+}
+
+struct _fbg_text_run *fbg_textCacheLookup(struct _fbg_text_cache *cache, struct _fbg_pfont *pfont, const char *text, int font_size) {
+    int i = 0;
+    int length = strlen(text);
+
+    uint32_t hash = fbg_textHash(text, length, pfont, font_size);
+
+    int mask = cache->entries_count - 1;
+    int slot = hash & mask;
+
+    struct _fbg_text_run *victim = NULL;
+
+    cache->tick += 1;
+
+    // short linear probing, the least recently used entry of the probed slots is evicted on a miss
+    for (i = 0; i < FBG_TEXT_CACHE_PROBES; i += 1) {
+        struct _fbg_text_run *entry = &cache->entries[(slot + i) & mask];
+
+        if (entry->text && entry->hash == hash && entry->font == pfont && entry->font_size == font_size &&
+            entry->length == length && memcmp(entry->text, text, length) == 0) {
+            entry->last_use = cache->tick;
+
+            cache->hits += 1;
+
+            return entry;
+        }
+
+        if (!victim || entry->last_use < victim->last_use) {
+            victim = entry;
+        }
+    }
+
+    cache->misses += 1;
+
+    if (victim->text_capacity < length + 1) {
+        char *copy = (char *)realloc(victim->text, length + 1);
+        if (!copy) {
+            fprintf(stderr, "fbg_textCacheLookup: text realloc failed!\n");
+
+            return NULL;
+        }
+
+        victim->text = copy;
+        victim->text_capacity = length + 1;
+    }
+
+    memcpy(victim->text, text, length + 1);
+
+    victim->hash = hash;
+    victim->length = length;
+    victim->font = pfont;
+    victim->font_size = font_size;
+    victim->last_use = cache->tick;
+
+    if (!fbg_textRasterize(victim, pfont, text, font_size)) {
+        // leave the entry unused
+        victim->last_use = 0;
+        victim->text[0] = '\0';
+        victim->length = -1;
+
+        return NULL;
+    }
+
+    return victim;
+}
+
+void fbg_textRunDraw(struct _fbg *fbg, struct _fbg_text_run *entry, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    int i = 0, yy = 0;
+
+    for (i = 0; i < entry->runs_count; i += 1) {
+        const struct _fbg_rect *run = &entry->runs[i];
+
+        for (yy = 0; yy < run->h; yy += 1) {
+            fbg_span(fbg, x + run->x, y + run->y + yy, run->w, r, g, b);
+        }
+    }
+}
+
+void fbg_textCached(struct _fbg *fbg, struct _fbg_text_cache *cache, const char *text, int x, int y, int font_size, unsigned char r, unsigned char g, unsigned char b) {
+    struct _fbg_text_run *entry = fbg_textCacheLookup(cache, NULL, text, font_size);
+    if (!entry) {
+        fbg_text_new(fbg, text, x, y, font_size, r, g, b);
+
+        return;
+    }
+
+    fbg_textRunDraw(fbg, entry, x, y, r, g, b);
+}
+
+void fbg_pfontTextCached(struct _fbg *fbg, struct _fbg_text_cache *cache, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    struct _fbg_text_run *entry = fbg_textCacheLookup(cache, font, text, 1);
+    if (!entry) {
+        fbg_pfontText(fbg, font, text, x, y, r, g, b);
+
+        return;
+    }
+
+    fbg_textRunDraw(fbg, entry, x, y, r, g, b);
+}
+
+struct _fbg_console *fbg_createConsole(struct _fbg *fbg, int cols, int rows, int font_size) {
+    if (cols <= 0 || rows <= 0 || font_size <= 0) {
+        fprintf(stderr, "fbg_createConsole: invalid console size (%ix%i, font size %i)!\n", cols, rows, font_size);
+
+        return NULL;
+    }
+
+    struct _fbg_console *console = (struct _fbg_console *)calloc(1, sizeof(struct _fbg_console));
+    if (!console) {
+        fprintf(stderr, "fbg_createConsole: calloc failed!\n");
+
+        return NULL;
+    }
+
+    console->cols = cols;
+    console->rows = rows;
+    console->font_size = font_size;
+    console->cell_width = FONT_WIDTH * font_size;
+    console->cell_height = FONT_HEIGHT * font_size;
+    console->components = fbg->components;
+
+    // nothing was drawn yet, the first fbg_consoleDrawDirty() calls copy every row
+    console->drawn_row_start = 0;
+    console->drawn_row_end = rows;
+
+    console->cells = (struct _fbg_cell *)calloc(cols * rows, sizeof(struct _fbg_cell));
+    console->dirty = (unsigned char *)calloc(cols * rows, sizeof(unsigned char));
+    if (!console->cells || !console->dirty) {
+        fprintf(stderr, "fbg_createConsole (%ix%i): cells calloc failed!\n", cols, rows);
+
+        fbg_freeConsole(console);
+
+        return NULL;
+    }
+
+    // the surface is not taken from the assets arena since it is the only thing that is drawn into
+    struct _fbg_arena *assets_arena = fbg->assets_arena;
+    fbg->assets_arena = NULL;
+    console->surface = fbg_createImage(fbg, cols * console->cell_width, rows * console->cell_height);
+    fbg->assets_arena = assets_arena;
+
+    if (!console->surface) {
+        fbg_freeConsole(console);
+
+        return NULL;
+    }
+
+    fbg_consoleColor(console, 255, 255, 255, 0, 0, 0);
+    fbg_consoleClear(console);
+
+    return console;
+}
+
+void fbg_consoleColor(struct _fbg_console *console, unsigned char fr, unsigned char fg, unsigned char fb, unsigned char br, unsigned char bg, unsigned char bb) {
+    console->fg.r = fr;
+    console->fg.g = fg;
+    console->fg.b = fb;
+
+    console->bg.r = br;
+    console->bg.g = bg;
+    console->bg.b = bb;
+}
+
+void fbg_consoleDirtyRows(struct _fbg_console *console, int row_start, int row_end) {
+    if (console->dirty_row_start >= console->dirty_row_end) {
+        console->dirty_row_start = row_start;
+        console->dirty_row_end = row_end;
+    } else {
+        console->dirty_row_start = _FBG_MIN(console->dirty_row_start, row_start);
+        console->dirty_row_end = _FBG_MAX(console->dirty_row_end, row_end);
+    }
+}
+
+void fbg_consoleSetCell(struct _fbg_console *console, int col, int row, unsigned char c) {
+    if (col < 0 || col >= console->cols || row < 0 || row >= console->rows) {
+        return;
+    }
+
+    int index = row * console->cols + col;
+    struct _fbg_cell *cell = &console->cells[index];
+
+    // unchanged cells are not redrawn
+    if (cell->c == c && memcmp(&cell->fg, &console->fg, 3) == 0 && memcmp(&cell->bg, &console->bg, 3) == 0) {
+        return;
+    }
+
+    cell->c = c;
+    cell->fg = console->fg;
+    cell->bg = console->bg;
+
+    console->dirty[index] = 1;
+
+    fbg_consoleDirtyRows(console, row, row + 1);
+}
+
+void fbg_consoleClear(struct _fbg_console *console) {
+    int col = 0, row = 0;
+
+    for (row = 0; row < console->rows; row += 1) {
+        for (col = 0; col < console->cols; col += 1) {
+            fbg_consoleSetCell(console, col, row, ' ');
+        }
+    }
+
+    console->cursor_x = 0;
+    console->cursor_y = 0;
+}
+
+void fbg_consoleMove(struct _fbg_console *console, int col, int row) {
+    console->cursor_x = _FBG_MAX(_FBG_MIN(col, console->cols - 1), 0);
+    console->cursor_y = _FBG_MAX(_FBG_MIN(row, console->rows - 1), 0);
+}
+
+void fbg_consoleScroll(struct _fbg_console *console, int lines) {
+    int col = 0, row = 0;
+
+    if (lines <= 0) {
+        return;
+    }
+
+    lines = _FBG_MIN(lines, console->rows);
+
+    int kept_rows = console->rows - lines;
+
+    // move cells and already rasterized pixels up, only the new lines are rasterized
+    memmove(console->cells, console->cells + lines * console->cols, kept_rows * console->cols * sizeof(struct _fbg_cell));
+    memmove(console->dirty, console->dirty + lines * console->cols, kept_rows * console->cols * sizeof(unsigned char));
+
+    int surface_line_length = console->surface->width * console->components;
+    int cell_line_length = surface_line_length * console->cell_height;
+
+    memmove(console->surface->data, console->surface->data + lines * cell_line_length, kept_rows * cell_line_length);
+
+    for (row = kept_rows; row < console->rows; row += 1) {
+        for (col = 0; col < console->cols; col += 1) {
+            struct _fbg_cell *cell = &console->cells[row * console->cols + col];
+
+            cell->c = ' ';
+            cell->fg = console->fg;
+            cell->bg = console->bg;
+
+            console->dirty[row * console->cols + col] = 1;
+        }
+    }
+
+    // the kept rows moved on the surface
+    fbg_consoleDirtyRows(console, 0, console->rows);
+}
+
+void fbg_consolePutc(struct _fbg_console *console, char c) {
+    if (c == '\n') {
+        console->cursor_x = 0;
+        console->cursor_y += 1;
+    } else if (c == '\r') {
+        console->cursor_x = 0;
+    } else {
+        if (console->cursor_x >= console->cols) {
+            console->cursor_x = 0;
+            console->cursor_y += 1;
+        }
+
+        if (console->cursor_y >= console->rows) {
+            fbg_consoleScroll(console, console->cursor_y - console->rows + 1);
+
+            console->cursor_y = console->rows - 1;
+        }
+
+        fbg_consoleSetCell(console, console->cursor_x, console->cursor_y, c);
+
+        console->cursor_x += 1;
+
+        return;
+    }
+
+    if (console->cursor_y >= console->rows) {
+        fbg_consoleScroll(console, console->cursor_y - console->rows + 1);
+
+        console->cursor_y = console->rows - 1;
+    }
+}
+
+void fbg_consoleWrite(struct _fbg_console *console, const char *text) {
+    for (; *text; text += 1) {
+        fbg_consolePutc(console, *text);
+    }
+}
+
+void fbg_consoleRasterizeCell(struct _fbg_console *console, int col, int row) {
+    const struct _fbg_cell *cell = &console->cells[row * console->cols + col];
+
+    int components = console->components;
+    int surface_line_length = console->surface->width * components;
+
+    unsigned char fg[4] = { cell->fg.r, cell->fg.g, cell->fg.b, 0 };
+    unsigned char bg[4] = { cell->bg.r, cell->bg.g, cell->bg.b, 0 };
+
+    const uint8_t *char_bitmap = NULL;
+    if (cell->c >= 32 && cell->c <= 126) {
+        char_bitmap = font[cell->c - FONT_FIRST_CHAR];
+    }
+
+    unsigned char *row_pointer = console->surface->data + row * console->cell_height * surface_line_length + col * console->cell_width * components;
+
+    int y = 0, x = 0;
+
+    for (y = 0; y < console->cell_height; y += 1) {
+        uint8_t bits = char_bitmap ? char_bitmap[y / console->font_size] : 0;
+
+        unsigned char *pix_pointer = row_pointer;
+
+        for (x = 0; x < console->cell_width; x += 1) {
+            memcpy(pix_pointer, (bits & (0x80 >> (x / console->font_size))) ? fg : bg, components);
+
+            pix_pointer += components;
+        }
+
+        row_pointer += surface_line_length;
+    }
+}
+
+void fbg_consoleRasterize(struct _fbg_console *console) {
+    int i = 0;
+    int cells_count = console->cols * console->rows;
+
+    for (i = 0; i < cells_count; i += 1) {
+        if (console->dirty[i]) {
+            fbg_consoleRasterizeCell(console, i % console->cols, i / console->cols);
+
+            console->dirty[i] = 0;
+        }
+    }
+
+    console->drawn_row_start = console->dirty_row_start;
+    console->drawn_row_end = console->dirty_row_end;
+
+    console->dirty_row_start = 0;
+    console->dirty_row_end = 0;
+}
+
+void fbg_consoleDraw(struct _fbg *fbg, struct _fbg_console *console, int x, int y) {
+    fbg_consoleRasterize(console);
+
+    fbg_imageClip(fbg, console->surface, x, y, 0, 0, console->surface->width, console->surface->height);
+}
+
+void fbg_consoleDrawDirty(struct _fbg *fbg, struct _fbg_console *console, int x, int y) {
+    // with swapped buffers the back buffer hold the frame before last, so the rows changed by the previous draw are copied again
+    int row_start = console->drawn_row_start, row_end = console->drawn_row_end;
+
+    fbg_consoleRasterize(console);
+
+    if (console->drawn_row_start < console->drawn_row_end) {
+        if (row_start < row_end) {
+            row_start = _FBG_MIN(row_start, console->drawn_row_start);
+            row_end = _FBG_MAX(row_end, console->drawn_row_end);
+        } else {
+            row_start = console->drawn_row_start;
+            row_end = console->drawn_row_end;
+        }
+    }
+
+    if (row_start >= row_end) {
+        return;
+    }
+
+    int cell_height = console->cell_height;
+
+    fbg_imageClip(fbg, console->surface, x, y + row_start * cell_height, 0, row_start * cell_height, console->surface->width, (row_end - row_start) * cell_height);
+}
+
+void fbg_freeConsole(struct _fbg_console *console) {
+    if (console->surface) {
+        fbg_freeImage(console->surface);
+    }
+
+    free(console->cells);
+    free(console->dirty);
+
+    free(console);
+}
+
+struct _fbg_indexed *fbg_createIndexed(struct _fbg *fbg, int width, int height) {
+    // the surface is independent of the context format (the context is kept in the signature like the other create calls)
+    (void)fbg;
+
+    struct _fbg_indexed *indexed = (struct _fbg_indexed *)calloc(1, sizeof(struct _fbg_indexed));
+    if (!indexed) {
+        fprintf(stderr, "fbg_createIndexed: calloc failed!\n");
+
+        return NULL;
+    }
+
+    indexed->data = (unsigned char *)fbg_alignedAlloc(width * height);
+    if (!indexed->data) {
+        fprintf(stderr, "fbg_createIndexed (%ix%i): allocation failed!\n", width, height);
+
+        free(indexed);
+
+        return NULL;
+    }
+
+    indexed->width = width;
+    indexed->height = height;
+
+    int i;
+    for (i = 0; i < 256; i += 1) {
+        fbg_indexedColor(indexed, i, 0, 0, 0);
+    }
+
+    return indexed;
+}
+
+void fbg_indexedColor(struct _fbg_indexed *indexed, unsigned char index, unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char entry[4] = { r, g, b, 255 };
+
+    memcpy(&indexed->lut[index], entry, 4);
+}
+
+void fbg_indexedPalette(struct _fbg_indexed *indexed, int first, int count, const struct _fbg_rgb *colors) {
+    int i;
+    for (i = 0; i < count && first + i < 256; i += 1) {
+        fbg_indexedColor(indexed, first + i, colors[i].r, colors[i].g, colors[i].b);
+    }
+}
+
+void fbg_indexedCycle(struct _fbg_indexed *indexed, int first, int count, int amount) {
+    count = _FBG_MIN(count, 256 - first);
+    if (count <= 1) {
+        return;
+    }
+
+    amount %= count;
+    if (amount < 0) {
+        amount += count;
+    }
+
+    uint32_t range[256];
+    memcpy(range, &indexed->lut[first], count * sizeof(uint32_t));
+
+    // entry i move to i + amount
+    memcpy(&indexed->lut[first + amount], range, (count - amount) * sizeof(uint32_t));
+    memcpy(&indexed->lut[first], &range[count - amount], amount * sizeof(uint32_t));
+}
+
+void fbg_indexedClear(struct _fbg_indexed *indexed, unsigned char index) {
+    memset(indexed->data, index, indexed->width * indexed->height);
+}
+
+void fbg_indexedPixel(struct _fbg_indexed *indexed, int x, int y, unsigned char index) {
+    indexed->data[y * indexed->width + x] = index;
+}
+
+void fbg_indexedRect(struct _fbg_indexed *indexed, int x, int y, int w, int h, unsigned char index) {
+    int x1 = _FBG_MAX(x, 0), y1 = _FBG_MAX(y, 0);
+    int x2 = _FBG_MIN(x + w, indexed->width), y2 = _FBG_MIN(y + h, indexed->height);
+
+    if (x1 >= x2) {
+        return;
+    }
+
+    int yy;
+    for (yy = y1; yy < y2; yy += 1) {
+        memset(indexed->data + yy * indexed->width + x1, index, x2 - x1);
+    }
+}
+
+void fbg_indexedLine(struct _fbg_indexed *indexed, int x1, int y1, int x2, int y2, unsigned char index) {
+    int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+
+    for (;;) {
+        if (x1 >= 0 && y1 >= 0 && x1 < indexed->width && y1 < indexed->height) {
+            indexed->data[y1 * indexed->width + x1] = index;
+        }
+
+        if (x1 == x2 && y1 == y2) {
+            break;
+        }
+
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+struct _fbg_indexed_job {
+    struct _fbg_indexed *indexed;
+    int x;
+    int y;
+    // clipped surface columns
+    int sx;
+    int w;
+};
+
+void fbg_indexedRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_indexed_job *job = (struct _fbg_indexed_job *)user_data;
+    struct _fbg_indexed *indexed = job->indexed;
+
+    const uint32_t *lut = indexed->lut;
+
+    int y1 = _FBG_MAX(y_start, job->y), y2 = _FBG_MIN(y_end, job->y + indexed->height);
+
+    int y;
+    for (y = y1; y < y2; y += 1) {
+        const unsigned char *src = indexed->data + (y - job->y) * indexed->width + job->sx;
+        unsigned char *dst = fbg->back_buffer + y * fbg->line_length + (job->x + job->sx) * fbg->components;
+
+        int x = 0;
+
+        if (fbg->components == 4) {
+            // one 32-bit lookup and store per pixel, unrolled
+            for (; x + 4 <= job->w; x += 4) {
+                uint32_t p[4] = { lut[src[x]], lut[src[x + 1]], lut[src[x + 2]], lut[src[x + 3]] };
+                memcpy(dst + x * 4, p, 16);
+            }
+
+            for (; x < job->w; x += 1) {
+                memcpy(dst + x * 4, &lut[src[x]], 4);
+            }
+        } else {
+            // 32-bit stores overlapping the next pixel (overwritten by it), the last pixel is stored with 3 bytes to stay within the row
+            for (; x < job->w - 1; x += 1) {
+                memcpy(dst + x * 3, &lut[src[x]], 4);
+            }
+
+            if (job->w > 0) {
+                memcpy(dst + x * 3, &lut[src[x]], 3);
+            }
+        }
+    }
+}
+
+void fbg_indexedDraw(struct _fbg *fbg, struct _fbg_indexed *indexed, int x, int y) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_indexedDraw")
+
+    struct _fbg_indexed_job job;
+    job.indexed = indexed;
+    job.x = x;
+    job.y = y;
+    job.sx = _FBG_MAX(-x, 0);
+    job.w = _FBG_MIN(indexed->width, fbg->width - x) - job.sx;
+
+    if (job.w <= 0) {
+        return;
+    }
+
+    fbg_parallelRows(fbg, fbg_indexedRows, &job);
+}
+
+void fbg_setIndexed(struct _fbg *fbg, struct _fbg_indexed *indexed) {
+    fbg->indexed = indexed;
+}
+
+void fbg_freeIndexed(struct _fbg_indexed *indexed) {
+    free(indexed->data);
+    free(indexed);
+}
+
+struct _fbg_gradient *fbg_createLinearGradient(int x0, int y0, int x1, int y1) {
+    struct _fbg_gradient *gradient = (struct _fbg_gradient *)calloc(1, sizeof(struct _fbg_gradient));
+    if (!gradient) {
+        fprintf(stderr, "fbg_createLinearGradient: calloc failed!\n");
+
+        return NULL;
+    }
+
+    struct _fbg_rgb black = { 0, 0, 0, 0 };
+    fbg_gradientStops(gradient, &black, 1);
+
+    fbg_gradientLinear(gradient, x0, y0, x1, y1);
+
+    return gradient;
+}
+
+struct _fbg_gradient *fbg_createRadialGradient(int x, int y, int radius) {
+    struct _fbg_gradient *gradient = (struct _fbg_gradient *)calloc(1, sizeof(struct _fbg_gradient));
+    if (!gradient) {
+        fprintf(stderr, "fbg_createRadialGradient: calloc failed!\n");
+
+        return NULL;
+    }
+
+    struct _fbg_rgb black = { 0, 0, 0, 0 };
+    fbg_gradientStops(gradient, &black, 1);
+
+    fbg_gradientRadial(gradient, x, y, radius);
+
+    return gradient;
+}
+
+void fbg_gradientLinear(struct _fbg_gradient *gradient, int x0, int y0, int x1, int y1) {
+    gradient->type = FBG_GRADIENT_LINEAR;
+    gradient->x0 = x0;
+    gradient->y0 = y0;
+    gradient->x1 = x1;
+    gradient->y1 = y1;
+
+    // ramp index = projection on the segment * 255 / segment length^2, the index steps are constant
+    double dx = x1 - x0, dy = y1 - y0, length2 = dx * dx + dy * dy;
+    if (length2 == 0) {
+        gradient->step_x = 0;
+        gradient->step_y = 0;
+    } else {
+        gradient->step_x = (int)llround(dx * 255 * 65536 / length2);
+        gradient->step_y = (int)llround(dy * 255 * 65536 / length2);
+    }
+}
+
+void fbg_gradientRadial(struct _fbg_gradient *gradient, int x, int y, int radius) {
+    gradient->type = FBG_GRADIENT_RADIAL;
+    gradient->x0 = x;
+    gradient->y0 = y;
+    gradient->radius = _FBG_MAX(radius, 0);
+
+    // ramp entry i start at distance (i - 0.5) * radius / 255 (rounded index), compared squared and scaled to stay integer
+    gradient->thresholds[0] = 0;
+
+    int i;
+    for (i = 1; i < 256; i += 1) {
+        int64_t t = (int64_t)(2 * i - 1) * gradient->radius;
+
+        gradient->thresholds[i] = t * t;
+    }
+
+    gradient->thresholds[256] = INT64_MAX;
+}
+
+void fbg_gradientStops(struct _fbg_gradient *gradient, const struct _fbg_rgb *colors, int count) {
+    struct _fbg_rgb ramp[256];
+
+    count = _FBG_MIN(count, 256);
+
+    if (count <= 1) {
+        int i;
+        for (i = 0; i < 256; i += 1) {
+            ramp[i] = colors[0];
+        }
+    } else {
+        int k;
+        for (k = 0; k < count - 1; k += 1) {
+            int from = k * 255 / (count - 1), to = (k + 1) * 255 / (count - 1);
+
+            fbg_rgbGradient(&ramp[from], to - from + 1, &colors[k], &colors[k + 1]);
+        }
+    }
+
+    int i;
+    for (i = 0; i < 256; i += 1) {
+        unsigned char entry[4] = { ramp[i].r, ramp[i].g, ramp[i].b, 255 };
+
+        memcpy(&gradient->lut[i], entry, 4);
+    }
+}
+
+// pixels [lo, hi) of a row of w pixels for which 0 <= t + i * step < limit (the sequence is monotonic so the others are before / after)
+void fbg_stepRange(int64_t t, int64_t step, int64_t limit, int w, int *lo, int *hi) {
+    int64_t l = 0, h = w;
+
+    if (step == 0) {
+        h = (t >= 0 && t < limit) ? w : 0;
+    } else if (step > 0) {
+        if (t < 0) {
+            l = _FBG_MIN((-t + step - 1) / step, (int64_t)w);
+        }
+
+        h = (t >= limit) ? 0 : _FBG_MIN((limit - t + step - 1) / step, (int64_t)w);
+    } else {
+        if (t >= limit) {
+            l = _FBG_MIN((t - limit) / -step + 1, (int64_t)w);
+        }
+
+        h = (t < 0) ? 0 : _FBG_MIN(t / -step + 1, (int64_t)w);
+    }
+
+    *lo = (int)l;
+    *hi = (int)_FBG_MAX(h, l);
+}
+
+// fill count pixels with a packed color : the first pixel is stored then the filled part is doubled (a few memcpy per run)
+void fbg_gradientFill(unsigned char *dst, uint32_t color, int count, int components) {
+    if (count <= 0) {
+        return;
+    }
+
+    memcpy(dst, &color, components);
+
+    int filled = 1;
+    while (filled < count) {
+        int n = _FBG_MIN(filled, count - filled);
+
+        memcpy(dst + filled * components, dst, n * components);
+
+        filled += n;
+    }
+}
+
+void fbg_gradientLinearRow(struct _fbg_gradient *gradient, unsigned char *dst, int x, int y, int w, int components) {
+    const uint32_t *lut = gradient->lut;
+    const int64_t end = (int64_t)256 << 16;
+
+    // 16.16 ramp index of the first pixel (rounded), the pixels [lo, hi) are within the ramp, the others are the ramp ends
+    int64_t t = (int64_t)(x - gradient->x0) * gradient->step_x + (int64_t)(y - gradient->y0) * gradient->step_y + 32768;
+    int64_t step = gradient->step_x;
+
+    if (step == 0) {
+        fbg_gradientFill(dst, lut[t < 0 ? 0 : (t >= end ? 255 : t >> 16)], w, components);
+
+        return;
+    }
+
+    int lo, hi;
+    fbg_stepRange(t, step, end, w, &lo, &hi);
+
+    uint32_t before = (step > 0) ? lut[0] : lut[255], after = (step > 0) ? lut[255] : lut[0];
+
+    fbg_gradientFill(dst, before, lo, components);
+
+    // within the ramp the index fit in 32 bits
+    int ti = (int)(t + (int64_t)lo * step), si = (int)step;
+
+    int i = lo;
+    if (components == 4) {
+        for (; i < hi; i += 1) {
+            memcpy(dst + i * 4, &lut[ti >> 16], 4);
+            ti += si;
+        }
+    } else {
+        // 32-bit stores overlapping the next pixel (overwritten by it), the last pixel of the row is stored with 3 bytes
+        for (; i < _FBG_MIN(hi, w - 1); i += 1) {
+            memcpy(dst + i * 3, &lut[ti >> 16], 4);
+            ti += si;
+        }
+
+        if (i < hi) {
+            memcpy(dst + i * 3, &lut[ti >> 16], 3);
+        }
+    }
+
+    fbg_gradientFill(dst + hi * components, after, w - hi, components);
+}
+
+void fbg_gradientRadialRow(struct _fbg_gradient *gradient, unsigned char *dst, int x, int y, int w, int components) {
+    const uint32_t *lut = gradient->lut;
+    const int64_t *thresholds = gradient->thresholds;
+    const int64_t outer = thresholds[255];
+
+    // squared distances are scaled by 510^2 to compare against the thresholds
+    int64_t dy = y - gradient->y0;
+    int64_t dy2 = 260100 * dy * dy;
+
+    // columns [lo, hi) are within the ramp, the others are the last entry
+    int lo = w, hi = w;
+    if (dy2 < outer) {
+        // largest m with 260100 * m^2 + dy2 < outer
+        int64_t m = (int64_t)sqrt((double)(outer - dy2) / 260100);
+        while (m > 0 && 260100 * m * m + dy2 >= outer) {
+            m -= 1;
+        }
+        while (260100 * (m + 1) * (m + 1) + dy2 < outer) {
+            m += 1;
+        }
+
+        lo = (int)_FBG_MAX(_FBG_MIN(gradient->x0 - m - x, (int64_t)w), (int64_t)0);
+        hi = (int)_FBG_MAX(_FBG_MIN(gradient->x0 + m + 1 - x, (int64_t)w), (int64_t)lo);
+    }
+
+    fbg_gradientFill(dst, lut[255], lo, components);
+
+    if (lo < hi) {
+        int64_t dx = x + lo - gradient->x0;
+        int64_t a = 260100 * dx * dx + dy2;
+
+        // initial entry estimate, corrected with the thresholds then tracked incrementally along the row (the distance change by less than a pixel)
+        int index = (int)((sqrt((double)a) / gradient->radius + 1) / 2);
+        index = _FBG_MAX(_FBG_MIN(index, 255), 0);
+
+        int i;
+        for (i = lo; i < hi; i += 1) {
+            while (a < thresholds[index]) {
+                index -= 1;
+            }
+            while (a >= thresholds[index + 1]) {
+                index += 1;
+            }
+
+            if (components == 4 || i < w - 1) {
+                memcpy(dst + i * components, &lut[index], 4);
+            } else {
+                memcpy(dst + i * components, &lut[index], 3);
+            }
+
+            a += 260100 * (2 * dx + 1);
+            dx += 1;
+        }
+    }
+
+    fbg_gradientFill(dst + hi * components, lut[255], w - hi, components);
+}
+
+void fbg_gradientRow(struct _fbg_gradient *gradient, unsigned char *dst, int x, int y, int w, int components) {
+    if (gradient->type == FBG_GRADIENT_RADIAL) {
+        fbg_gradientRadialRow(gradient, dst, x, y, w, components);
+    } else {
+        fbg_gradientLinearRow(gradient, dst, x, y, w, components);
+    }
+}
+
+void fbg_gradientSpan(struct _fbg *fbg, struct _fbg_gradient *gradient, int x, int y, int w) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_gradientSpan")
+
+    if (y < 0 || y >= fbg->height) {
+        return;
+    }
+
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+
+    w = _FBG_MIN(w, fbg->width - x);
+    if (w <= 0) {
+        return;
+    }
+
+    fbg_gradientRow(gradient, fbg->back_buffer + y * fbg->line_length + x * fbg->components, x, y, w, fbg->components);
+}
+
+struct _fbg_gradient_job {
+    struct _fbg_gradient *gradient;
+    // clipped rectangle
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+void fbg_gradientRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_gradient_job *job = (struct _fbg_gradient_job *)user_data;
+    struct _fbg_gradient *gradient = job->gradient;
+
+    // horizontal ramp : every row is the same
+    int same_rows = (gradient->type == FBG_GRADIENT_LINEAR && gradient->step_y == 0);
+
+    int y1 = _FBG_MAX(y_start, job->y), y2 = _FBG_MIN(y_end, job->y + job->h);
+
+    int y;
+    for (y = y1; y < y2; y += 1) {
+        unsigned char *dst = fbg->back_buffer + y * fbg->line_length + job->x * fbg->components;
+
+        if (same_rows && y > y1) {
+            memcpy(dst, dst - fbg->line_length, job->w * fbg->components);
+        } else {
+            fbg_gradientRow(gradient, dst, job->x, y, job->w, fbg->components);
+        }
+    }
+}
+
+void fbg_gradientRect(struct _fbg *fbg, struct _fbg_gradient *gradient, int x, int y, int w, int h) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_gradientRect")
+
+    struct _fbg_gradient_job job;
+    job.gradient = gradient;
+    job.x = _FBG_MAX(x, 0);
+    job.y = _FBG_MAX(y, 0);
+    job.w = _FBG_MIN(x + w, fbg->width) - job.x;
+    job.h = _FBG_MIN(y + h, fbg->height) - job.y;
+
+    if (job.w <= 0 || job.h <= 0) {
+        return;
+    }
+
+    fbg_parallelRows(fbg, fbg_gradientRows, &job);
+}
+
+void fbg_gradientBackground(struct _fbg *fbg, struct _fbg_gradient *gradient) {
+    fbg_gradientRect(fbg, gradient, 0, 0, fbg->width, fbg->height);
+}
+
+void fbg_freeGradient(struct _fbg_gradient *gradient) {
+    free(gradient);
+}
+
+struct _fbg_queue *fbg_createQueue(int capacity) {
+    size_t count = 2;
+    while (count < (size_t)capacity) {
+        count <<= 1;
+    }
+
+    struct _fbg_queue *queue = (struct _fbg_queue *)fbg_alignedAlloc(sizeof(struct _fbg_queue));
+    if (!queue) {
+        fprintf(stderr, "fbg_createQueue: queue allocation failed!\n");
+
+        return NULL;
+    }
+
+    queue->slots = (struct _fbg_command_slot *)fbg_alignedAlloc(count * sizeof(struct _fbg_command_slot));
+    if (!queue->slots) {
+        fprintf(stderr, "fbg_createQueue: slots allocation failed!\n");
+
+        free(queue);
+
+        return NULL;
+    }
+
+    size_t i = 0;
+    for (i = 0; i < count; i += 1) {
+        atomic_init(&queue->slots[i].sequence, i);
+    }
+
+    queue->mask = count - 1;
+    queue->tail = 0;
+
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->dropped, 0);
+
+    return queue;
+}
+
+int fbg_queuePush(struct _fbg_queue *queue, const struct _fbg_command *command) {
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    for (;;) {
+        struct _fbg_command_slot *slot = &queue->slots[pos & queue->mask];
+
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            // slot free for this lap, claim it (pos is reloaded on failure)
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                slot->command = *command;
+
+                // publish to the consumer
+                atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+                return 1;
+            }
+        } else if (diff < 0) {
+            // the consumer did not release this slot yet : full
+            atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+}
+
+int fbg_queueText(struct _fbg_queue *queue, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    struct _fbg_command command;
+    command.type = FBG_COMMAND_TEXT;
+    command.x = x;
+    command.y = y;
+    command.color.r = r;
+    command.color.g = g;
+    command.color.b = b;
+    command.font = font;
+
+    size_t len = strlen(text);
+    len = _FBG_MIN(len, FBG_COMMAND_TEXT_SIZE - 1);
+    memcpy(command.text, text, len);
+    command.text[len] = '\0';
+
+    return fbg_queuePush(queue, &command);
+}
+
+int fbg_queueRect(struct _fbg_queue *queue, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    struct _fbg_command command;
+    command.type = FBG_COMMAND_RECT;
+    command.x = x;
+    command.y = y;
+    command.w = w;
+    command.h = h;
+    command.color.r = r;
+    command.color.g = g;
+    command.color.b = b;
+    command.alpha = a;
+
+    return fbg_queuePush(queue, &command);
+}
+
+int fbg_queueImage(struct _fbg_queue *queue, struct _fbg_img *img, unsigned char *data) {
+    struct _fbg_command command;
+    command.type = FBG_COMMAND_IMAGE;
+    command.img = img;
+    command.data = data;
+
+    if (!fbg_queuePush(queue, &command)) {
+        free(data);
+
+        return 0;
+    }
+
+    return 1;
+}
+
+int fbg_queueCallback(struct _fbg_queue *queue, void (*callback)(struct _fbg *fbg, void *user_data), void *user_data) {
+    struct _fbg_command command;
+    command.type = FBG_COMMAND_CALLBACK;
+    command.callback = callback;
+    command.user_data = user_data;
+
+    return fbg_queuePush(queue, &command);
+}
+
+void fbg_commandExecute(struct _fbg *fbg, struct _fbg_command *command) {
+    switch (command->type) {
+        case FBG_COMMAND_TEXT:
+            if (command->font) {
+                fbg_pfontText(fbg, command->font, command->text, command->x, command->y, command->color.r, command->color.g, command->color.b);
+            } else {
+                // the built-in font renderer is not clipped
+                struct _fbg_font *font = &fbg->current_font;
+                int w = strlen(command->text) * font->glyph_width;
+
+                if (font->bitmap && command->x >= 0 && command->y >= 0 && command->x + w <= fbg->width && command->y + font->glyph_height <= fbg->height) {
+                    fbg_text(fbg, font, command->text, command->x, command->y, command->color.r, command->color.g, command->color.b);
+                }
+            }
+            break;
+
+        case FBG_COMMAND_RECT: {
+            // producers do not know the current context size
+            int x1 = _FBG_MAX(command->x, 0);
+            int y1 = _FBG_MAX(command->y, 0);
+            int x2 = _FBG_MIN(command->x + command->w, fbg->width);
+            int y2 = _FBG_MIN(command->y + command->h, fbg->height);
+
+            if (x2 > x1 && y2 > y1) {
+                if (command->alpha == 255) {
+                    fbg_rect(fbg, x1, y1, x2 - x1, y2 - y1, command->color.r, command->color.g, command->color.b);
+                } else {
+                    fbg_recta(fbg, x1, y1, x2 - x1, y2 - y1, command->color.r, command->color.g, command->color.b, command->alpha);
+                }
+            }
+            break;
+        }
+
+        case FBG_COMMAND_IMAGE:
+            memcpy(command->img->data, command->data, command->img->width * command->img->height * fbg->components);
+
+            free(command->data);
+            break;
+
+        case FBG_COMMAND_CALLBACK:
+            command->callback(fbg, command->user_data);
+            break;
+    }
+}
+
+// take the next filled slot, return NULL when the queue is empty
+struct _fbg_command_slot *fbg_queuePop(struct _fbg_queue *queue) {
+    struct _fbg_command_slot *slot = &queue->slots[queue->tail & queue->mask];
+
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence != queue->tail + 1) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+void fbg_queueRelease(struct _fbg_queue *queue, struct _fbg_command_slot *slot) {
+    // free the slot for the next lap
+    atomic_store_explicit(&slot->sequence, queue->tail + queue->mask + 1, memory_order_release);
+
+    queue->tail += 1;
+}
+
+int fbg_queueDrain(struct _fbg *fbg, struct _fbg_queue *queue) {
+    int count = 0;
+
+    // commands pushed while draining are left to the next frame
+    size_t end = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    while (queue->tail != end) {
+        struct _fbg_command_slot *slot = fbg_queuePop(queue);
+        if (!slot) {
+            // claimed but not yet published
+            break;
+        }
+
+        fbg_commandExecute(fbg, &slot->command);
+
+        fbg_queueRelease(queue, slot);
+
+        count += 1;
+    }
+
+    return count;
+}
+
+void fbg_freeQueue(struct _fbg_queue *queue) {
+    struct _fbg_command_slot *slot = NULL;
+
+    while ((slot = fbg_queuePop(queue))) {
+        if (slot->command.type == FBG_COMMAND_IMAGE) {
+            free(slot->command.data);
+        }
+
+        fbg_queueRelease(queue, slot);
+    }
+
+    free(queue->slots);
+    free(queue);
+}
+
+// arguments of each trace op : i = integer (zigzag varint), b = byte, f = float, s = string, v = vertices (2 * previous integer), I = image id
+const char *fbg_trace_signatures[FBG_TRACE_OPS] = {
+    [FBG_TRACE_IMAGE_DATA] = "",
+    [FBG_TRACE_DRAW] = "",
+    [FBG_TRACE_FLIP] = "",
+    [FBG_TRACE_RESIZE] = "ii",
+    [FBG_TRACE_CLEAR] = "b",
+    [FBG_TRACE_BACKGROUND] = "bbb",
+    [FBG_TRACE_FADE_DOWN] = "b",
+    [FBG_TRACE_FADE_UP] = "b",
+    [FBG_TRACE_FILL] = "bbb",
+    [FBG_TRACE_PIXEL] = "iibbb",
+    [FBG_TRACE_PIXELA] = "iibbbb",
+    [FBG_TRACE_FPIXEL] = "ii",
+    [FBG_TRACE_HLINE] = "iiibbb",
+    [FBG_TRACE_VLINE] = "iiibbb",
+    [FBG_TRACE_LINE] = "iiiibbb",
+    [FBG_TRACE_POLYGON] = "ivbbb",
+    [FBG_TRACE_RECT] = "iiiibbb",
+    [FBG_TRACE_RECTA] = "iiiibbbb",
+    [FBG_TRACE_FRECT] = "iiii",
+    [FBG_TRACE_TEXT_NEW] = "siiibbb",
+    [FBG_TRACE_IMAGE] = "Iii",
+    [FBG_TRACE_IMAGE_COLORKEY] = "Iiiiii",
+    [FBG_TRACE_IMAGE_CLIP] = "Iiiiiii",
+    [FBG_TRACE_IMAGE_EX] = "Iiiffiiii",
+    [FBG_TRACE_ELLIPSE] = "iiiiibbbb",
+    [FBG_TRACE_ROUND_RECT] = "iiiiiibbbb",
+    [FBG_TRACE_SPAN] = "iiibbb",
+    [FBG_TRACE_SPANA] = "iiibbbb",
+    [FBG_TRACE_IMAGE_AFFINE] = "Iffffff",
+    [FBG_TRACE_IMAGE_QUAD] = "Iiiiiiiii",
+    [FBG_TRACE_UNTRACED] = "s"
+};
+
+uint64_t fbg_traceHash(uint64_t hash, const unsigned char *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+uint64_t fbg_frameChecksum(struct _fbg *fbg, const unsigned char *buffer) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    size_t row_length = fbg->width * fbg->components;
+    for (int y = 0; y < fbg->height; y++) {
+        hash = fbg_traceHash(hash, buffer + y * fbg->line_length, row_length);
+    }
+
+    return hash;
+}
+
+#ifdef FBG_TRACE
+int fbg_traceReserve(struct _fbg_trace *trace, size_t length) {
+    if (trace->length + length <= trace->capacity) {
+        return 1;
+    }
+
+    size_t capacity = _FBG_MAX(trace->capacity * 2, trace->length + length);
+
+    unsigned char *buffer = (unsigned char *)realloc(trace->buffer, capacity);
+    if (!buffer) {
+        fprintf(stderr, "fbg_traceReserve: realloc failed!\n");
+
+        return 0;
+    }
+
+    trace->buffer = buffer;
+    trace->capacity = capacity;
+
+    return 1;
+}
+
+void fbg_tracePutBytes(struct _fbg_trace *trace, const void *data, size_t length) {
+    if (!fbg_traceReserve(trace, length)) {
+        return;
+    }
+
+    memcpy(trace->buffer + trace->length, data, length);
+    trace->length += length;
+}
+
+void fbg_tracePutVarint(struct _fbg_trace *trace, uint64_t value) {
+    unsigned char bytes[10];
+    size_t length = 0;
+
+    do {
+        bytes[length] = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            bytes[length] |= 0x80;
+        }
+        length += 1;
+    } while (value);
+
+    fbg_tracePutBytes(trace, bytes, length);
+}
+
+void fbg_tracePutInt(struct _fbg_trace *trace, int value) {
+    // zigzag encoding so that small negative values stay short
+    fbg_tracePutVarint(trace, ((uint64_t)(int64_t)value << 1) ^ (uint64_t)((int64_t)value >> 63));
+}
+
+void fbg_traceFlush(struct _fbg_trace *trace) {
+    if (trace->length && fwrite(trace->buffer, 1, trace->length, trace->file) != trace->length) {
+        fprintf(stderr, "fbg_traceFlush: fwrite failed!\n");
+    }
+
+    trace->length = 0;
+}
+
+uint32_t fbg_traceImage(struct _fbg *fbg, struct _fbg_img *img) {
+    struct _fbg_trace *trace = fbg->trace;
+
+    size_t length = img->width * img->height * fbg->components;
+    uint64_t hash = fbg_traceHash(0xcbf29ce484222325ULL, img->data, length);
+
+    struct _fbg_trace_image *entry = NULL;
+    for (uint32_t i = 0; i < trace->images_count; i++) {
+        if (trace->images[i].img == img) {
+            entry = &trace->images[i];
+            break;
+        }
+    }
+
+    if (entry && entry->hash == hash) {
+        return entry->id;
+    }
+
+    if (!entry) {
+        if (trace->images_count == trace->images_capacity) {
+            uint32_t capacity = _FBG_MAX(trace->images_capacity * 2, 16);
+
+            struct _fbg_trace_image *images = (struct _fbg_trace_image *)realloc(trace->images, capacity * sizeof(struct _fbg_trace_image));
+            if (!images) {
+                fprintf(stderr, "fbg_traceImage: realloc failed!\n");
+
+                return 0;
+            }
+
+            trace->images = images;
+            trace->images_capacity = capacity;
+        }
+
+        entry = &trace->images[trace->images_count];
+        entry->img = img;
+        entry->id = trace->images_count;
+
+        trace->images_count += 1;
+    }
+
+    entry->hash = hash;
+
+    unsigned char op = FBG_TRACE_IMAGE_DATA;
+    fbg_tracePutBytes(trace, &op, 1);
+    fbg_tracePutVarint(trace, entry->id);
+    fbg_tracePutVarint(trace, img->width);
+    fbg_tracePutVarint(trace, img->height);
+    fbg_tracePutBytes(trace, img->data, length);
+
+    return entry->id;
+}
+
+void fbg_traceRecord(struct _fbg *fbg, int op, ...) {
+    struct _fbg_trace *trace = fbg->trace;
+    const char *signature = fbg_trace_signatures[op];
+
+    // one untraced call marker per frame is enough for the replay to report it
+    if (op == FBG_TRACE_UNTRACED) {
+        if (trace->untraced_frame == trace->frames + 1) {
+            return;
+        }
+
+        trace->untraced_frame = trace->frames + 1;
+    }
+
+    va_list args;
+    va_start(args, op);
+
+    // images come first in the signatures, embed them before the call record
+    uint32_t image_id = 0;
+    if (signature[0] == 'I') {
+        va_list image_args;
+        va_copy(image_args, args);
+        image_id = fbg_traceImage(fbg, va_arg(image_args, struct _fbg_img *));
+        va_end(image_args);
+    }
+
+    unsigned char op_byte = op;
+    fbg_tracePutBytes(trace, &op_byte, 1);
+
+    int previous = 0;
+    for (const char *s = signature; *s; s++) {
+        switch (*s) {
+            case 'i':
+                previous = va_arg(args, int);
+                fbg_tracePutInt(trace, previous);
+                break;
+            case 'b': {
+                unsigned char value = va_arg(args, int);
+                fbg_tracePutBytes(trace, &value, 1);
+                break;
+            }
+            case 'f': {
+                float value = va_arg(args, double);
+                fbg_tracePutBytes(trace, &value, sizeof(float));
+                break;
+            }
+            case 's': {
+                const char *text = va_arg(args, const char *);
+                size_t length = strlen(text);
+                fbg_tracePutVarint(trace, length);
+                fbg_tracePutBytes(trace, text, length);
+                break;
+            }
+            case 'v': {
+                int *vertices = va_arg(args, int *);
+                for (int i = 0; i < previous * 2; i++) {
+                    fbg_tracePutInt(trace, vertices[i]);
+                }
+                break;
+            }
+            case 'I':
+                va_arg(args, struct _fbg_img *);
+                fbg_tracePutVarint(trace, image_id);
+                break;
+        }
+    }
+
+    va_end(args);
+
+    if (op == FBG_TRACE_FLIP) {
+        trace->frames += 1;
+
+        fbg_traceFlush(trace);
+    }
+}
+#endif
+
+int fbg_traceStart(struct _fbg *fbg, const char *path) {
+#ifdef FBG_TRACE
+    if (fbg->trace) {
+        fbg_traceStop(fbg);
+    }
+
+    struct _fbg_trace *trace = (struct _fbg_trace *)calloc(1, sizeof(struct _fbg_trace));
+    if (!trace) {
+        fprintf(stderr, "fbg_traceStart: calloc failed!\n");
+
+        return 0;
+    }
+
+    trace->file = fopen(path, "wb");
+    if (!trace->file) {
+        fprintf(stderr, "fbg_traceStart: cannot create '%s'!\n", path);
+
+        free(trace);
+
+        return 0;
+    }
+
+    unsigned char header[16];
+    uint16_t version = FBG_TRACE_VERSION, components = fbg->components;
+    uint32_t width = fbg->width, height = fbg->height;
+    memcpy(header, FBG_TRACE_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &components, 2);
+    memcpy(header + 8, &width, 4);
+    memcpy(header + 12, &height, 4);
+
+    fbg_tracePutBytes(trace, header, sizeof(header));
+
+    fbg->trace = trace;
+
+    return 1;
+#else
+    (void)fbg;
+    (void)path;
+
+    fprintf(stderr, "fbg_traceStart: library built without FBG_TRACE!\n");
+
+    return 0;
+#endif
+}
+
+void fbg_traceStop(struct _fbg *fbg) {
+#ifdef FBG_TRACE
+    struct _fbg_trace *trace = fbg->trace;
+    if (!trace) {
+        return;
+    }
+
+    fbg_traceFlush(trace);
+
+    fclose(trace->file);
+
+    free(trace->buffer);
+    free(trace->images);
+    free(trace);
+
+    fbg->trace = NULL;
+#else
+    (void)fbg;
+#endif
+}
+
+struct _fbg_trace_reader {
+    const unsigned char *data;
+    const unsigned char *end;
+    int error;
+};
+
+uint64_t fbg_traceGetVarint(struct _fbg_trace_reader *reader) {
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->data >= reader->end) {
+            reader->error = 1;
+
+            return 0;
+        }
+
+        unsigned char byte = *reader->data++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+
+    reader->error = 1;
+
+    return 0;
+}
+
+int fbg_traceGetInt(struct _fbg_trace_reader *reader) {
+    uint64_t value = fbg_traceGetVarint(reader);
+
+    return (int)(int64_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+const unsigned char *fbg_traceGetBytes(struct _fbg_trace_reader *reader, size_t length) {
+    if ((size_t)(reader->end - reader->data) < length) {
+        reader->error = 1;
+        reader->data = reader->end;
+
+        return NULL;
+    }
+
+    const unsigned char *data = reader->data;
+    reader->data += length;
+
+    return data;
+}
+
+uint64_t fbg_traceTime(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+int fbg_traceReplay(const char *path, void (*frame_callback)(struct _fbg *fbg, uint32_t frame, uint64_t checksum, uint64_t time, void *user_data), void *user_data, struct _fbg_trace_stats *stats) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "fbg_traceReplay: cannot open '%s'!\n", path);
+
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long file_length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char *file_data = (unsigned char *)malloc(_FBG_MAX(file_length, 1));
+    if (!file_data || file_length < 16 || fread(file_data, 1, file_length, f) != (size_t)file_length) {
+        fprintf(stderr, "fbg_traceReplay: cannot read '%s'!\n", path);
+
+        free(file_data);
+        fclose(f);
+
+        return -1;
+    }
+
+    fclose(f);
+
+    uint16_t version, components;
+    uint32_t width, height;
+    memcpy(&version, file_data + 4, 2);
+    memcpy(&components, file_data + 6, 2);
+    memcpy(&width, file_data + 8, 4);
+    memcpy(&height, file_data + 12, 4);
+
+    if (memcmp(file_data, FBG_TRACE_MAGIC, 4) != 0 || version != FBG_TRACE_VERSION || (components != 3 && components != 4)) {
+        fprintf(stderr, "fbg_traceReplay: '%s' is not a supported trace!\n", path);
+
+        free(file_data);
+
+        return -1;
+    }
+
+    // memory context, the replayed calls only touch the buffers
+    struct _fbg *fbg = fbg_customSetup(width, height, components, 1, 1, NULL, NULL, NULL, NULL, NULL);
+    if (!fbg) {
+        free(file_data);
+
+        return -1;
+    }
+
+    // a replay is never recorded (FBG_TRACE_FILE)
+    fbg_traceStop(fbg);
+
+    struct _fbg_trace_reader reader = { file_data + 16, file_data + file_length, 0 };
+
+    struct _fbg_img **images = NULL;
+    uint32_t images_count = 0;
+
+    int *vertices = NULL;
+    int vertices_capacity = 0;
+
+    char *text = NULL;
+
+    if (stats) {
+        memset(stats, 0, sizeof(struct _fbg_trace_stats));
+    }
+
+    uint32_t frames = 0;
+    uint32_t untraced_frames = 0;
+    uint64_t frame_time = 0;
+    uint64_t replay_start = fbg_traceTime();
+
+    while (reader.data < reader.end && !reader.error) {
+        int op = *reader.data++;
+        if (op >= FBG_TRACE_OPS) {
+            reader.error = 1;
+            break;
+        }
+
+        if (op == FBG_TRACE_IMAGE_DATA) {
+            uint32_t id = fbg_traceGetVarint(&reader);
+            uint32_t w = fbg_traceGetVarint(&reader);
+            uint32_t h = fbg_traceGetVarint(&reader);
+            const unsigned char *data = fbg_traceGetBytes(&reader, (size_t)w * h * components);
+            if (!data || id > images_count) {
+                reader.error = 1;
+                break;
+            }
+
+            if (id == images_count) {
+                struct _fbg_img **new_images = (struct _fbg_img **)realloc(images, (images_count + 1) * sizeof(struct _fbg_img *));
+                if (!new_images) {
+                    reader.error = 1;
+                    break;
+                }
+
+                images = new_images;
+                images[images_count++] = NULL;
+            }
+
+            if (images[id]) {
+                fbg_freeImage(images[id]);
+            }
+
+            images[id] = fbg_createImage(fbg, w, h);
+            if (!images[id]) {
+                reader.error = 1;
+                break;
+            }
+
+            memcpy(images[id]->data, data, (size_t)w * h * components);
+
+            continue;
+        }
+
+        // decode the arguments
+        int ints[8];
+        float floats[6];
+        unsigned char bytes[4];
+        struct _fbg_img *img = NULL;
+        int ni = 0, nf = 0, nb = 0;
+
+        for (const char *s = fbg_trace_signatures[op]; *s && !reader.error; s++) {
+            switch (*s) {
+                case 'i':
+                    ints[ni++] = fbg_traceGetInt(&reader);
+                    break;
+                case 'b': {
+                    const unsigned char *b = fbg_traceGetBytes(&reader, 1);
+                    bytes[nb++] = b ? *b : 0;
+                    break;
+                }
+                case 'f': {
+                    const unsigned char *b = fbg_traceGetBytes(&reader, sizeof(float));
+                    floats[nf] = 0;
+                    if (b) {
+                        memcpy(&floats[nf], b, sizeof(float));
+                    }
+                    nf += 1;
+                    break;
+                }
+                case 's': {
+                    size_t length = fbg_traceGetVarint(&reader);
+                    const unsigned char *b = fbg_traceGetBytes(&reader, length);
+                    if (!b) {
+                        break;
+                    }
+
+                    free(text);
+                    text = (char *)malloc(length + 1);
+                    if (!text) {
+                        reader.error = 1;
+                        break;
+                    }
+                    memcpy(text, b, length);
+                    text[length] = '\0';
+                    break;
+                }
+                case 'v': {
+                    int count = ints[ni - 1] * 2;
+                    if (count < 0) {
+                        reader.error = 1;
+                        break;
+                    }
+
+                    if (count > vertices_capacity) {
+                        int *new_vertices = (int *)realloc(vertices, count * sizeof(int));
+                        if (!new_vertices) {
+                            reader.error = 1;
+                            break;
+                        }
+
+                        vertices = new_vertices;
+                        vertices_capacity = count;
+                    }
+
+                    for (int i = 0; i < count; i++) {
+                        vertices[i] = fbg_traceGetInt(&reader);
+                    }
+                    break;
+                }
+                case 'I': {
+                    uint32_t id = fbg_traceGetVarint(&reader);
+                    if (id >= images_count || !images[id]) {
+                        reader.error = 1;
+                        break;
+                    }
+
+                    img = images[id];
+                    break;
+                }
+            }
+        }
+
+        if (reader.error) {
+            break;
+        }
+
+        uint64_t call_start = fbg_traceTime();
+
+        switch (op) {
+            case FBG_TRACE_DRAW:
+                fbg_draw(fbg);
+                break;
+            case FBG_TRACE_FLIP:
+                fbg_flip(fbg);
+                break;
+            case FBG_TRACE_RESIZE:
+                fbg_resize(fbg, ints[0], ints[1]);
+                break;
+            case FBG_TRACE_CLEAR:
+                fbg_clear(fbg, bytes[0]);
+                break;
+            case FBG_TRACE_BACKGROUND:
+                fbg_background(fbg, bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_FADE_DOWN:
+                fbg_fadeDown(fbg, bytes[0]);
+                break;
+            case FBG_TRACE_FADE_UP:
+                fbg_fadeUp(fbg, bytes[0]);
+                break;
+            case FBG_TRACE_FILL:
+                fbg_fill(fbg, bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_PIXEL:
+                fbg_pixel(fbg, ints[0], ints[1], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_PIXELA:
+                fbg_pixela(fbg, ints[0], ints[1], bytes[0], bytes[1], bytes[2], bytes[3]);
+                break;
+            case FBG_TRACE_FPIXEL:
+                fbg_fpixel(fbg, ints[0], ints[1]);
+                break;
+            case FBG_TRACE_HLINE:
+                fbg_hline(fbg, ints[0], ints[1], ints[2], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_VLINE:
+                fbg_vline(fbg, ints[0], ints[1], ints[2], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_LINE:
+                fbg_line(fbg, ints[0], ints[1], ints[2], ints[3], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_POLYGON:
+                fbg_polygon(fbg, ints[0], vertices, bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_RECT:
+                fbg_rect(fbg, ints[0], ints[1], ints[2], ints[3], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_RECTA:
+                fbg_recta(fbg, ints[0], ints[1], ints[2], ints[3], bytes[0], bytes[1], bytes[2], bytes[3]);
+                break;
+            case FBG_TRACE_FRECT:
+                fbg_frect(fbg, ints[0], ints[1], ints[2], ints[3]);
+                break;
+            case FBG_TRACE_TEXT_NEW:
+                fbg_text_new(fbg, text, ints[0], ints[1], ints[2], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_IMAGE:
+                fbg_image(fbg, img, ints[0], ints[1]);
+                break;
+            case FBG_TRACE_IMAGE_COLORKEY:
+                fbg_imageColorkey(fbg, img, ints[0], ints[1], ints[2], ints[3], ints[4]);
+                break;
+            case FBG_TRACE_IMAGE_CLIP:
+                fbg_imageClip(fbg, img, ints[0], ints[1], ints[2], ints[3], ints[4], ints[5]);
+                break;
+            case FBG_TRACE_IMAGE_EX:
+                fbg_imageEx(fbg, img, ints[0], ints[1], floats[0], floats[1], ints[2], ints[3], ints[4], ints[5]);
+                break;
+            case FBG_TRACE_ELLIPSE:
+                fbg_ellipseShape(fbg, ints[0], ints[1], ints[2], ints[3], ints[4], bytes[0], bytes[1], bytes[2], bytes[3]);
+                break;
+            case FBG_TRACE_ROUND_RECT:
+                fbg_roundRectShape(fbg, ints[0], ints[1], ints[2], ints[3], ints[4], ints[5], bytes[0], bytes[1], bytes[2], bytes[3]);
+                break;
+            case FBG_TRACE_SPAN:
+                fbg_span(fbg, ints[0], ints[1], ints[2], bytes[0], bytes[1], bytes[2]);
+                break;
+            case FBG_TRACE_SPANA:
+                fbg_spana(fbg, ints[0], ints[1], ints[2], bytes[0], bytes[1], bytes[2], bytes[3]);
+                break;
+            case FBG_TRACE_IMAGE_AFFINE:
+                fbg_imageAffine(fbg, img, floats[0], floats[1], floats[2], floats[3], floats[4], floats[5]);
+                break;
+            case FBG_TRACE_IMAGE_QUAD:
+                fbg_imageQuad(fbg, img, ints);
+                break;
+            case FBG_TRACE_UNTRACED:
+                // the recorded frame was written by a call which cannot be replayed
+                if (untraced_frames == 0) {
+                    fprintf(stderr, "fbg_traceReplay: frame %u use an untraced call (%s), its checksum can differ from the recording!\n", frames, text);
+                }
+
+                untraced_frames += 1;
+                break;
+        }
+
+        uint64_t call_time = fbg_traceTime() - call_start;
+        frame_time += call_time;
+
+        if (stats) {
+            stats->calls[op] += 1;
+            stats->time[op] += call_time;
+        }
+
+        if (op == FBG_TRACE_FLIP) {
+            if (frame_callback) {
+                frame_callback(fbg, frames, fbg_frameChecksum(fbg, fbg->disp_buffer), frame_time, user_data);
+            }
+
+            frames += 1;
+            frame_time = 0;
+        }
+    }
+
+    if (reader.error) {
+        fprintf(stderr, "fbg_traceReplay: '%s' is truncated or corrupted (after %u frames)!\n", path, frames);
+    }
+
+    if (untraced_frames > 1) {
+        fprintf(stderr, "fbg_traceReplay: %u frames use untraced calls!\n", untraced_frames);
+    }
+
+    if (stats) {
+        stats->frames = frames;
+        stats->total_time = fbg_traceTime() - replay_start;
+        stats->untraced_frames = untraced_frames;
+    }
+
+    for (uint32_t i = 0; i < images_count; i++) {
+        if (images[i]) {
+            fbg_freeImage(images[i]);
+        }
+    }
+
+    free(images);
+    free(vertices);
+    free(text);
+    free(file_data);
+
+    fbg_close(fbg);
+
+    return reader.error ? -1 : (int)frames;
+}
+
+void *fbg_assetAlloc(struct _fbg *fbg, size_t size) {
+    if (fbg->assets_arena) {
+        return fbg_arenaAlloc(fbg->assets_arena, size);
+    }
+
+    return calloc(1, size);
+}
+
+struct _fbg_pfont *fbg_createPFont(struct _fbg *fbg, unsigned char first_char, int glyphs_count, int line_height, const struct _fbg_glyph *glyphs, const uint32_t *bitmap, int bitmap_words) {
+    struct _fbg_pfont *font = (struct _fbg_pfont *)fbg_assetAlloc(fbg, sizeof(struct _fbg_pfont));
+    if (!font) {
+        fprintf(stderr, "fbg_createPFont: allocation failed!\n");
+
+        return NULL;
+    }
+
+    font->arena = fbg->assets_arena;
+
+    font->glyphs = (struct _fbg_glyph *)fbg_assetAlloc(fbg, glyphs_count * sizeof(struct _fbg_glyph));
+    font->bitmap = (uint32_t *)fbg_assetAlloc(fbg, _FBG_MAX(bitmap_words, 1) * sizeof(uint32_t));
+    if (!font->glyphs || !font->bitmap) {
+        fprintf(stderr, "fbg_createPFont (%i glyphs): allocation failed!\n", glyphs_count);
+
+        fbg_freePFont(font);
+
+        return NULL;
+    }
+
+    if (glyphs) {
+        memcpy(font->glyphs, glyphs, glyphs_count * sizeof(struct _fbg_glyph));
+    }
+
+    if (bitmap) {
+        memcpy(font->bitmap, bitmap, bitmap_words * sizeof(uint32_t));
+    }
+
+    font->first_char = first_char;
+    font->glyphs_count = glyphs_count;
+    font->line_height = line_height;
+
+    return font;
+}
+
+struct _fbg_pfont *fbg_createPFontFromBitmap(struct _fbg *fbg, const uint8_t *rows, int glyph_height, unsigned char first_char, int glyphs_count, int spacing) {
+    int i = 0, y = 0;
+
+    struct _fbg_pfont *font = fbg_createPFont(fbg, first_char, glyphs_count, glyph_height + spacing, NULL, NULL, glyphs_count * glyph_height);
+    if (!font) {
+        return NULL;
+    }
+
+    for (i = 0; i < glyphs_count; i += 1) {
+        const uint8_t *glyph_rows = &rows[i * glyph_height];
+        struct _fbg_glyph *glyph = &font->glyphs[i];
+
+        // horizontal extent of the glyph
+        uint8_t mask = 0;
+        for (y = 0; y < glyph_height; y += 1) {
+            mask |= glyph_rows[y];
+        }
+
+        glyph->offset = i * glyph_height;
+        glyph->height = glyph_height;
+
+        if (mask == 0) {
+            // blank glyph (space) : half a cell
+            glyph->advance = 4 + spacing;
+
+            continue;
+        }
+
+        int left = __builtin_clz((uint32_t)mask << 24);
+        int right = __builtin_ctz(mask);
+
+        glyph->width = 8 - left - right;
+        glyph->bearing_x = 0;
+        glyph->advance = glyph->width + spacing;
+
+        for (y = 0; y < glyph_height; y += 1) {
+            font->bitmap[glyph->offset + y] = (uint32_t)glyph_rows[y] << (24 + left);
+        }
+    }
+
+    return font;
+}
+
+struct _fbg_pfont *fbg_createDefaultPFont(struct _fbg *fbg) {
+    return fbg_createPFontFromBitmap(fbg, &font[0][0], FONT_HEIGHT, FONT_FIRST_CHAR, FONT_LAST_CHAR - FONT_FIRST_CHAR + 1, 1);
+}
+
+void fbg_pfontKerning(struct _fbg_pfont *font, unsigned char left, unsigned char right, int amount) {
+    int l = left - font->first_char;
+    int r = right - font->first_char;
+
+    if (l < 0 || l >= font->glyphs_count || r < 0 || r >= font->glyphs_count) {
+        return;
+    }
+
+    if (!font->kerning) {
+        // dense pairs table so that a kerning lookup is a single load
+        font->kerning = (int8_t *)calloc(font->glyphs_count * font->glyphs_count, sizeof(int8_t));
+        if (!font->kerning) {
+            fprintf(stderr, "fbg_pfontKerning: kerning table calloc failed!\n");
+
+            return;
+        }
+    }
+
+    font->kerning[l * font->glyphs_count + r] = amount;
+}
+
+int fbg_pfontTextWidth(struct _fbg_pfont *font, const char *text) {
+    int width = 0, max_width = 0;
+    int previous = -1;
+
+    for (; *text; text += 1) {
+        if (*text == '\n') {
+            max_width = _FBG_MAX(max_width, width);
+            width = 0;
+            previous = -1;
+
+            continue;
+        }
+
+        int index = (unsigned char)*text - font->first_char;
+        if (index < 0 || index >= font->glyphs_count) {
+            previous = -1;
+
+            continue;
+        }
+
+        if (font->kerning && previous >= 0) {
+            width += font->kerning[previous * font->glyphs_count + index];
+        }
+
+        width += font->glyphs[index].advance;
+
+        previous = index;
+    }
+
+    return _FBG_MAX(max_width, width);
+}
+
+void fbg_pfontText(struct _fbg *fbg, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    int pen_x = x;
+    int previous = -1;
+    int row = 0;
+
+    for (; *text; text += 1) {
+        if (*text == '\n') {
+            pen_x = x;
+            y += font->line_height;
+            previous = -1;
+
+            continue;
+        }
+
+        int index = (unsigned char)*text - font->first_char;
+        if (index < 0 || index >= font->glyphs_count) {
+            previous = -1;
+
+            continue;
+        }
+
+        if (font->kerning && previous >= 0) {
+            pen_x += font->kerning[previous * font->glyphs_count + index];
+        }
+
+        const struct _fbg_glyph *glyph = &font->glyphs[index];
+        const uint32_t *glyph_rows = &font->bitmap[glyph->offset];
+
+        int gx = pen_x + glyph->bearing_x;
+        int gy = y + glyph->bearing_y;
+
+        for (row = 0; row < glyph->height; row += 1) {
+            uint32_t bits = glyph_rows[row];
+
+            // one span per run of set bits (MSB = leftmost pixel)
+            while (bits) {
+                int start = __builtin_clz(bits);
+                uint32_t rest = ~(bits << start);
+                int run = rest ? __builtin_clz(rest) : 32 - start;
+
+                fbg_span(fbg, gx + start, gy + row, run, r, g, b);
+
+                bits &= (start + run >= 32) ? 0 : (0xffffffffu >> (start + run));
+            }
+        }
+
+        pen_x += glyph->advance;
+
+        previous = index;
+    }
+}
+
+void fbg_freePFont(struct _fbg_pfont *font) {
+    free(font->kerning);
+
+    if (font->arena) {
+        return;
+    }
+
+    free(font->glyphs);
+    free(font->bitmap);
+
+    free(font);
+}
+
+// area sampling of a 1-bit glyph : each destination pixel receive the covered fraction of its footprint in the source glyph
+void fbg_afontRasterize(const uint32_t *rows, int width, int height, float scale, uint8_t *coverage, int coverage_width, int coverage_height) {
+    int x = 0, y = 0, sx = 0, sy = 0;
+
+    float inv_scale = 1.0f / scale;
+    float area = inv_scale * inv_scale;
+
+    for (y = 0; y < coverage_height; y += 1) {
+        float y0 = y * inv_scale;
+        float y1 = y0 + inv_scale;
+
+        for (x = 0; x < coverage_width; x += 1) {
+            float x0 = x * inv_scale;
+            float x1 = x0 + inv_scale;
+
+            float sum = 0;
+
+            for (sy = (int)y0; sy < _FBG_MIN((int)ceilf(y1), height); sy += 1) {
+                float h = fminf(y1, sy + 1) - fmaxf(y0, sy);
+
+                for (sx = (int)x0; sx < _FBG_MIN((int)ceilf(x1), width); sx += 1) {
+                    if (rows[sy] & (0x80000000u >> sx)) {
+                        sum += h * (fminf(x1, sx + 1) - fmaxf(x0, sx));
+                    }
+                }
+            }
+
+            coverage[y * coverage_width + x] = (uint8_t)_FBG_MIN((int)(sum / area * 255.0f + 0.5f), 255);
+        }
+    }
+}
+
+struct _fbg_afont *fbg_createAFont(struct _fbg *fbg, struct _fbg_pfont *source, int pixel_height) {
+    int i = 0;
+
+    // the source line height maps to pixel_height
+    float scale = (float)pixel_height / (float)source->line_height;
+
+    struct _fbg_afont *font = (struct _fbg_afont *)fbg_assetAlloc(fbg, sizeof(struct _fbg_afont));
+    if (!font) {
+        fprintf(stderr, "fbg_createAFont: allocation failed!\n");
+
+        return NULL;
+    }
+
+    font->arena = fbg->assets_arena;
+    font->first_char = source->first_char;
+    font->glyphs_count = source->glyphs_count;
+    font->line_height = pixel_height;
+
+    font->glyphs = (struct _fbg_glyph *)fbg_assetAlloc(fbg, source->glyphs_count * sizeof(struct _fbg_glyph));
+    if (!font->glyphs) {
+        fprintf(stderr, "fbg_createAFont (%i px): glyphs allocation failed!\n", pixel_height);
+
+        fbg_freeAFont(font);
+
+        return NULL;
+    }
+
+    // metrics first so that the coverage masks are allocated at once
+    uint32_t coverage_size = 0;
+
+    for (i = 0; i < source->glyphs_count; i += 1) {
+        struct _fbg_glyph *src = &source->glyphs[i];
+        struct _fbg_glyph *dst = &font->glyphs[i];
+
+        dst->width = src->width ? _FBG_MIN((int)ceilf(src->width * scale), 255) : 0;
+        dst->height = src->width ? _FBG_MIN((int)ceilf(src->height * scale), 255) : 0;
+        dst->bearing_x = (int8_t)lroundf(src->bearing_x * scale);
+        dst->bearing_y = (int8_t)lroundf(src->bearing_y * scale);
+        dst->advance = _FBG_MIN((int)lroundf(src->advance * scale), 255);
+        dst->offset = coverage_size;
+
+        coverage_size += dst->width * dst->height;
+    }
+
+    font->coverage = (uint8_t *)fbg_assetAlloc(fbg, _FBG_MAX(coverage_size, 1));
+    if (!font->coverage) {
+        fprintf(stderr, "fbg_createAFont (%i px): coverage allocation failed!\n", pixel_height);
+
+        fbg_freeAFont(font);
+
+        return NULL;
+    }
+
+    for (i = 0; i < source->glyphs_count; i += 1) {
+        struct _fbg_glyph *src = &source->glyphs[i];
+        struct _fbg_glyph *dst = &font->glyphs[i];
+
+        if (dst->width) {
+            fbg_afontRasterize(&source->bitmap[src->offset], src->width, src->height, scale, &font->coverage[dst->offset], dst->width, dst->height);
+        }
+    }
+
+    if (source->kerning) {
+        int pairs = source->glyphs_count * source->glyphs_count;
+
+        font->kerning = (int8_t *)calloc(pairs, sizeof(int8_t));
+        if (font->kerning) {
+            for (i = 0; i < pairs; i += 1) {
+                font->kerning[i] = (int8_t)lroundf(source->kerning[i] * scale);
+            }
+        }
+    }
+
+    return font;
+}
+
+typedef uint8_t fbg_v8u8 __attribute__((vector_size(8)));
+typedef uint16_t fbg_v8u16 __attribute__((vector_size(16)));
+
+void fbg_maskBlend(struct _fbg *fbg, const uint8_t *mask, int mask_stride, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_maskBlend")
+
+    int xx = 0, yy = 0;
+
+    // clip against the display
+    if (x < 0) {
+        mask -= x;
+        w += x;
+        x = 0;
+    }
+
+    if (y < 0) {
+        mask -= y * mask_stride;
+        h += y;
+        y = 0;
+    }
+
+    w = _FBG_MIN(w, fbg->width - x);
+    h = _FBG_MIN(h, fbg->height - y);
+
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    unsigned char color[4] = { r, g, b, 0 };
+
+    const fbg_v8u16 vcolor = { r, g, b, 0, r, g, b, 0 };
+
+    for (yy = 0; yy < h; yy += 1) {
+        const uint8_t *mask_pointer = mask + yy * mask_stride;
+        unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + ((y + yy) * fbg->line_length + x * fbg->components));
+
+        xx = 0;
+
+        if (fbg->components == 4) {
+            // two pixels at a time : out = (color * a + dst * (255 - a) + 255) >> 8 on 16 bits lanes, the 4th component is blended with a = 0 (unchanged, as the scalar loop)
+            for (; xx + 2 <= w; xx += 2) {
+                uint8_t a0 = mask_pointer[xx], a1 = mask_pointer[xx + 1];
+
+                if ((a0 | a1) != 0) {
+                    fbg_v8u8 dst8;
+                    memcpy(&dst8, pix_pointer, 8);
+
+                    fbg_v8u16 dst = __builtin_convertvector(dst8, fbg_v8u16);
+                    fbg_v8u16 alpha = { a0, a0, a0, 0, a1, a1, a1, 0 };
+
+                    dst = (vcolor * alpha + dst * (255 - alpha) + 255) >> 8;
+
+                    dst8 = __builtin_convertvector(dst, fbg_v8u8);
+                    memcpy(pix_pointer, &dst8, 8);
+                }
+
+                pix_pointer += 8;
+            }
+        }
+
+        for (; xx < w; xx += 1) {
+            int a = mask_pointer[xx];
+
+            if (a == 255) {
+                memcpy(pix_pointer, color, 3);
+            } else if (a) {
+                pix_pointer[0] = (r * a + pix_pointer[0] * (255 - a) + 255) >> 8;
+                pix_pointer[1] = (g * a + pix_pointer[1] * (255 - a) + 255) >> 8;
+                pix_pointer[2] = (b * a + pix_pointer[2] * (255 - a) + 255) >> 8;
+            }
+
+            pix_pointer += fbg->components;
+        }
+    }
+}
+
+int fbg_afontTextWidth(struct _fbg_afont *font, const char *text) {
+    int width = 0, max_width = 0;
+    int previous = -1;
+
+    for (; *text; text += 1) {
+        if (*text == '\n') {
+            max_width = _FBG_MAX(max_width, width);
+            width = 0;
+            previous = -1;
+
+            continue;
+        }
+
+        int index = (unsigned char)*text - font->first_char;
+        if (index < 0 || index >= font->glyphs_count) {
+            previous = -1;
+
+            continue;
+        }
+
+        if (font->kerning && previous >= 0) {
+            width += font->kerning[previous * font->glyphs_count + index];
+        }
+
+        width += font->glyphs[index].advance;
+
+        previous = index;
+    }
+
+    return _FBG_MAX(max_width, width);
+}
+
+void fbg_afontText(struct _fbg *fbg, struct _fbg_afont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b) {
+    int pen_x = x;
+    int previous = -1;
+
+    for (; *text; text += 1) {
+        if (*text == '\n') {
+            pen_x = x;
+            y += font->line_height;
+            previous = -1;
+
+            continue;
+        }
+
+        int index = (unsigned char)*text - font->first_char;
+        if (index < 0 || index >= font->glyphs_count) {
+            previous = -1;
+
+            continue;
+        }
+
+        if (font->kerning && previous >= 0) {
+            pen_x += font->kerning[previous * font->glyphs_count + index];
+        }
+
+        const struct _fbg_glyph *glyph = &font->glyphs[index];
+
+        if (glyph->width) {
+            fbg_maskBlend(fbg, &font->coverage[glyph->offset], glyph->width, pen_x + glyph->bearing_x, y + glyph->bearing_y, glyph->width, glyph->height, r, g, b);
+        }
+
+        pen_x += glyph->advance;
+
+        previous = index;
+    }
+}
+
+void fbg_freeAFont(struct _fbg_afont *font) {
+    free(font->kerning);
+
+    if (font->arena) {
+        return;
+    }
+
+    free(font->glyphs);
+    free(font->coverage);
+
+    free(font);
+}
+
+struct _fbg_img *fbg_createImage(struct _fbg *fbg, unsigned int width, unsigned int height) {
+    struct _fbg_arena *arena = fbg->assets_arena;
+
+    // image dimensions can come from decoded headers, the size must not overflow
+    if (height && width > FBG_IMAGE_MAX_SIZE / height / fbg->components) {
+        fprintf(stderr, "fbg_createImage (%ux%u): image too large!\n", width, height);
+
+        return NULL;
+    }
+
+    size_t size = (size_t)width * height * fbg->components;
+
+    if (arena) {
+        struct _fbg_img *img = (struct _fbg_img *)fbg_arenaAlloc(arena, sizeof(struct _fbg_img));
+        if (!img) {
+            fprintf(stderr, "fbg_createImage : arena allocation failed!\n");
+
+            return NULL;
+        }
+
+        img->data = fbg_arenaAllocAligned(arena, size * sizeof(char), FBG_BUFFER_ALIGNMENT);
+        if (!img->data) {
+            fprintf(stderr, "fbg_createImage (%ix%i): arena allocation failed!\n", width, height);
+
+            return NULL;
+        }
+
+        img->width = width;
+        img->height = height;
+        img->components = fbg->components;
+        img->arena = arena;
+
+        return img;
+    }
+
+    struct _fbg_img *img = (struct _fbg_img *)calloc(1, sizeof(struct _fbg_img));
+    if (!img) {
+        fprintf(stderr, "fbg_createImage : calloc failed!\n");
+
+        return NULL;
+    }
+
+    img->data = fbg_alignedAlloc(size * sizeof(char));
+    if (!img->data) {
+        fprintf(stderr, "fbg_createImage (%ix%i): allocation failed!\n", width, height);
+
+        free(img);
+
+        return NULL;
+    }
+
+    img->width = width;
+    img->height = height;
+    img->components = fbg->components;
+
+    return img;
+}
+
+int fbg_rectsInside(const void *rects, unsigned int rects_count, unsigned int width, unsigned int height) {
+    unsigned int i = 0;
+
+    for (i = 0; i < rects_count; i += 1) {
+        // the rectangles can be unaligned (raw images loaded from memory)
+        struct _fbg_rect rect;
+        memcpy(&rect, (const unsigned char *)rects + i * sizeof(struct _fbg_rect), sizeof(struct _fbg_rect));
+
+        if (rect.x < 0 || rect.y < 0 || rect.w < 0 || rect.h < 0 ||
+            (int64_t)rect.x + rect.w > width || (int64_t)rect.y + rect.h > height) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+const struct _fbg_raw_header *fbg_rawHeader(struct _fbg *fbg, const unsigned char *data, size_t size) {
+    const struct _fbg_raw_header *header = (const struct _fbg_raw_header *)data;
+
+    if (size < sizeof(struct _fbg_raw_header) || memcmp(header->magic, FBG_RAW_MAGIC, 4) != 0) {
+        return NULL;
+    }
+
+    if (header->version != FBG_RAW_VERSION) {
+        fprintf(stderr, "fbg_rawHeader: unsupported version %i!\n", header->version);
+
+        return NULL;
+    }
+
+    if (header->components != fbg->components) {
+        fprintf(stderr, "fbg_rawHeader: image components (%i) does not match the context components (%i)!\n", header->components, fbg->components);
+
+        return NULL;
+    }
 
-void fbg_text_new(struct _fbg *fbg, const char *text, int x, int y, int font_size, uint8_t r, uint8_t g, uint8_t b) {
-  int char_width = FONT_WIDTH * font_size;   // Calculate scaled character width
-  int char_height = FONT_HEIGHT * font_size; // Calculate scaled character height
+    size_t rects_end = sizeof(struct _fbg_raw_header) + (size_t)header->rects_count * sizeof(struct _fbg_rect);
+    size_t data_size = (size_t)header->width * header->height * header->components;
 
-  while (*text) {
-    char c = *text++;
+    if (rects_end > header->data_offset || header->data_offset > size || data_size > size - header->data_offset) {
+        fprintf(stderr, "fbg_rawHeader: truncated image data!\n");
 
-    // Only render printable ASCII characters (32 to 126)
-    if (c < 32 || c > 126) {
-      continue;
+        return NULL;
     }
 
-    // Get the character's bitmap from the font array
-    const uint8_t *char_bitmap = font[c - FONT_FIRST_CHAR];
+    if (!fbg_rectsInside(data + sizeof(struct _fbg_raw_header), header->rects_count, header->width, header->height)) {
+        fprintf(stderr, "fbg_rawHeader: atlas rectangle outside of the image!\n");
 
-    // Render the character
-    for (int row = 0; row < FONT_HEIGHT; row++) {  // Iterate over original character height
-      for (int col = 0; col < FONT_WIDTH; col++) { // Iterate over original character width
-        if (char_bitmap[row] & (1 << (7 - col))) {
-          // Scale the pixel by `font_size`
-          for (int dy = 0; dy < font_size; dy++) {   // Scale vertically
-            for (int dx = 0; dx < font_size; dx++) { // Scale horizontally
-              fbg_pixel(fbg, x + col * font_size + dx, y + row * font_size + dy, r, g, b);
-            }
-          }
-        }
-      }
+        return NULL;
     }
 
-    // Move the x position for the next character
-    x += char_width;
-  }
+    return header;
 }
 
-  void fbg_freeFont(struct _fbg_font * font) {
-    free(font->glyph_coord_x);
-    free(font->glyph_coord_y);
+struct _fbg_img *fbg_rawImage(struct _fbg *fbg, unsigned char *data, size_t size) {
+    const struct _fbg_raw_header *header = fbg_rawHeader(fbg, data, size);
+    if (!header) {
+        return NULL;
+    }
 
-    free(font);
+    struct _fbg_img *img = (struct _fbg_img *)calloc(1, sizeof(struct _fbg_img));
+    if (!img) {
+        fprintf(stderr, "fbg_rawImage: calloc failed!\n");
+
+        return NULL;
+    }
+
+    img->data = data + header->data_offset;
+    img->width = header->width;
+    img->height = header->height;
+    img->components = header->components;
+
+    if (header->rects_count) {
+        img->rects = (struct _fbg_rect *)(data + sizeof(struct _fbg_raw_header));
+        img->rects_count = header->rects_count;
+    }
+
+    return img;
 }
 
-struct _fbg_img *fbg_createImage(struct _fbg *fbg, unsigned int width, unsigned int height) {
+struct _fbg_img *fbg_rawImageCopy(struct _fbg *fbg, const unsigned char *data, size_t size) {
+    const struct _fbg_raw_header *header = fbg_rawHeader(fbg, data, size);
+    if (!header) {
+        return NULL;
+    }
+
+    // the caller data can be read-only (or go away), the pixels and the atlas rectangles are copied into a single block freed along with the image
+    size_t data_size = _FBG_ALIGN((size_t)header->width * header->height * header->components, sizeof(struct _fbg_rect));
+    size_t rects_size = (size_t)header->rects_count * sizeof(struct _fbg_rect);
+
     struct _fbg_img *img = (struct _fbg_img *)calloc(1, sizeof(struct _fbg_img));
     if (!img) {
-        fprintf(stderr, "fbg_createImage : calloc failed!\n");
+        fprintf(stderr, "fbg_rawImageCopy: calloc failed!\n");
+
+        return NULL;
     }
 
-    img->data = calloc(1, (width * height * fbg->components) * sizeof(char));
+    img->data = fbg_alignedAlloc(data_size + rects_size);
     if (!img->data) {
-        fprintf(stderr, "fbg_createImage (%ix%i): calloc failed!\n", width, height);
+        fprintf(stderr, "fbg_rawImageCopy (%ix%i): allocation failed!\n", header->width, header->height);
 
         free(img);
 
         return NULL;
     }
 
-    img->width = width;
-    img->height = height;
+    memcpy(img->data, data + header->data_offset, (size_t)header->width * header->height * header->components);
+    img->width = header->width;
+    img->height = header->height;
+    img->components = header->components;
+
+    if (header->rects_count) {
+        img->rects = (struct _fbg_rect *)(img->data + data_size);
+        img->rects_count = header->rects_count;
+
+        memcpy(img->rects, data + sizeof(struct _fbg_raw_header), rects_size);
+    }
+
+    return img;
+}
+
+#ifndef WITHOUT_PNG
+struct _fbg_png_source {
+    const unsigned char *data;
+    size_t size;
+    size_t offset;
+};
+
+void fbg_pngReadMemory(png_structp png, png_bytep out, png_size_t length) {
+    struct _fbg_png_source *source = (struct _fbg_png_source *)png_get_io_ptr(png);
+
+    if (length > source->size - source->offset) {
+        png_error(png, "unexpected end of data");
+    }
+
+    memcpy(out, source->data + source->offset, length);
+
+    source->offset += length;
+}
+
+// decode rows straight into the image (converted to the context format by libpng transforms), no intermediate image is allocated
+struct _fbg_img *fbg_pngDecode(struct _fbg *fbg, FILE *file, struct _fbg_png_source *source) {
+    struct _fbg_img *volatile img = NULL;
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!png) {
+        fprintf(stderr, "fbg_pngDecode: png_create_read_struct failed!\n");
+
+        return NULL;
+    }
+
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        fprintf(stderr, "fbg_pngDecode: png_create_info_struct failed!\n");
+
+        png_destroy_read_struct(&png, NULL, NULL);
+
+        return NULL;
+    }
+
+    if (setjmp(png_jmpbuf(png))) {
+        fprintf(stderr, "fbg_pngDecode: decoding failed!\n");
+
+        png_destroy_read_struct(&png, &info, NULL);
+
+        if (img) {
+            fbg_freeImage(img);
+        }
+
+        return NULL;
+    }
+
+    if (file) {
+        png_init_io(png, file);
+    } else {
+        png_set_read_fn(png, source, fbg_pngReadMemory);
+    }
+
+    png_read_info(png, info);
+
+    png_uint_32 width = png_get_image_width(png, info);
+    png_uint_32 height = png_get_image_height(png, info);
+    int color_type = png_get_color_type(png, info);
+
+    png_set_strip_16(png);
+    png_set_packing(png);
+
+    if (color_type == PNG_COLOR_TYPE_PALETTE) {
+        png_set_palette_to_rgb(png);
+    }
+
+    if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        png_set_expand_gray_1_2_4_to_8(png);
+        png_set_gray_to_rgb(png);
+    }
+
+    if (fbg->components == 4) {
+        if (png_get_valid(png, info, PNG_INFO_tRNS)) {
+            png_set_tRNS_to_alpha(png);
+        }
+
+        png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+    } else {
+        png_set_strip_alpha(png);
+    }
+
+    int passes = png_set_interlace_handling(png);
+
+    png_read_update_info(png, info);
+
+    if (png_get_rowbytes(png, info) != (size_t)width * fbg->components) {
+        fprintf(stderr, "fbg_pngDecode: unsupported pixel format!\n");
+
+        png_destroy_read_struct(&png, &info, NULL);
+
+        return NULL;
+    }
+
+    img = fbg_createImage(fbg, width, height);
+    if (!img) {
+        png_destroy_read_struct(&png, &info, NULL);
+
+        return NULL;
+    }
+
+    int pass = 0;
+    png_uint_32 y = 0;
+    for (pass = 0; pass < passes; pass += 1) {
+        for (y = 0; y < height; y += 1) {
+            png_read_row(png, img->data + (size_t)y * width * fbg->components, NULL);
+        }
+    }
+
+    png_read_end(png, NULL);
+
+    png_destroy_read_struct(&png, &info, NULL);
+
+    return img;
+}
+
+struct _fbg_img *fbg_loadPNG(struct _fbg *fbg, const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "fbg_loadPNG: Cannot open '%s'!\n", filename);
+
+        return NULL;
+    }
+
+    struct _fbg_img *img = fbg_pngDecode(fbg, file, NULL);
+
+    fclose(file);
 
     return img;
 }
 
-struct _fbg_img *fbg_loadImageFromMemory(struct _fbg *fbg, const unsigned char *data, int size) {
-    struct _fbg_img *img = NULL;
+struct _fbg_img *fbg_loadPNGFromMemory(struct _fbg *fbg, const unsigned char *data, int size) {
+    struct _fbg_png_source source = { data, size, 0 };
+
+    return fbg_pngDecode(fbg, NULL, &source);
+}
+#endif
+
+#ifndef WITHOUT_JPEG
+struct _fbg_jpeg_error {
+    struct jpeg_error_mgr mgr;
+
+    jmp_buf jmp;
+};
+
+void fbg_jpegErrorExit(j_common_ptr cinfo) {
+    struct _fbg_jpeg_error *error = (struct _fbg_jpeg_error *)cinfo->err;
+
+    (*cinfo->err->output_message)(cinfo);
+
+    longjmp(error->jmp, 1);
+}
+
+// decode scanlines straight into the image, libjpeg perform the color conversion and the DCT domain downscaling
+struct _fbg_img *fbg_jpegDecode(struct _fbg *fbg, FILE *file, const unsigned char *data, int size, int scale_denom) {
+    struct jpeg_decompress_struct cinfo;
+    struct _fbg_jpeg_error error;
+
+    struct _fbg_img *volatile img = NULL;
+
+    cinfo.err = jpeg_std_error(&error.mgr);
+    error.mgr.error_exit = fbg_jpegErrorExit;
+
+    if (setjmp(error.jmp)) {
+        fprintf(stderr, "fbg_jpegDecode: decoding failed!\n");
+
+        jpeg_destroy_decompress(&cinfo);
+
+        if (img) {
+            fbg_freeImage(img);
+        }
+
+        return NULL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+
+    if (file) {
+        jpeg_stdio_src(&cinfo, file);
+    } else {
+        jpeg_mem_src(&cinfo, (unsigned char *)data, size);
+    }
+
+    jpeg_read_header(&cinfo, TRUE);
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = _FBG_MAX(scale_denom, 1);
+
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = (fbg->components == 4) ? JCS_EXT_RGBX : JCS_RGB;
+#else
+    cinfo.out_color_space = JCS_RGB;
+#endif
+
+    jpeg_start_decompress(&cinfo);
+
+    img = fbg_createImage(fbg, cinfo.output_width, cinfo.output_height);
+    if (!img) {
+        jpeg_destroy_decompress(&cinfo);
+
+        return NULL;
+    }
+
+    size_t line_length = (size_t)img->width * fbg->components;
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        unsigned char *row = img->data + (size_t)cinfo.output_scanline * line_length;
+
+        jpeg_read_scanlines(&cinfo, &row, 1);
+
+        if (cinfo.output_components != fbg->components) {
+            // expand RGB to the context format in place (backward so that no data is overwritten)
+            int x = 0;
+            for (x = img->width - 1; x >= 0; x -= 1) {
+                unsigned char *src = row + x * cinfo.output_components;
+                unsigned char *dst = row + x * fbg->components;
+
+                dst[3] = 255;
+                dst[2] = src[2];
+                dst[1] = src[1];
+                dst[0] = src[0];
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    return img;
+}
+
+struct _fbg_img *fbg_loadJPEGEx(struct _fbg *fbg, const char *filename, int scale_denom) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "fbg_loadJPEG: Cannot open '%s'!\n", filename);
+
+        return NULL;
+    }
+
+    struct _fbg_img *img = fbg_jpegDecode(fbg, file, NULL, 0, scale_denom);
+
+    fclose(file);
+
+    return img;
+}
+
+struct _fbg_img *fbg_loadJPEGFromMemoryEx(struct _fbg *fbg, const unsigned char *data, int size, int scale_denom) {
+    return fbg_jpegDecode(fbg, NULL, data, size, scale_denom);
+}
+#endif
+
+struct _fbg_img *fbg_loadImageFromMemory(struct _fbg *fbg, const unsigned char *data, int size) {
+    struct _fbg_img *img = NULL;
+
+    if (size < 0) {
+        fprintf(stderr, "fbg_loadImageFromMemory: invalid size (%i)!\n", size);
+
+        return NULL;
+    }
+
+    if (size >= 4 && memcmp(data, FBG_RAW_MAGIC, 4) == 0) {
+        return fbg_rawImageCopy(fbg, data, size);
+    }
+
+#ifndef WITHOUT_PNG
+    if (size >= 8 && png_sig_cmp((png_const_bytep)data, 0, 8) == 0) {
+        return fbg_loadPNGFromMemory(fbg, data, size);
+    }
+#endif
+
+#ifndef WITHOUT_JPEG
+    if (size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff) {
+        return fbg_loadJPEGFromMemory(fbg, data, size);
+    }
+#endif
+
+    fprintf(stderr, "fbg_loadImageFromMemory: unsupported image format!\n");
+
+    return img;
+}
+
+struct _fbg_img *fbg_loadImage(struct _fbg *fbg, const char *filename) {
+    unsigned char signature[8] = { 0 };
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "fbg_loadImage: Cannot open '%s'!\n", filename);
+
+        return NULL;
+    }
+
+    size_t length = fread(signature, 1, sizeof(signature), file);
+
+    fclose(file);
+
+    if (length >= 4 && memcmp(signature, FBG_RAW_MAGIC, 4) == 0) {
+        return fbg_loadRawImage(fbg, filename);
+    }
+
+#ifndef WITHOUT_PNG
+    if (length == 8 && png_sig_cmp(signature, 0, 8) == 0) {
+        return fbg_loadPNG(fbg, filename);
+    }
+#endif
+
+#ifndef WITHOUT_JPEG
+    if (length >= 3 && signature[0] == 0xff && signature[1] == 0xd8 && signature[2] == 0xff) {
+        return fbg_loadJPEG(fbg, filename);
+    }
+#endif
+
+    fprintf(stderr, "fbg_loadImage: '%s' unsupported image format!\n", filename);
+
+    return NULL;
+}
+
+struct _fbg_img *fbg_loadRawImage(struct _fbg *fbg, const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "fbg_loadRawImage: Cannot open '%s'!\n", filename);
+
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(struct _fbg_raw_header)) {
+        fprintf(stderr, "fbg_loadRawImage: '%s' is not a raw image!\n", filename);
+
+        close(fd);
+
+        return NULL;
+    }
+
+    // private mapping so that in-place image operations (fbg_imageFlip etc.) never reach the file
+    unsigned char *mapping = (unsigned char *)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "fbg_loadRawImage: '%s' mmap failed!\n", filename);
+
+        return NULL;
+    }
+
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+
+    struct _fbg_img *img = fbg_rawImage(fbg, mapping, st.st_size);
+    if (!img) {
+        fprintf(stderr, "fbg_loadRawImage: '%s' is not a valid raw image!\n", filename);
+
+        munmap(mapping, st.st_size);
+
+        return NULL;
+    }
+
+    img->mapping = mapping;
+    img->mapping_size = st.st_size;
+
+    return img;
+}
+
+int fbg_saveRawImage(struct _fbg *fbg, struct _fbg_img *img, const struct _fbg_rect *rects, unsigned int rects_count, const char *filename) {
+    struct _fbg_raw_header header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.magic, FBG_RAW_MAGIC, 4);
+    header.version = FBG_RAW_VERSION;
+    header.components = fbg->components;
+    header.width = img->width;
+    header.height = img->height;
+    header.rects_count = rects ? rects_count : 0;
+    // pixel rows start aligned as the mapping itself is page aligned
+    header.data_offset = _FBG_ALIGN(sizeof(header) + header.rects_count * sizeof(struct _fbg_rect), FBG_BUFFER_ALIGNMENT);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "fbg_saveRawImage: Cannot open '%s'!\n", filename);
+
+        return 0;
+    }
+
+    static const unsigned char padding[FBG_BUFFER_ALIGNMENT] = { 0 };
+
+    size_t header_size = sizeof(header) + header.rects_count * sizeof(struct _fbg_rect);
+    size_t data_size = (size_t)img->width * img->height * fbg->components;
+
+    int success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        (header.rects_count == 0 || fwrite(rects, sizeof(struct _fbg_rect), header.rects_count, file) == header.rects_count) &&
+        fwrite(padding, 1, header.data_offset - header_size, file) == header.data_offset - header_size &&
+        fwrite(img->data, 1, data_size, file) == data_size;
 
-    // TODO: Implement fbg_loadPNGFromMemory()
-    // TODO: Implement fbg_loadJPEGFromMemory()
+    if (fclose(file) != 0) {
+        success = 0;
+    }
 
-    return img;
+    if (!success) {
+        fprintf(stderr, "fbg_saveRawImage: '%s' write failed!\n", filename);
+    }
+
+    return success;
 }
 
 void fbg_image(struct _fbg *fbg, struct _fbg_img *img, int x, int y) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE, img, x, y)
+
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length) + x * fbg->components);
     unsigned char *img_pointer = img->data;
 
@@ -748,6 +5094,8 @@ void fbg_image(struct _fbg *fbg, struct _fbg_img *img, int x, int y) {
 }
 
 void fbg_imageColorkey(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cr, int cg, int cb) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE_COLORKEY, img, x, y, cr, cg, cb)
+
     unsigned char *img_pointer = img->data;
 
     int i = 0, j = 0;
@@ -775,16 +5123,37 @@ void fbg_imageColorkey(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int
 }
 
 void fbg_imageClip(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cx, int cy, int cw, int ch) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE_CLIP, img, x, y, cx, cy, cw, ch)
+
+    // clip against the display
+    if (x < 0) {
+        cx -= x;
+        cw += x;
+        x = 0;
+    }
+
+    if (y < 0) {
+        cy -= y;
+        ch += y;
+        y = 0;
+    }
+
+    cw = _FBG_MIN(cw, fbg->width - x);
+    ch = _FBG_MIN(ch, fbg->height - y);
+
+    if (cw <= 0 || ch <= 0) {
+        return;
+    }
+
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
     unsigned char *img_pointer = (unsigned char *)(img->data + (cy * img->width * fbg->components));
 
     img_pointer += cx * fbg->components;
 
     int i = 0;
-    int w3 = _FBG_MIN((cw - cx) * fbg->components, (fbg->width - x) * fbg->components);
-    int h = ch - cy;
+    int w3 = cw * fbg->components;
 
-    for (i = 0; i < h; i += 1) {
+    for (i = 0; i < ch; i += 1) {
         memcpy(pix_pointer, img_pointer, w3);
         pix_pointer += fbg->line_length;
         img_pointer += img->width * fbg->components;
@@ -792,21 +5161,27 @@ void fbg_imageClip(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cx,
 }
 
 void fbg_imageFlip(struct _fbg_img *img) {
-    int height_m1 = img->height - 1;
-    int height_d2 = img->height >> 1;
+    size_t row_length = img->width * img->components;
 
-    int i, j;
-    for (i = 0; i < height_d2; i += 1) {
-        int fy = (height_m1 - i) * img->width;
-        int y = i * img->width;
+    unsigned char *top = img->data;
+    unsigned char *bottom = img->data + (img->height - 1) * row_length;
 
-        for (j = 0; j < img->width; j += 1) {
-            img->data[y + j] = img->data[fy + j];
+    // swap the rows pairwise, the middle row (odd height) stay in place
+    while (top < bottom) {
+        for (size_t i = 0; i < row_length; i += 1) {
+            unsigned char tmp = top[i];
+            top[i] = bottom[i];
+            bottom[i] = tmp;
         }
+
+        top += row_length;
+        bottom -= row_length;
     }
 }
 
 void fbg_imageEx(struct _fbg *fbg, struct _fbg_img *img, int x, int y, float sx, float sy, int cx, int cy, int cw, int ch) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE_EX, img, x, y, sx, sy, cx, cy, cw, ch)
+
     float x_ratio_inv = 1.0f / sx;
     float y_ratio_inv = 1.0f / sy;
 
@@ -823,14 +5198,21 @@ void fbg_imageEx(struct _fbg *fbg, struct _fbg_img *img, int x, int y, float sx,
         w2 -= (d - (fbg->width - x));
     }
 
+    d = h2 - cy2;
+
+    if (d >= (fbg->height - y)) {
+        h2 -= (d - (fbg->height - y));
+    }
+
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
     for (i = cy2; i < h2; i += 1) {
-        py = floorf(x_ratio_inv * (float)i);
+        // clamped so that rounding never reach outside of the clipped area
+        py = _FBG_MIN((int)floorf(y_ratio_inv * (float)i), cy + ch - 1);
 
         for (j = cx2; j < w2; j += 1) {
-            px = floorf(y_ratio_inv * (float)j);
-            
+            px = _FBG_MIN((int)floorf(x_ratio_inv * (float)j), cx + cw - 1);
+
             unsigned char *img_pointer = (unsigned char *)(img->data + ((px + py * img->width) * fbg->components));
 
             memcpy(pix_pointer, img_pointer, fbg->components);
@@ -842,13 +5224,614 @@ void fbg_imageEx(struct _fbg *fbg, struct _fbg_img *img, int x, int y, float sx,
     }
 }
 
+struct _fbg_affine_job {
+    struct _fbg_img *img;
+    // clipped destination bounds
+    int x;
+    int y;
+    int w;
+    int h;
+    // 16.16 texture coordinates of the (x, y) pixel center then their steps along X / Y
+    int64_t u;
+    int64_t v;
+    int64_t du_dx;
+    int64_t dv_dx;
+    int64_t du_dy;
+    int64_t dv_dy;
+};
+
+void fbg_imageAffineRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_affine_job *job = (struct _fbg_affine_job *)user_data;
+    struct _fbg_img *img = job->img;
+
+    int64_t limit_u = (int64_t)img->width << 16, limit_v = (int64_t)img->height << 16;
+
+    int y1 = _FBG_MAX(y_start, job->y), y2 = _FBG_MIN(y_end, job->y + job->h);
+
+    int y;
+    for (y = y1; y < y2; y += 1) {
+        int64_t u = job->u + (y - job->y) * job->du_dy;
+        int64_t v = job->v + (y - job->y) * job->dv_dy;
+
+        // the pixels mapped within the image, no per pixel bound check
+        int lo, hi, lo_v, hi_v;
+        fbg_stepRange(u, job->du_dx, limit_u, job->w, &lo, &hi);
+        fbg_stepRange(v, job->dv_dx, limit_v, job->w, &lo_v, &hi_v);
+
+        lo = _FBG_MAX(lo, lo_v);
+        hi = _FBG_MIN(hi, hi_v);
+
+        u += lo * job->du_dx;
+        v += lo * job->dv_dx;
+
+        unsigned char *pix_pointer = fbg->back_buffer + y * fbg->line_length + (job->x + lo) * fbg->components;
+
+        int i;
+        for (i = lo; i < hi; i += 1) {
+            memcpy(pix_pointer, img->data + ((v >> 16) * img->width + (u >> 16)) * fbg->components, fbg->components);
+
+            pix_pointer += fbg->components;
+
+            u += job->du_dx;
+            v += job->dv_dx;
+        }
+    }
+}
+
+void fbg_imageAffine(struct _fbg *fbg, struct _fbg_img *img, float a, float b, float c, float d, float tx, float ty) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE_AFFINE, img, a, b, c, d, tx, ty)
+
+    double det = (double)a * d - (double)b * c;
+    if (!(fabs(det) >= 1e-6)) {
+        return;
+    }
+
+    // destination bounds : the transformed image corners
+    double w = img->width, h = img->height;
+    double xs[4] = { tx, a * w + tx, b * h + tx, a * w + b * h + tx };
+    double ys[4] = { ty, c * w + ty, d * h + ty, c * w + d * h + ty };
+
+    double min_x = xs[0], max_x = xs[0], min_y = ys[0], max_y = ys[0];
+
+    int i;
+    for (i = 1; i < 4; i += 1) {
+        min_x = _FBG_MIN(min_x, xs[i]);
+        max_x = _FBG_MAX(max_x, xs[i]);
+        min_y = _FBG_MIN(min_y, ys[i]);
+        max_y = _FBG_MAX(max_y, ys[i]);
+    }
+
+    struct _fbg_affine_job job;
+    job.img = img;
+    job.x = (int)_FBG_MAX(_FBG_MIN(floor(min_x), (double)fbg->width), 0.0);
+    job.y = (int)_FBG_MAX(_FBG_MIN(floor(min_y), (double)fbg->height), 0.0);
+    job.w = (int)_FBG_MAX(_FBG_MIN(ceil(max_x), (double)fbg->width), 0.0) - job.x;
+    job.h = (int)_FBG_MAX(_FBG_MIN(ceil(max_y), (double)fbg->height), 0.0) - job.y;
+
+    if (job.w <= 0 || job.h <= 0) {
+        return;
+    }
+
+    // inverse transform in 16.16 fixed point, the texture coordinates are then stepped incrementally
+    double px = job.x + 0.5 - tx, py = job.y + 0.5 - ty;
+
+    job.u = llround((d * px - b * py) / det * 65536);
+    job.v = llround((a * py - c * px) / det * 65536);
+    job.du_dx = llround(d / det * 65536);
+    job.dv_dx = llround(-c / det * 65536);
+    job.du_dy = llround(-b / det * 65536);
+    job.dv_dy = llround(a / det * 65536);
+
+    fbg_parallelRows(fbg, fbg_imageAffineRows, &job);
+}
+
+void fbg_imageRotate(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int pivot_x, int pivot_y, float angle, float scale) {
+    float cs = cosf(angle) * scale, sn = sinf(angle) * scale;
+
+    fbg_imageAffine(fbg, img, cs, -sn, sn, cs, x - cs * pivot_x + sn * pivot_y, y - sn * pivot_x - cs * pivot_y);
+}
+
+struct _fbg_quad_job {
+    struct _fbg_img *img;
+    // quad vertices
+    double vx[4];
+    double vy[4];
+    // display to unit square (homogeneous) transform
+    double m[9];
+    // clipped rows
+    int y;
+    int h;
+};
+
+// 16.16 texture coordinates of a display position, clamped within the image
+void fbg_quadCoords(const struct _fbg_quad_job *job, double x, double y, int64_t *u, int64_t *v) {
+    const double *m = job->m;
+
+    double w = m[6] * x + m[7] * y + m[8];
+    double fu = (m[0] * x + m[1] * y + m[2]) / w * ((double)job->img->width * 65536);
+    double fv = (m[3] * x + m[4] * y + m[5]) / w * ((double)job->img->height * 65536);
+
+    double limit_u = (double)job->img->width * 65536 - 1, limit_v = (double)job->img->height * 65536 - 1;
+
+    // also catch NaN (the sign of w never change within a convex quad, it is only zero far outside)
+    *u = (fu >= 0) ? (int64_t)_FBG_MIN(fu, limit_u) : 0;
+    *v = (fv >= 0) ? (int64_t)_FBG_MIN(fv, limit_v) : 0;
+}
+
+void fbg_imageQuadRows(struct _fbg *fbg, int y_start, int y_end, void *user_data) {
+    struct _fbg_quad_job *job = (struct _fbg_quad_job *)user_data;
+    struct _fbg_img *img = job->img;
+
+    int y1 = _FBG_MAX(y_start, job->y), y2 = _FBG_MIN(y_end, job->y + job->h);
+
+    int y;
+    for (y = y1; y < y2; y += 1) {
+        double cy = y + 0.5;
+
+        // quad extent on the row (pixel centers)
+        double min_x = INFINITY, max_x = -INFINITY;
+
+        int e;
+        for (e = 0; e < 4; e += 1) {
+            double px = job->vx[e], py = job->vy[e], qx = job->vx[(e + 1) & 3], qy = job->vy[(e + 1) & 3];
+
+            if ((py <= cy && qy > cy) || (qy <= cy && py > cy)) {
+                double ix = px + (cy - py) * (qx - px) / (qy - py);
+
+                min_x = _FBG_MIN(min_x, ix);
+                max_x = _FBG_MAX(max_x, ix);
+            }
+        }
+
+        if (min_x > max_x) {
+            continue;
+        }
+
+        int xs = (int)_FBG_MAX(_FBG_MIN(ceil(min_x - 0.5), (double)fbg->width), 0.0);
+        int xe = (int)_FBG_MAX(_FBG_MIN(ceil(max_x - 0.5), (double)fbg->width), 0.0);
+
+        if (xs >= xe) {
+            continue;
+        }
+
+        unsigned char *pix_pointer = fbg->back_buffer + y * fbg->line_length + xs * fbg->components;
+
+        // exact coordinates every FBG_PERSPECTIVE_SPAN pixels and at the last pixel, affine steps in between (both ends are clamped so the steps stay within the image)
+        int64_t u0, v0, u1, v1;
+        fbg_quadCoords(job, xs + 0.5, cy, &u0, &v0);
+
+        int x = xs;
+        for (;;) {
+            int n = _FBG_MIN(FBG_PERSPECTIVE_SPAN, xe - 1 - x);
+            if (n <= 0) {
+                memcpy(pix_pointer, img->data + ((v0 >> 16) * img->width + (u0 >> 16)) * fbg->components, fbg->components);
+
+                break;
+            }
+
+            fbg_quadCoords(job, x + n + 0.5, cy, &u1, &v1);
+
+            int64_t du = (u1 - u0) / n, dv = (v1 - v0) / n, u = u0, v = v0;
+
+            int i;
+            for (i = 0; i < n; i += 1) {
+                memcpy(pix_pointer, img->data + ((v >> 16) * img->width + (u >> 16)) * fbg->components, fbg->components);
+
+                pix_pointer += fbg->components;
+
+                u += du;
+                v += dv;
+            }
+
+            x += n;
+            u0 = u1;
+            v0 = v1;
+        }
+    }
+}
+
+void fbg_imageQuad(struct _fbg *fbg, struct _fbg_img *img, const int *vertices) {
+    FBG_TRACE_CALL(fbg, FBG_TRACE_IMAGE_QUAD, img, vertices[0], vertices[1], vertices[2], vertices[3], vertices[4], vertices[5], vertices[6], vertices[7])
+
+    struct _fbg_quad_job job;
+    job.img = img;
+
+    int i;
+    for (i = 0; i < 4; i += 1) {
+        job.vx[i] = vertices[i * 2];
+        job.vy[i] = vertices[i * 2 + 1];
+    }
+
+    const double *x = job.vx, *y = job.vy;
+
+    // unit square to quad projective mapping (Heckbert, "Fundamentals of Texture Mapping and Image Warping")
+    double a, b, c, d, e, f, g, h;
+
+    double sx = x[0] - x[1] + x[2] - x[3], sy = y[0] - y[1] + y[2] - y[3];
+    if (sx == 0 && sy == 0) {
+        a = x[1] - x[0];
+        b = x[2] - x[1];
+        c = x[0];
+        d = y[1] - y[0];
+        e = y[2] - y[1];
+        f = y[0];
+        g = 0;
+        h = 0;
+    } else {
+        double dx1 = x[1] - x[2], dx2 = x[3] - x[2], dy1 = y[1] - y[2], dy2 = y[3] - y[2];
+
+        double den = dx1 * dy2 - dx2 * dy1;
+        if (den == 0) {
+            return;
+        }
+
+        g = (sx * dy2 - dx2 * sy) / den;
+        h = (dx1 * sy - sx * dy1) / den;
+        a = x[1] - x[0] + g * x[1];
+        b = x[3] - x[0] + h * x[3];
+        c = x[0];
+        d = y[1] - y[0] + g * y[1];
+        e = y[3] - y[0] + h * y[3];
+        f = y[0];
+    }
+
+    // inverse (adjugate, the scale does not matter for homogeneous coordinates)
+    job.m[0] = e - f * h;
+    job.m[1] = c * h - b;
+    job.m[2] = b * f - c * e;
+    job.m[3] = f * g - d;
+    job.m[4] = a - c * g;
+    job.m[5] = c * d - a * f;
+    job.m[6] = d * h - e * g;
+    job.m[7] = b * g - a * h;
+    job.m[8] = a * e - b * d;
+
+    if (job.m[8] == 0 && job.m[6] == 0 && job.m[7] == 0) {
+        return;
+    }
+
+    double min_y = _FBG_MIN(_FBG_MIN(y[0], y[1]), _FBG_MIN(y[2], y[3]));
+    double max_y = _FBG_MAX(_FBG_MAX(y[0], y[1]), _FBG_MAX(y[2], y[3]));
+
+    job.y = (int)_FBG_MAX(_FBG_MIN(ceil(min_y - 0.5), (double)fbg->height), 0.0);
+    job.h = (int)_FBG_MAX(_FBG_MIN(ceil(max_y - 0.5), (double)fbg->height), 0.0) - job.y;
+
+    if (job.h <= 0 || img->width == 0 || img->height == 0) {
+        return;
+    }
+
+    fbg_parallelRows(fbg, fbg_imageQuadRows, &job);
+}
+
 void fbg_freeImage(struct _fbg_img *img) {
-    free(img->data);
+    // arena images are released along with their arena
+    if (img->arena) {
+        return;
+    }
+
+    if (img->mapping) {
+        munmap(img->mapping, img->mapping_size);
+    } else {
+        free(img->data);
+    }
 
     free(img);
 }
 
+struct _fbg_atlas *fbg_createAtlasStructure(struct _fbg_img *img, unsigned int rects_capacity) {
+    struct _fbg_atlas *atlas = (struct _fbg_atlas *)calloc(1, sizeof(struct _fbg_atlas));
+    if (!atlas) {
+        fprintf(stderr, "fbg_createAtlas: calloc failed!\n");
+
+        return NULL;
+    }
+
+    atlas->rects = (struct _fbg_rect *)calloc(_FBG_MAX(rects_capacity, 1), sizeof(struct _fbg_rect));
+    if (!atlas->rects) {
+        fprintf(stderr, "fbg_createAtlas: rects calloc failed!\n");
+
+        free(atlas);
+
+        return NULL;
+    }
+
+    atlas->rects_capacity = _FBG_MAX(rects_capacity, 1);
+
+    atlas->skyline = (struct _fbg_rect *)calloc(img->width + 1, sizeof(struct _fbg_rect));
+    if (!atlas->skyline) {
+        fprintf(stderr, "fbg_createAtlas: skyline calloc failed!\n");
+
+        free(atlas->rects);
+        free(atlas);
+
+        return NULL;
+    }
+
+    // the whole atlas start as a single skyline segment at the top
+    atlas->skyline[0].w = img->width;
+    atlas->skyline_count = 1;
+
+    atlas->img = img;
+
+    return atlas;
+}
+
+struct _fbg_atlas *fbg_createAtlas(struct _fbg *fbg, unsigned int width, unsigned int height) {
+    struct _fbg_img *img = fbg_createImage(fbg, width, height);
+    if (!img) {
+        return NULL;
+    }
+
+    struct _fbg_atlas *atlas = fbg_createAtlasStructure(img, 64);
+    if (!atlas) {
+        fbg_freeImage(img);
+
+        return NULL;
+    }
+
+    atlas->owns_image = 1;
+
+    return atlas;
+}
+
+struct _fbg_atlas *fbg_atlasFromImage(struct _fbg *fbg, struct _fbg_img *img) {
+    (void)fbg;
+
+    // the rectangles are blitted as they are, they must be inside the image
+    if (!fbg_rectsInside(img->rects, img->rects_count, img->width, img->height)) {
+        fprintf(stderr, "fbg_atlasFromImage: atlas rectangle outside of the image!\n");
+
+        return NULL;
+    }
+
+    struct _fbg_atlas *atlas = fbg_createAtlasStructure(img, img->rects_count);
+    if (!atlas) {
+        return NULL;
+    }
+
+    if (img->rects_count) {
+        memcpy(atlas->rects, img->rects, img->rects_count * sizeof(struct _fbg_rect));
+    }
+
+    atlas->rects_count = img->rects_count;
+
+    // the image is considered full, no more packing
+    atlas->skyline[0].y = img->height;
+
+    return atlas;
+}
+
+// bottom-left skyline fit : lowest resulting top edge first then leftmost position
+int fbg_atlasFindPosition(struct _fbg_atlas *atlas, int w, int h, int *best_x, int *best_y) {
+    int i = 0, j = 0;
+    int best = -1;
+    int best_bottom = 0;
+
+    for (i = 0; i < atlas->skyline_count; i += 1) {
+        int x = atlas->skyline[i].x;
+        if (x + w > (int)atlas->img->width) {
+            break;
+        }
+
+        // the rectangle rest on the highest segment it spans
+        int y = 0;
+        int remaining = w;
+        for (j = i; remaining > 0; j += 1) {
+            y = _FBG_MAX(y, atlas->skyline[j].y);
+            remaining -= atlas->skyline[j].w;
+        }
+
+        if (y + h > (int)atlas->img->height) {
+            continue;
+        }
+
+        if (best == -1 || y + h < best_bottom) {
+            best = i;
+            best_bottom = y + h;
+
+            *best_x = x;
+            *best_y = y;
+        }
+    }
+
+    return best;
+}
+
+int fbg_atlasAdd(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_img *img) {
+    int i = 0;
+    int x = 0, y = 0;
+    int w = img->width, h = img->height;
+
+    int node = fbg_atlasFindPosition(atlas, w, h, &x, &y);
+    if (node < 0) {
+        return -1;
+    }
+
+    if (atlas->rects_count == atlas->rects_capacity) {
+        unsigned int rects_capacity = atlas->rects_capacity * 2;
+
+        struct _fbg_rect *rects = (struct _fbg_rect *)realloc(atlas->rects, rects_capacity * sizeof(struct _fbg_rect));
+        if (!rects) {
+            fprintf(stderr, "fbg_atlasAdd: rects realloc failed!\n");
+
+            return -1;
+        }
+
+        atlas->rects = rects;
+        atlas->rects_capacity = rects_capacity;
+    }
+
+    // insert the new segment then trim / remove the segments it covers
+    memmove(&atlas->skyline[node + 1], &atlas->skyline[node], (atlas->skyline_count - node) * sizeof(struct _fbg_rect));
+    atlas->skyline_count += 1;
+
+    atlas->skyline[node].x = x;
+    atlas->skyline[node].y = y + h;
+    atlas->skyline[node].w = w;
+
+    i = node + 1;
+    while (i < atlas->skyline_count) {
+        struct _fbg_rect *segment = &atlas->skyline[i];
+
+        int overlap = (x + w) - segment->x;
+        if (overlap <= 0) {
+            break;
+        }
+
+        if (overlap < segment->w) {
+            segment->x += overlap;
+            segment->w -= overlap;
+
+            break;
+        }
+
+        memmove(&atlas->skyline[i], &atlas->skyline[i + 1], (atlas->skyline_count - i - 1) * sizeof(struct _fbg_rect));
+        atlas->skyline_count -= 1;
+    }
+
+    // merge neighbouring segments of the same height
+    for (i = 0; i < atlas->skyline_count - 1; ) {
+        if (atlas->skyline[i].y == atlas->skyline[i + 1].y) {
+            atlas->skyline[i].w += atlas->skyline[i + 1].w;
+
+            memmove(&atlas->skyline[i + 1], &atlas->skyline[i + 2], (atlas->skyline_count - i - 2) * sizeof(struct _fbg_rect));
+            atlas->skyline_count -= 1;
+        } else {
+            i += 1;
+        }
+    }
+
+    // copy the image into the atlas
+    int w3 = w * fbg->components;
+    int atlas_line_length = atlas->img->width * fbg->components;
+
+    unsigned char *dst_pointer = atlas->img->data + y * atlas_line_length + x * fbg->components;
+    unsigned char *src_pointer = img->data;
+
+    for (i = 0; i < h; i += 1) {
+        memcpy(dst_pointer, src_pointer, w3);
+
+        dst_pointer += atlas_line_length;
+        src_pointer += w3;
+    }
+
+    struct _fbg_rect *rect = &atlas->rects[atlas->rects_count];
+    rect->x = x;
+    rect->y = y;
+    rect->w = w;
+    rect->h = h;
+
+    return atlas->rects_count++;
+}
+
+struct _fbg_atlas_sort_key {
+    uint64_t key;
+    int index;
+};
+
+int fbg_atlasCompareKeys(const void *a, const void *b) {
+    uint64_t key_a = ((const struct _fbg_atlas_sort_key *)a)->key;
+    uint64_t key_b = ((const struct _fbg_atlas_sort_key *)b)->key;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+int fbg_atlasAddImages(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_img **images, int count, int *indexes) {
+    int i = 0, packed = 0;
+
+    struct _fbg_atlas_sort_key *order = (struct _fbg_atlas_sort_key *)fbg_scratchAlloc(fbg, count * sizeof(struct _fbg_atlas_sort_key));
+    if (!order) {
+        return 0;
+    }
+
+    // tallest (then widest) first gives a much flatter skyline, the index keep the sort stable
+    for (i = 0; i < count; i += 1) {
+        order[i].key = ((uint64_t)(0xfffff - _FBG_MIN(images[i]->height, 0xfffff)) << 40) |
+            ((uint64_t)(0xfffff - _FBG_MIN(images[i]->width, 0xfffff)) << 20) |
+            (uint64_t)i;
+        order[i].index = i;
+    }
+
+    qsort(order, count, sizeof(struct _fbg_atlas_sort_key), fbg_atlasCompareKeys);
+
+    for (i = 0; i < count; i += 1) {
+        int index = fbg_atlasAdd(fbg, atlas, images[order[i].index]);
+
+        if (indexes) {
+            indexes[order[i].index] = index;
+        }
+
+        if (index >= 0) {
+            packed += 1;
+        }
+    }
+
+    return packed;
+}
+
+void fbg_atlasImage(struct _fbg *fbg, struct _fbg_atlas *atlas, int index, int x, int y) {
+    if (index < 0 || index >= atlas->rects_count) {
+        return;
+    }
+
+    struct _fbg_rect *rect = &atlas->rects[index];
+
+    fbg_imageClip(fbg, atlas->img, x, y, rect->x, rect->y, rect->w, rect->h);
+}
+
+void fbg_atlasBatch(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_atlas_blit *blits, int count) {
+    int i = 0;
+
+    struct _fbg_atlas_sort_key *order = (struct _fbg_atlas_sort_key *)fbg_scratchAlloc(fbg, count * sizeof(struct _fbg_atlas_sort_key));
+    if (!order) {
+        for (i = 0; i < count; i += 1) {
+            fbg_atlasImage(fbg, atlas, blits[i].index, blits[i].x, blits[i].y);
+        }
+
+        return;
+    }
+
+    // walk the atlas top to bottom so that consecutive blits read neighbouring atlas rows, the index keep the sort stable
+    int valid_count = 0;
+    for (i = 0; i < count; i += 1) {
+        // blits of unknown sub-images are skipped
+        if (blits[i].index < 0 || blits[i].index >= atlas->rects_count) {
+            continue;
+        }
+
+        struct _fbg_rect *rect = &atlas->rects[blits[i].index];
+
+        order[valid_count].key = ((uint64_t)rect->y << 40) | ((uint64_t)rect->x << 20) | (uint64_t)i;
+        order[valid_count].index = i;
+
+        valid_count += 1;
+    }
+
+    qsort(order, valid_count, sizeof(struct _fbg_atlas_sort_key), fbg_atlasCompareKeys);
+
+    for (i = 0; i < valid_count; i += 1) {
+        struct _fbg_atlas_blit *blit = &blits[order[i].index];
+        struct _fbg_rect *rect = &atlas->rects[blit->index];
+
+        fbg_imageClip(fbg, atlas->img, blit->x, blit->y, rect->x, rect->y, rect->w, rect->h);
+    }
+}
+
+void fbg_freeAtlas(struct _fbg_atlas *atlas) {
+    if (atlas->owns_image) {
+        fbg_freeImage(atlas->img);
+    }
+
+    free(atlas->rects);
+    free(atlas->skyline);
+
+    free(atlas);
+}
+
 void fbg_drawInto(struct _fbg *fbg, unsigned char *buffer) {
+    // the traced calls which follow draw into a buffer the replay doesn't have
+    FBG_TRACE_CALL(fbg, FBG_TRACE_UNTRACED, "fbg_drawInto")
+
     if (buffer == NULL) {
         fbg->back_buffer = fbg->temp_buffer;
         fbg->temp_buffer = NULL;
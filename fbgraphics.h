@@ -3,8 +3,15 @@
 
     #include <time.h>
     #include <sys/time.h>
+    #include <stdio.h>
+    #include <stddef.h>
     #include <stdint.h>
     #include <math.h>
+    #include <stdatomic.h>
+
+    #ifndef WITHOUT_THREADS
+    #include <pthread.h>
+    #endif
 
 
 // ### Library structures
@@ -26,16 +33,131 @@
         float l;
     };
 
+    //! Memory arena block
+    /*! A single chunk of a memory arena, blocks are chained together */
+    struct _fbg_arena_block {
+        //! Next block of the chain
+        struct _fbg_arena_block *next;
+
+        //! Usable block size in bytes
+        size_t size;
+        //! Current allocation offset in bytes
+        size_t offset;
+
+        //! Block data
+        unsigned char data[];
+    };
+
+    //! Memory arena data structure
+    /*! Bump allocator made of chained blocks, all allocations are released at once by fbg_arenaReset() or fbg_freeArena() */
+    struct _fbg_arena {
+        //! First block of the chain
+        struct _fbg_arena_block *first;
+        //! Block currently used for allocations
+        struct _fbg_arena_block *current;
+
+        //! Minimum size of a new block in bytes
+        size_t block_size;
+
+        //! Amount of bytes currently allocated
+        size_t used;
+        //! Highest amount of bytes allocated since the arena creation
+        size_t peak;
+    };
+
+    //! Rectangle data structure
+    /*! Hold a rectangle position and size (atlas sub-images etc.) */
+    struct _fbg_rect {
+        //! X position (upper left coordinate)
+        int32_t x;
+        //! Y position (upper left coordinate)
+        int32_t y;
+        //! Width in pixels
+        int32_t w;
+        //! Height in pixels
+        int32_t h;
+    };
+
+    //! Raw image file header
+    /*! Raw image files are made of this header followed by the atlas rectangles table (_fbg_rect) and pixel rows (packed, in the context format) starting at data_offset */
+    struct _fbg_raw_header {
+        //! File identifier (FBG_RAW_MAGIC)
+        char magic[4];
+        //! Format version (FBG_RAW_VERSION)
+        uint16_t version;
+        //! Image components (must match the context components)
+        uint16_t components;
+
+        //! Image width in pixels
+        uint32_t width;
+        //! Image height in pixels
+        uint32_t height;
+
+        //! Amount of atlas rectangles following the header
+        uint32_t rects_count;
+
+        //! Offset of the pixel rows from the start of the file (aligned on FBG_BUFFER_ALIGNMENT bytes)
+        uint32_t data_offset;
+    };
+
     //! Image data structure
     /*! Hold images informations and data */
     struct _fbg_img {
-        //! RGB image data (bpp depend on framebuffer settings)
+        //! RGB image data (bpp depend on framebuffer settings, rows are packed, aligned on FBG_BUFFER_ALIGNMENT bytes)
         unsigned char *data;
 
         //! Image width in pixels
         unsigned int width;
         //! Image height in pixels
         unsigned int height;
+        //! Pixel components (the components of the context which created the image)
+        unsigned int components;
+
+        //! Arena the image was allocated from (NULL if allocated on the heap)
+        struct _fbg_arena *arena;
+
+        //! Atlas rectangles (sub-images) of the image (can be NULL)
+        struct _fbg_rect *rects;
+        //! Amount of atlas rectangles
+        unsigned int rects_count;
+
+        //! Memory-mapped file the image data belongs to (NULL if the image owns its data)
+        void *mapping;
+        //! Memory-mapped file length
+        size_t mapping_size;
+    };
+
+    //! Texture atlas data structure
+    /*! Hold many sub-images packed into a single image (skyline packing) */
+    struct _fbg_atlas {
+        //! Atlas image
+        struct _fbg_img *img;
+
+        //! Sub-images rectangles (index returned by fbg_atlasAdd())
+        struct _fbg_rect *rects;
+        //! Amount of sub-images
+        int rects_count;
+        //! Allocated amount of rectangles
+        int rects_capacity;
+
+        //! Skyline segments (x, y = segment top, w = segment width)
+        struct _fbg_rect *skyline;
+        //! Amount of skyline segments
+        int skyline_count;
+
+        //! Wether the atlas image is freed by fbg_freeAtlas()
+        int owns_image;
+    };
+
+    //! Atlas blit data structure
+    /*! A single sub-image draw for fbg_atlasBatch() */
+    struct _fbg_atlas_blit {
+        //! Sub-image index
+        int index;
+        //! X position (upper left coordinate)
+        int x;
+        //! Y position (upper left coordinate)
+        int y;
     };
 
     //! Bitmap font data structure
@@ -56,6 +178,399 @@
 
         //! Associated font image data structure
         struct _fbg_img *bitmap;
+
+        //! Arena the font was allocated from (NULL if allocated on the heap)
+        struct _fbg_arena *arena;
+    };
+
+    //! Proportional font glyph data structure
+    /*! Glyph metrics and location of its 1-bit rows */
+    struct _fbg_glyph {
+        //! Offset of the first glyph row in the font bitmap words (one 32 bits word per row, MSB = leftmost pixel)
+        uint32_t offset;
+
+        //! Glyph bitmap width in pixels (32 max)
+        uint8_t width;
+        //! Glyph bitmap height in pixels
+        uint8_t height;
+
+        //! Horizontal offset from the pen position to the bitmap left edge
+        int8_t bearing_x;
+        //! Vertical offset from the line top to the bitmap top edge
+        int8_t bearing_y;
+
+        //! Horizontal pen advance in pixels
+        uint8_t advance;
+    };
+
+    //! Proportional bitmap font data structure
+    /*! Hold per-glyph metrics, packed 1-bit glyph rows and an optional kerning table */
+    struct _fbg_pfont {
+        //! Glyphs metrics
+        struct _fbg_glyph *glyphs;
+        //! Packed glyph rows
+        uint32_t *bitmap;
+
+        //! Kerning table (glyphs_count * glyphs_count pixel adjustments, NULL if no kerning)
+        int8_t *kerning;
+
+        //! Amount of glyphs
+        int glyphs_count;
+        //! First ASCII character of the font
+        unsigned char first_char;
+
+        //! Distance between two lines in pixels
+        int line_height;
+
+        //! Arena the font was allocated from (NULL if allocated on the heap)
+        struct _fbg_arena *arena;
+    };
+
+    //! Anti-aliased font data structure
+    /*! Hold per-glyph metrics and 8-bit coverage masks generated for a single pixel size */
+    struct _fbg_afont {
+        //! Glyphs metrics (offset is the first coverage byte of the glyph, width bytes per row)
+        struct _fbg_glyph *glyphs;
+        //! Glyphs coverage masks (0 = transparent, 255 = opaque)
+        uint8_t *coverage;
+
+        //! Kerning table (glyphs_count * glyphs_count pixel adjustments, NULL if no kerning)
+        int8_t *kerning;
+
+        //! Amount of glyphs
+        int glyphs_count;
+        //! First ASCII character of the font
+        unsigned char first_char;
+
+        //! Distance between two lines in pixels
+        int line_height;
+
+        //! Arena the font was allocated from (NULL if allocated on the heap)
+        struct _fbg_arena *arena;
+    };
+
+    //! Text cache entry data structure
+    /*! Hold a rasterized text as a list of opaque runs (a color-keyed image where only the opaque spans are stored) */
+    struct _fbg_text_run {
+        //! Cached text (NULL if the entry is unused)
+        char *text;
+        //! Allocated text length
+        int text_capacity;
+        //! Text length
+        int length;
+
+        //! Hash of the text, font and size
+        uint32_t hash;
+        //! Proportional font (NULL for the built-in font)
+        void *font;
+        //! Font scale
+        int font_size;
+
+        //! Opaque runs relative to the text position (h = amount of rows covered by the run)
+        struct _fbg_rect *runs;
+        //! Amount of runs
+        int runs_count;
+        //! Allocated amount of runs
+        int runs_capacity;
+
+        //! Cache tick of the last use
+        unsigned int last_use;
+    };
+
+    //! Text cache data structure
+    /*! Hash table of rasterized texts, unchanged labels cost a few spans instead of a full rasterization */
+    struct _fbg_text_cache {
+        //! Entries
+        struct _fbg_text_run *entries;
+        //! Amount of entries (power of two)
+        int entries_count;
+
+        //! Lookup counter
+        unsigned int tick;
+
+        //! Amount of cache hits
+        unsigned int hits;
+        //! Amount of cache misses (rasterizations)
+        unsigned int misses;
+    };
+
+    //! Console cell data structure
+    struct _fbg_cell {
+        //! ASCII character
+        unsigned char c;
+        //! Foreground color
+        struct _fbg_rgb fg;
+        //! Background color
+        struct _fbg_rgb bg;
+    };
+
+    //! trace file identifier
+    #define FBG_TRACE_MAGIC "FBGT"
+    //! trace format version
+    #define FBG_TRACE_VERSION 1
+
+    //! Traced calls (record types of a trace file)
+    enum _fbg_trace_op {
+        FBG_TRACE_IMAGE_DATA,
+        FBG_TRACE_DRAW,
+        FBG_TRACE_FLIP,
+        FBG_TRACE_RESIZE,
+        FBG_TRACE_CLEAR,
+        FBG_TRACE_BACKGROUND,
+        FBG_TRACE_FADE_DOWN,
+        FBG_TRACE_FADE_UP,
+        FBG_TRACE_FILL,
+        FBG_TRACE_PIXEL,
+        FBG_TRACE_PIXELA,
+        FBG_TRACE_FPIXEL,
+        FBG_TRACE_HLINE,
+        FBG_TRACE_VLINE,
+        FBG_TRACE_LINE,
+        FBG_TRACE_POLYGON,
+        FBG_TRACE_RECT,
+        FBG_TRACE_RECTA,
+        FBG_TRACE_FRECT,
+        FBG_TRACE_TEXT_NEW,
+        FBG_TRACE_IMAGE,
+        FBG_TRACE_IMAGE_COLORKEY,
+        FBG_TRACE_IMAGE_CLIP,
+        FBG_TRACE_IMAGE_EX,
+        FBG_TRACE_ELLIPSE,
+        FBG_TRACE_ROUND_RECT,
+        FBG_TRACE_SPAN,
+        FBG_TRACE_SPANA,
+        FBG_TRACE_IMAGE_AFFINE,
+        FBG_TRACE_IMAGE_QUAD,
+        FBG_TRACE_UNTRACED,
+        FBG_TRACE_OPS
+    };
+
+    //! Traced image data structure (image already embedded into the trace)
+    struct _fbg_trace_image {
+        //! Image
+        const struct _fbg_img *img;
+        //! Image data hash when it was embedded (the image is embedded again when its data change)
+        uint64_t hash;
+        //! Image id in the trace
+        uint32_t id;
+    };
+
+    //! Trace recorder data structure
+    /*! Each record is the call id followed by its arguments (zigzag varints for integers, bytes for colors, IEEE floats)
+        Images are embedded (FBG_TRACE_IMAGE_DATA) before the first call using them */
+    struct _fbg_trace {
+        //! Trace file
+        FILE *file;
+
+        //! Pending records
+        unsigned char *buffer;
+        //! Pending records length
+        size_t length;
+        //! Pending records allocated length
+        size_t capacity;
+
+        //! Nesting level of traced calls (only outermost calls are recorded)
+        int depth;
+
+        //! Embedded images
+        struct _fbg_trace_image *images;
+        //! Amount of embedded images
+        uint32_t images_count;
+        //! Allocated images
+        uint32_t images_capacity;
+
+        //! Amount of recorded frames
+        uint32_t frames;
+        //! Last frame (+ 1) marked with an untraced write (FBG_TRACE_UNTRACED is recorded once per frame)
+        uint32_t untraced_frame;
+    };
+
+    //! Replay statistics data structure
+    struct _fbg_trace_stats {
+        //! Calls count per trace op
+        unsigned long calls[FBG_TRACE_OPS];
+        //! Time spent per trace op in nanoseconds
+        uint64_t time[FBG_TRACE_OPS];
+
+        //! Replayed frames
+        uint32_t frames;
+        //! Total replay time in nanoseconds
+        uint64_t total_time;
+
+        //! Replayed frames using untraced calls (their checksums can differ from the recording)
+        uint32_t untraced_frames;
+    };
+
+    //! Character-cell console data structure
+    /*! Grid of cells using the built-in font, only modified cells are rasterized into the console surface */
+    struct _fbg_console {
+        //! Cells (cols * rows)
+        struct _fbg_cell *cells;
+        //! Cells modification flags
+        unsigned char *dirty;
+        //! First row modified since the last draw
+        int dirty_row_start;
+        //! Last row (exclusive) modified since the last draw (no modified rows when not greater than dirty_row_start)
+        int dirty_row_end;
+        //! First row modified before the last draw
+        int drawn_row_start;
+        //! Last row (exclusive) modified before the last draw
+        int drawn_row_end;
+
+        //! Rasterized console
+        struct _fbg_img *surface;
+
+        //! Amount of columns
+        int cols;
+        //! Amount of rows
+        int rows;
+
+        //! Built-in font scale
+        int font_size;
+        //! Cell width in pixels
+        int cell_width;
+        //! Cell height in pixels
+        int cell_height;
+
+        //! Surface components
+        int components;
+
+        //! Cursor column
+        int cursor_x;
+        //! Cursor row
+        int cursor_y;
+
+        //! Current foreground color
+        struct _fbg_rgb fg;
+        //! Current background color
+        struct _fbg_rgb bg;
+    };
+
+    //! Indexed (8-bit palette) surface data structure
+    /*! Drawing write palette indices (a quarter of the bandwidth of a 32-bit buffer), the surface is expanded through the palette lookup table when drawn
+        Palette animation (color cycling etc.) only change the lookup table */
+    struct _fbg_indexed {
+        //! Palette indices (rows are packed)
+        unsigned char *data;
+
+        //! Surface width in pixels
+        int width;
+        //! Surface height in pixels
+        int height;
+
+        //! Palette entries packed into the context pixel format (r, g, b then 255 for 4 components)
+        uint32_t lut[256];
+    };
+
+    //! linear gradient (colors vary along the segment between two points)
+    #define FBG_GRADIENT_LINEAR 0
+    //! radial gradient (colors vary with the distance to a center)
+    #define FBG_GRADIENT_RADIAL 1
+
+    //! Gradient data structure
+    /*! Colors are looked up from a 256 entries ramp, the ramp index is stepped incrementally along each row (no per pixel division / square root)
+        Positions are display coordinates, a gradient can fill several shapes consistently */
+    struct _fbg_gradient {
+        //! FBG_GRADIENT_LINEAR or FBG_GRADIENT_RADIAL
+        int type;
+
+        //! Linear start point / radial center X position
+        int x0;
+        //! Linear start point / radial center Y position
+        int y0;
+        //! Linear end point X position
+        int x1;
+        //! Linear end point Y position
+        int y1;
+        //! Radial radius
+        int radius;
+
+        //! Linear ramp index step per pixel along X (16.16 fixed point)
+        int step_x;
+        //! Linear ramp index step per pixel along Y (16.16 fixed point)
+        int step_y;
+
+        //! Radial thresholds : ramp entry i is used from the scaled squared distance (510 * distance)^2 >= thresholds[i] (sentinels at 0 and 256)
+        int64_t thresholds[257];
+
+        //! Ramp colors packed into the context pixel format (r, g, b then 255 for 4 components)
+        uint32_t lut[256];
+    };
+
+    #ifndef WITHOUT_THREADS
+    //! Thread pool band range data structure
+    /*! Bands [next, end) left to a participant, other participants steal from it once their own range is exhausted */
+    struct _fbg_pool_range {
+        //! Next band to process (taken with an atomic increment)
+        _Alignas(64) atomic_int next;
+        //! End band (excluded)
+        int end;
+    };
+
+    //! Thread pool worker data structure
+    struct _fbg_pool_worker {
+        //! Worker thread
+        pthread_t thread;
+        //! Participant index (band range)
+        int index;
+        //! Pool the worker belong to
+        struct _fbg_pool *pool;
+    };
+
+    //! Thread pool data structure
+    /*! Worker threads processing row bands of full-buffer operations along with the calling thread (see fbg_setThreads()) */
+    struct _fbg_pool {
+        //! Workers
+        struct _fbg_pool_worker *workers;
+        //! Amount of started worker threads
+        int threads_count;
+
+        //! Band ranges (threads_count + 1, the last one belong to the calling thread)
+        struct _fbg_pool_range *ranges;
+
+        //! Lock protecting generation, pending and stop
+        pthread_mutex_t lock;
+        //! Signaled when a job start
+        pthread_cond_t wake;
+        //! Signaled when the last worker finished the job
+        pthread_cond_t done;
+
+        //! Job counter (workers wake up when it change)
+        unsigned long generation;
+        //! Workers still processing the current job
+        int pending;
+        //! Flag asking the workers to exit
+        int stop;
+
+        //! Current job context
+        struct _fbg *fbg;
+        //! Current job function (process the rows [y_start, y_end))
+        void (*job)(struct _fbg *fbg, int y_start, int y_end, void *user_data);
+        //! Current job user data
+        void *job_data;
+        //! Current job rows count
+        int job_height;
+        //! Current job band height in rows
+        int band_height;
+    };
+    #endif
+
+    //! Resize event data structure
+    /*! Prepared by the thread calling fbg_pushResize() (including the new internal buffers) and swapped in by fbg_draw() */
+    struct _fbg_resize {
+        //! New render width
+        int width;
+        //! New render height
+        int height;
+        //! New line length in bytes
+        int line_length;
+        //! New buffers length in bytes
+        int size;
+
+        //! New back buffer (NULL if the context does not manage its buffers)
+        unsigned char *back_buffer;
+        //! New front / display buffer (NULL if the context does not manage its buffers)
+        unsigned char *disp_buffer;
     };
 
     //! FB Graphics context data structure
@@ -64,6 +579,11 @@
         //! Framebuffer real data length (with BPP)
         int size;
 
+        //! Internal buffers (the buffers swap on flips, their allocated length follow them through this table)
+        unsigned char *buffers[2];
+        //! Allocated length of each internal buffer (can be larger than size after a shrinking resize)
+        int capacities[2];
+
         //! Front / display buffer
         unsigned char *disp_buffer;
         //! Back buffer
@@ -112,13 +632,13 @@
         int components;
         //! Offset to add in case of 32 BPP
         int comp_offset;
-        //! Internal buffers line length
+        //! Internal buffers line length in bytes (can be padded, see FBG_STRIDE_ALIGNMENT)
         int line_length;
 
-        //! Requested new display width (resize event)
-        int new_width;
-        //! Requested new display height (resize event)
-        int new_height;
+        //! Pending resize event (published by fbg_pushResize(), taken by fbg_draw())
+        _Atomic(struct _fbg_resize *) pending_resize;
+        //! Buffers replaced by the last resize, freed on the next fbg_draw() once the presenter released them
+        unsigned char *retired_buffers[2];
 
         //! Current FPS
         int16_t fps;
@@ -137,6 +657,36 @@
         //! Flag indicating a BGR framebuffer
         int bgr;
 
+        //! Target framerate (0 = not paced, see fbg_setTargetFramerate())
+        int target_fps;
+        //! Next frame deadline (CLOCK_MONOTONIC)
+        struct timespec frame_deadline;
+        //! End of the last frame wait (CLOCK_MONOTONIC)
+        struct timespec frame_start;
+        //! Time spent on the last frame without the pacing wait in milliseconds
+        float frame_time;
+        //! Wether the last frame missed its deadline
+        int frame_late;
+        //! Amount of missed frame deadlines since the target framerate was set
+        unsigned int late_frames;
+        //! Wether the backend vertical sync failed once (it is not tried again)
+        int vsync_failed;
+
+        //! Thread pool used by full-buffer operations (NULL = serial, see fbg_setThreads())
+        struct _fbg_pool *pool;
+
+        //! Trace recorder (NULL = not recording, see fbg_traceStart())
+        struct _fbg_trace *trace;
+
+        //! Quality governor fed with the frame time (optional, see fbg_setGovernor())
+        struct _fbg_governor *governor;
+
+        //! Indexed surface expanded into the back buffer by fbg_draw (optional, see fbg_setIndexed())
+        struct _fbg_indexed *indexed;
+
+        //! Backend vertical sync wait function (return 0 once the vertical blank happened, -1 if unsupported)
+        int (*backend_vsync)(struct _fbg *fbg);
+
         //! Backend resize function
         void (*backend_resize)(struct _fbg *fbg, unsigned int new_width, unsigned int new_height);
         //! User-defined resize function
@@ -150,11 +700,149 @@
         //! User-defined context structure
         void *user_context;
 
+        //! Arena used for long-lived assets such as images and fonts (optional)
+        struct _fbg_arena *assets_arena;
+
+        //! Per-frame scratch arena (reset by fbg_flip())
+        struct _fbg_arena *scratch_arena;
+
         //! currently processed task buffer (assigned before compositing function is called in fbg_draw)
         //unsigned char *curr_task_buffer;
 
     };
 
+    //! Quality governor knob data structure
+    /*! An application quality setting the governor lower or raise by step between min and max */
+    struct _fbg_governor_knob {
+        //! Setting value (read by the application)
+        int *value;
+        //! Lowest quality value
+        int min;
+        //! Highest quality value
+        int max;
+        //! Amount added / removed at each change
+        int step;
+
+        //! Function called after the value changed (optional)
+        void (*apply)(struct _fbg *fbg, int value, void *user_data);
+        //! User data passed to the apply function
+        void *user_data;
+    };
+
+    //! Quality governor data structure
+    /*! Compare the smoothed frame time against a budget and degrade / restore the registered knobs
+        Knobs are degraded in registration order and restored in the reverse order, the hysteresis come from two thresholds and hold periods */
+    struct _fbg_governor {
+        //! Registered knobs
+        struct _fbg_governor_knob *knobs;
+        //! Amount of registered knobs
+        int knobs_count;
+        //! Allocated knobs
+        int knobs_capacity;
+
+        //! Frame time budget in milliseconds (0 = derived from the target framerate)
+        float budget;
+        //! Smoothed frame time in milliseconds (exponential moving average)
+        float average;
+        //! Moving average weight of the last frame (0 - 1)
+        float smoothing;
+
+        //! Quality is lowered when the average is above budget * degrade_ratio
+        float degrade_ratio;
+        //! Quality is raised when the average is below budget * restore_ratio
+        float restore_ratio;
+
+        //! Frames to wait after a change before degrading again
+        int degrade_hold;
+        //! Consecutive frames under the restore threshold needed before restoring
+        int restore_hold;
+
+        //! Frames since the last change
+        int frames_since_change;
+        //! Consecutive frames under the restore threshold
+        int frames_under;
+        //! Amount of processed frames
+        unsigned long frames;
+
+        //! Current degradation level (amount of steps taken down)
+        int level;
+    };
+
+    #ifndef FBG_COMMAND_TEXT_SIZE
+    //! inline text storage of a queued text command (including the terminating null byte)
+    #define FBG_COMMAND_TEXT_SIZE 64
+    #endif
+
+    //! Queued command types
+    enum _fbg_command_type {
+        FBG_COMMAND_TEXT,
+        FBG_COMMAND_RECT,
+        FBG_COMMAND_IMAGE,
+        FBG_COMMAND_CALLBACK
+    };
+
+    //! Draw command data structure
+    /*! Plain data copied into a command queue slot, executed by fbg_queueDrain() on the render thread */
+    struct _fbg_command {
+        //! Command type (see _fbg_command_type)
+        int type;
+
+        //! X position
+        int x;
+        //! Y position
+        int y;
+        //! Width
+        int w;
+        //! Height
+        int h;
+
+        //! Color
+        struct _fbg_rgb color;
+        //! Opacity (255 = opaque)
+        unsigned char alpha;
+
+        //! Text (FBG_COMMAND_TEXT)
+        char text[FBG_COMMAND_TEXT_SIZE];
+        //! Proportional font (FBG_COMMAND_TEXT, NULL = built-in font)
+        struct _fbg_pfont *font;
+
+        //! Updated image (FBG_COMMAND_IMAGE)
+        struct _fbg_img *img;
+        //! New image pixels, allocated with malloc() by the producer and freed by fbg_queueDrain() (FBG_COMMAND_IMAGE)
+        unsigned char *data;
+
+        //! Function called on the render thread (FBG_COMMAND_CALLBACK)
+        void (*callback)(struct _fbg *fbg, void *user_data);
+        //! User data passed to the callback (FBG_COMMAND_CALLBACK)
+        void *user_data;
+    };
+
+    //! Command queue slot data structure
+    struct _fbg_command_slot {
+        //! Slot sequence number (tell producers and consumer wether the slot is free or filled)
+        atomic_size_t sequence;
+        //! Command
+        struct _fbg_command command;
+    };
+
+    //! Command queue data structure
+    /*! Bounded lock-free multi-producer / single-consumer ring buffer of draw commands
+        Producers claim slots with a compare-and-swap on head, the render thread is the only consumer */
+    struct _fbg_queue {
+        //! Next slot to fill (shared by producers)
+        _Alignas(64) atomic_size_t head;
+        //! Next slot to consume (render thread only)
+        _Alignas(64) size_t tail;
+
+        //! Slots
+        _Alignas(64) struct _fbg_command_slot *slots;
+        //! Slots count - 1 (the slots count is a power of two)
+        size_t mask;
+
+        //! Amount of rejected commands because the queue was full
+        atomic_uint dropped;
+    };
+
 
 // ### Library functions
 
@@ -201,8 +889,9 @@
     */
     extern void fbg_resize(struct _fbg *fbg, int new_width, int new_height);
 
-    //! push a resize event for the FB Graphics context
-    //! note : the resize event is processed into the fbg_draw function
+    //! push a resize event for the FB Graphics context (can be called from any thread)
+    //! note : the new buffers are allocated by the calling thread, the render thread only swap them in (into the fbg_draw function)
+    //! note : a newer event replace a pending one, the old buffers are freed on the next fbg_draw call
     //! note : resizing is not yet allowed in framebuffer mode
     //! note : if you want to immediately resize the context, see fbg_resize
     /*!
@@ -213,6 +902,27 @@
     */
     extern void fbg_pushResize(struct _fbg *fbg, int new_width, int new_height);
 
+    //! set the amount of threads used by full-buffer operations (fbg_clear, fbg_background, fbg_fadeDown, fbg_fadeUp and backends conversions)
+    //! the rows are split into bands, each thread start with its own bands then steal bands from the others
+    //! note : buffers smaller than FBG_PARALLEL_THRESHOLD bytes are always processed by the calling thread
+    //! note : build with -DWITHOUT_THREADS to remove the thread pool (this function then does nothing)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param threads amount of threads including the calling thread (0 = online processors count, 1 = serial)
+      \sa fbg_parallelRows()
+    */
+    extern void fbg_setThreads(struct _fbg *fbg, int threads);
+
+    //! process the rows of the context in parallel (row bands) when a thread pool is set, serially otherwise
+    //! note : the job must only touch its own rows, must not be called from a job
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param job function processing the rows [y_start, y_end)
+      \param user_data user data passed to the job
+      \sa fbg_setThreads()
+    */
+    extern void fbg_parallelRows(struct _fbg *fbg, void (*job)(struct _fbg *fbg, int y_start, int y_end, void *user_data), void *user_data);
+
     //! background fade to black with controllable factor
     /*!
       \param fbg pointer to a FBG context / data structure
@@ -352,6 +1062,33 @@
     */
     extern void fbg_hline(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b);
 
+    //! draw a horizontal span clipped against the display
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param x span X position (left coordinate, can be out of the display)
+      \param y span Y position (can be out of the display)
+      \param w span width
+      \param r
+      \param g
+      \param b
+      \sa fbg_hline()
+    */
+    extern void fbg_span(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b);
+
+    //! draw a horizontal span clipped against the display with transparency
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param x span X position (left coordinate, can be out of the display)
+      \param y span Y position (can be out of the display)
+      \param w span width
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_span(), fbg_recta()
+    */
+    extern void fbg_spana(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
     //! draw a vertical line
     /*!
       \param fbg pointer to a FBG context / data structure
@@ -390,212 +1127,1285 @@
     */
     extern void fbg_polygon(struct _fbg *fbg, int num_vertices, int *vertices, unsigned char r, unsigned char g, unsigned char b);
 
-    //! clear the background with a color
+    //! draw a circle outline (midpoint algorithm, clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
+      \param x center X position
+      \param y center Y position
+      \param radius circle radius
       \param r
       \param g
       \param b
-      \sa fbg_clear()
+      \sa fbg_ellipse(), fbg_roundRect()
     */
-    extern void fbg_background(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b);
+    extern void fbg_circle(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b);
 
-    //! convert HSL values to RGB color
+    //! draw a circle outline with transparency (each pixel is blended once)
     /*!
-      \param color pointer to a _fbg_rgb data structure
-      \param h the hue
-      \param s the saturation
-      \param l the lightness
-      \sa rgbToHsl()
+      \param fbg pointer to a FBG context / data structure
+      \param x center X position
+      \param y center Y position
+      \param radius circle radius
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_circle()
     */
-    extern void fbg_hslToRGB(struct _fbg_rgb *color, float h, float s, float l);
+    extern void fbg_circlea(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
-    //! convert RGB values to HSL color
+    //! draw a filled circle (one span per row, clipped against the display)
     /*!
-      \param color pointer to a _fbg_hsl data structure
+      \param fbg pointer to a FBG context / data structure
+      \param x center X position
+      \param y center Y position
+      \param radius circle radius
       \param r
       \param g
       \param b
-      \sa fbg_hslToRGB()
+      \sa fbg_circle(), fbg_span()
     */
-    extern void fbg_rgbToHsl(struct _fbg_hsl *color, float r, float g, float b);
-    //! draw to the screen
+    extern void fbg_circleFill(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b);
+
+    //! draw a filled circle with transparency
     /*!
       \param fbg pointer to a FBG context / data structure
+      \param x center X position
+      \param y center Y position
+      \param radius circle radius
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_circleFill(), fbg_spana()
     */
-    extern void fbg_draw(struct _fbg *fbg);
+    extern void fbg_circleFilla(struct _fbg *fbg, int x, int y, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
-    //! flip the buffers
+    //! draw an ellipse outline (midpoint algorithm, clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
+      \param x center X position
+      \param y center Y position
+      \param rx horizontal radius
+      \param ry vertical radius
+      \param r
+      \param g
+      \param b
+      \sa fbg_circle(), fbg_roundRect()
     */
-    extern void fbg_flip(struct _fbg *fbg);
+    extern void fbg_ellipse(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b);
 
-    //! create an empty image
+    //! draw an ellipse outline with transparency (each pixel is blended once)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param width image width
-      \param height image height
-      \return _fbg_img data structure pointer
-      \sa fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_createFont()
+      \param x center X position
+      \param y center Y position
+      \param rx horizontal radius
+      \param ry vertical radius
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_ellipse()
     */
-    extern struct _fbg_img *fbg_createImage(struct _fbg *fbg, unsigned int width, unsigned int height);
-
+    extern void fbg_ellipsea(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
-    //! load an image from memory
+    //! draw a filled ellipse (one span per row, clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param data The image data from memory.
-      \param size The size of the image in bytes.
-      \return _fbg_img data structure pointer
-      \sa fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_createFont(), fbg_imageClip(), fbg_loadPNG(), fbg_loadJPEG(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+      \param x center X position
+      \param y center Y position
+      \param rx horizontal radius
+      \param ry vertical radius
+      \param r
+      \param g
+      \param b
+      \sa fbg_ellipse(), fbg_span()
     */
-    extern struct _fbg_img *fbg_loadImageFromMemory(struct _fbg *fbg, const unsigned char *data, int size);
+    extern void fbg_ellipseFill(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b);
 
-    //! draw an image
+    //! draw a filled ellipse with transparency
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param img image structure pointer
-      \param x image X position (upper left coordinate)
-      \param y image Y position (upper left coordinate)
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+      \param x center X position
+      \param y center Y position
+      \param rx horizontal radius
+      \param ry vertical radius
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_ellipseFill(), fbg_spana()
     */
-    extern void fbg_image(struct _fbg *fbg, struct _fbg_img *img, int x, int y);
+    extern void fbg_ellipseFilla(struct _fbg *fbg, int x, int y, int rx, int ry, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
-    //! draw an image with colorkeying support (image colorkey value will be ignored)
+    //! draw a rounded rectangle outline (midpoint algorithm, clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param img image structure pointer
-      \param x image X position (upper left coordinate)
-      \param y image Y position (upper left coordinate)
-      \param cr colorkey red component
-      \param cg colorkey green component
-      \param cb colorkey blue component
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_image()
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param radius corners radius (clamped to half the rectangle size)
+      \param r
+      \param g
+      \param b
+      \sa fbg_rect(), fbg_circle()
     */
-    extern void fbg_imageColorkey(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cr, int cg, int cb);
+    extern void fbg_roundRect(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b);
 
-    //! draw a clipped image
+    //! draw a rounded rectangle outline with transparency (each pixel is blended once)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param img image structure pointer
-      \param x image X position (upper left coordinate)
-      \param y image Y position (upper left coordinate)
-      \param cx The X coordinate where to start clipping
-      \param cy The Y coordinate where to start clipping
-      \param cw The width of the clipped image (from cx)
-      \param ch The height of the clipped image (from cy)
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param radius corners radius (clamped to half the rectangle size)
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_roundRect()
     */
-    extern void fbg_imageClip(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cx, int cy, int cw, int ch);
+    extern void fbg_roundRecta(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
-    //! flip an image vertically
+    //! draw a filled rounded rectangle (one span per row, clipped against the display)
     /*!
-      \param img image structure pointer
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage()
+      \param fbg pointer to a FBG context / data structure
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param radius corners radius (clamped to half the rectangle size)
+      \param r
+      \param g
+      \param b
+      \sa fbg_roundRect(), fbg_span()
     */
-    extern void fbg_imageFlip(struct _fbg_img *img);
+    extern void fbg_roundRectFill(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b);
 
-    //! draw an image with support for clipping and scaling (Nearest-neighbor algorithm)
+    //! draw a filled rounded rectangle with transparency
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param img image structure pointer
-      \param x image X position (upper left coordinate)
-      \param y image Y position (upper left coordinate)
-      \param sx The X scale factor
-      \param sy The Y scale factor
-      \param cx The X coordinate where to start clipping
-      \param cy The Y coordinate where to start clipping
-      \param cw The width of the clipped image (from cx)
-      \param ch The height of the clipped image (from cy)
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_imageScale(), fbg_imageColorkey()
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param radius corners radius (clamped to half the rectangle size)
+      \param r
+      \param g
+      \param b
+      \param a alpha value
+      \sa fbg_roundRectFill(), fbg_spana()
     */
-    extern void fbg_imageEx(struct _fbg *fbg, struct _fbg_img *img, int x, int y, float sx, float sy, int cx, int cy, int cw, int ch);
+    extern void fbg_roundRectFilla(struct _fbg *fbg, int x, int y, int w, int h, int radius, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+    //! clear the background with a color
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param r
+      \param g
+      \param b
+      \sa fbg_clear()
+    */
+    extern void fbg_background(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b);
+
+    //! convert HSL values to RGB color
+    /*!
+      \param color pointer to a _fbg_rgb data structure
+      \param h the hue
+      \param s the saturation
+      \param l the lightness
+      \sa rgbToHsl()
+    */
+    extern void fbg_hslToRGB(struct _fbg_rgb *color, float h, float s, float l);
+
+    //! convert RGB values (0-255) to HSL color (hue in degrees, saturation and lightness in the 0-1 range as fbg_hslToRGB() expect them)
+    /*!
+      \param color pointer to a _fbg_hsl data structure
+      \param r
+      \param g
+      \param b
+      \sa fbg_hslToRGB()
+    */
+    extern void fbg_rgbToHsl(struct _fbg_hsl *color, float r, float g, float b);
+
+    //! convert HSL values to RGB color with fixed-point arithmetic (no float / division per channel, result within 1 of fbg_hslToRGB())
+    /*!
+      \param color pointer to a _fbg_rgb data structure
+      \param h the hue in degrees (wrapped)
+      \param s the saturation (0-255)
+      \param l the lightness (0-255)
+      \sa fbg_hslToRGB(), fbg_hslToRGBArray(), fbg_hslGradient()
+    */
+    extern void fbg_hslToRGBFixed(struct _fbg_rgb *color, int h, int s, int l);
+
+    //! convert an array of HSL colors to RGB (fixed-point)
+    /*!
+      \param colors RGB colors output (count elements)
+      \param hsl HSL colors (count elements)
+      \param count amount of colors
+      \sa fbg_hslToRGBFixed(), fbg_rgbToHslArray()
+    */
+    extern void fbg_hslToRGBArray(struct _fbg_rgb *colors, const struct _fbg_hsl *hsl, int count);
+
+    //! convert an array of RGB colors to HSL (integer hue / chroma, a single division for the saturation)
+    /*!
+      \param hsl HSL colors output (count elements, hue in degrees)
+      \param colors RGB colors (count elements)
+      \param count amount of colors
+      \sa fbg_rgbToHsl(), fbg_hslToRGBArray()
+    */
+    extern void fbg_rgbToHslArray(struct _fbg_hsl *hsl, const struct _fbg_rgb *colors, int count);
+
+    //! generate a palette / gradient ramp by interpolating two HSL colors (the hue is interpolated as is, from 0 to 360 give a full rainbow)
+    /*!
+      \param colors RGB colors output (count elements)
+      \param count amount of colors
+      \param from first color
+      \param to last color
+      \sa fbg_rgbGradient(), fbg_hslToRGBFixed()
+    */
+    extern void fbg_hslGradient(struct _fbg_rgb *colors, int count, const struct _fbg_hsl *from, const struct _fbg_hsl *to);
+
+    //! generate a gradient ramp by interpolating two RGB colors
+    //! note : unlike fbg_hslGradient() each entry is computed exactly (one division per component) so the last entry is always the end color
+    /*!
+      \param colors RGB colors output (count elements)
+      \param count amount of colors
+      \param from first color
+      \param to last color
+      \sa fbg_hslGradient()
+    */
+    extern void fbg_rgbGradient(struct _fbg_rgb *colors, int count, const struct _fbg_rgb *from, const struct _fbg_rgb *to);
+
+    //! set the target framerate, fbg_draw() then wait for the next frame deadline (absolute clock_nanosleep timer) followed by the backend vertical sync when available
+    //! note : the fbdev backend vertical sync (FBIO_WAITFORVSYNC) is only used when the driver support it, the pacing timer alone is used otherwise
+    //! note : without target framerate fbg_draw() only wait for the backend vertical sync
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param fps target framerate (0 = not paced)
+      \sa fbg_getLateFrames(), fbg_draw()
+    */
+    extern void fbg_setTargetFramerate(struct _fbg *fbg, int fps);
+
+    //! get the amount of frames that missed their deadline since the target framerate was set
+    //! note : fbg->frame_late tell wether the last frame was late and fbg->frame_time how long it took (pacing wait excluded)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \return missed frames count
+      \sa fbg_setTargetFramerate()
+    */
+    extern unsigned int fbg_getLateFrames(struct _fbg *fbg);
+
+    //! create a quality governor
+    /*!
+      \param budget frame time budget in milliseconds (0 = 1000 / target framerate, see fbg_setTargetFramerate())
+      \return _fbg_governor structure pointer
+      \sa fbg_governorAddKnob(), fbg_setGovernor(), fbg_freeGovernor()
+    */
+    extern struct _fbg_governor *fbg_createGovernor(float budget);
+
+    //! register a governor knob, knobs are degraded in registration order (register the cheapest quality loss first) and restored in reverse order
+    //! note : a render resolution knob should call fbg_pushResize() from its apply function so that the resize happen at the end of the frame
+    /*!
+      \param governor _fbg_governor structure pointer
+      \param value pointer to the application setting (clamped to min / max)
+      \param min lowest quality value
+      \param max highest quality value
+      \param step amount added / removed at each change
+      \param apply function called after the value changed (can be NULL)
+      \param user_data user data passed to the apply function
+      \return knob index or -1 on failure
+      \sa fbg_createGovernor()
+    */
+    extern int fbg_governorAddKnob(struct _fbg_governor *governor, int *value, int min, int max, int step, void (*apply)(struct _fbg *fbg, int value, void *user_data), void *user_data);
+
+    //! feed a frame time to the governor and apply a quality change if needed (called by fbg_draw() when the governor is attached with fbg_setGovernor())
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param governor _fbg_governor structure pointer
+      \param frame_time last frame time in milliseconds
+      \return -1 if quality was lowered, 1 if quality was raised, 0 otherwise
+      \sa fbg_setGovernor()
+    */
+    extern int fbg_governorUpdate(struct _fbg *fbg, struct _fbg_governor *governor, float frame_time);
+
+    //! attach a governor to a FBG context, fbg_draw() then feed it with fbg->frame_time
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param governor _fbg_governor structure pointer (NULL to detach)
+      \sa fbg_createGovernor()
+    */
+    extern void fbg_setGovernor(struct _fbg *fbg, struct _fbg_governor *governor);
+
+    //! free the memory associated with a governor (detach it first)
+    /*!
+      \param governor _fbg_governor structure pointer
+      \sa fbg_createGovernor()
+    */
+    extern void fbg_freeGovernor(struct _fbg_governor *governor);
+
+    //! draw to the screen
+    /*!
+      \param fbg pointer to a FBG context / data structure
+    */
+    extern void fbg_draw(struct _fbg *fbg);
+
+    //! flip the buffers
+    /*!
+      \param fbg pointer to a FBG context / data structure
+    */
+    extern void fbg_flip(struct _fbg *fbg);
+
+    //! create an empty image
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param width image width
+      \param height image height
+      \return _fbg_img data structure pointer
+      \sa fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_createFont()
+    */
+    extern struct _fbg_img *fbg_createImage(struct _fbg *fbg, unsigned int width, unsigned int height);
+
+
+    //! load an image from memory
+    //! note : the data is always copied (raw images included, see fbg_saveRawImage()), it can be freed or read-only, use fbg_loadRawImage() to map raw image files without copy
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param data The image data from memory.
+      \param size The size of the image in bytes.
+      \return _fbg_img data structure pointer
+      \sa fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_createFont(), fbg_imageClip(), fbg_loadPNG(), fbg_loadJPEG(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+    */
+    extern struct _fbg_img *fbg_loadImageFromMemory(struct _fbg *fbg, const unsigned char *data, int size);
+
+    //! load an image file (raw, PNG or JPEG depending on the file signature)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param filename image file path
+      \return _fbg_img data structure pointer
+      \sa fbg_loadRawImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_freeImage()
+    */
+    extern struct _fbg_img *fbg_loadImage(struct _fbg *fbg, const char *filename);
+
+#ifndef WITHOUT_PNG
+    //! load a PNG image file, rows are decoded one at a time straight into the image in the context format
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param filename PNG file path
+      \return _fbg_img data structure pointer
+      \sa fbg_loadPNGFromMemory(), fbg_loadImage(), fbg_freeImage()
+    */
+    extern struct _fbg_img *fbg_loadPNG(struct _fbg *fbg, const char *filename);
+
+    //! load a PNG image from memory, rows are decoded one at a time straight into the image in the context format
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param data PNG data
+      \param size PNG data size in bytes
+      \return _fbg_img data structure pointer
+      \sa fbg_loadPNG(), fbg_loadImageFromMemory()
+    */
+    extern struct _fbg_img *fbg_loadPNGFromMemory(struct _fbg *fbg, const unsigned char *data, int size);
+#endif
+
+#ifndef WITHOUT_JPEG
+    //! load a JPEG image file with optional downscaling done while decoding (DCT scaling), scanlines are decoded straight into the image in the context format
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param filename JPEG file path
+      \param scale_denom the image is decoded at 1/scale_denom of its size (1, 2, 4 or 8, libjpeg-turbo also support 3, 5, 6 and 7)
+      \return _fbg_img data structure pointer
+      \sa fbg_loadJPEG(), fbg_loadJPEGFromMemoryEx(), fbg_loadImage(), fbg_freeImage()
+    */
+    extern struct _fbg_img *fbg_loadJPEGEx(struct _fbg *fbg, const char *filename, int scale_denom);
+
+    //! load a JPEG image from memory with optional downscaling done while decoding (DCT scaling)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param data JPEG data
+      \param size JPEG data size in bytes
+      \param scale_denom the image is decoded at 1/scale_denom of its size (1, 2, 4 or 8)
+      \return _fbg_img data structure pointer
+      \sa fbg_loadJPEGFromMemory(), fbg_loadJPEGEx(), fbg_loadImageFromMemory()
+    */
+    extern struct _fbg_img *fbg_loadJPEGFromMemoryEx(struct _fbg *fbg, const unsigned char *data, int size, int scale_denom);
+#endif
+
+    //! load a raw image file (see fbg_saveRawImage()) by memory-mapping it, no decoding nor copy happens
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param filename raw image file path
+      \return _fbg_img data structure pointer (with atlas rectangles if any)
+      \sa fbg_saveRawImage(), fbg_loadImageFromMemory(), fbg_freeImage()
+    */
+    extern struct _fbg_img *fbg_loadRawImage(struct _fbg *fbg, const char *filename);
+
+    //! save an image as a raw image file (pre-converted pixel rows in the context format plus an optional atlas rectangles table)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param rects atlas rectangles (can be NULL)
+      \param rects_count amount of atlas rectangles
+      \param filename raw image file path
+      \return 1 on success, 0 on failure
+      \sa fbg_loadRawImage()
+    */
+    extern int fbg_saveRawImage(struct _fbg *fbg, struct _fbg_img *img, const struct _fbg_rect *rects, unsigned int rects_count, const char *filename);
+
+    //! draw an image
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param x image X position (upper left coordinate)
+      \param y image Y position (upper left coordinate)
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+    */
+    extern void fbg_image(struct _fbg *fbg, struct _fbg_img *img, int x, int y);
+
+    //! draw an image with colorkeying support (image colorkey value will be ignored)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param x image X position (upper left coordinate)
+      \param y image Y position (upper left coordinate)
+      \param cr colorkey red component
+      \param cg colorkey green component
+      \param cb colorkey blue component
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_image()
+    */
+    extern void fbg_imageColorkey(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cr, int cg, int cb);
+
+    //! draw a clipped image (also clipped against the display)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param x image X position (upper left coordinate)
+      \param y image Y position (upper left coordinate)
+      \param cx The X coordinate where to start clipping
+      \param cy The Y coordinate where to start clipping
+      \param cw The width of the clipped image (from cx)
+      \param ch The height of the clipped image (from cy)
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_imageEx(), fbg_imageScale(), fbg_imageColorkey()
+    */
+    extern void fbg_imageClip(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int cx, int cy, int cw, int ch);
+
+    //! flip an image vertically (in place, rows are swapped)
+    /*!
+      \param img image structure pointer
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage()
+    */
+    extern void fbg_imageFlip(struct _fbg_img *img);
+
+    //! draw an image with support for clipping and scaling (Nearest-neighbor algorithm)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param x image X position (upper left coordinate)
+      \param y image Y position (upper left coordinate)
+      \param sx The X scale factor
+      \param sy The Y scale factor
+      \param cx The X coordinate where to start clipping
+      \param cy The Y coordinate where to start clipping
+      \param cw The width of the clipped image (from cx)
+      \param ch The height of the clipped image (from cy)
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage(), fbg_imageClip(), fbg_freeImage(), fbg_image(), fbg_imageFlip(), fbg_imageScale(), fbg_imageColorkey()
+    */
+    extern void fbg_imageEx(struct _fbg *fbg, struct _fbg_img *img, int x, int y, float sx, float sy, int cx, int cy, int cw, int ch);
+
+    //! draw an affine transformed image (rotated, scaled, sheared etc. ; Nearest-neighbor algorithm, clipped, rows are processed by the thread pool when set)
+    //! an image pixel (u, v) is drawn at X = a * u + b * v + tx, Y = c * u + d * v + ty
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param a X scale / rotation factor applied to u
+      \param b X shear / rotation factor applied to v
+      \param c Y shear / rotation factor applied to u
+      \param d Y scale / rotation factor applied to v
+      \param tx X translation
+      \param ty Y translation
+      \sa fbg_imageRotate(), fbg_imageQuad(), fbg_imageEx()
+    */
+    extern void fbg_imageAffine(struct _fbg *fbg, struct _fbg_img *img, float a, float b, float c, float d, float tx, float ty);
+
+    //! draw a rotated and scaled image around a pivot point (dial needles, sprites etc.)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param x pivot X position on the display
+      \param y pivot Y position on the display
+      \param pivot_x pivot X position in the image
+      \param pivot_y pivot Y position in the image
+      \param angle clockwise rotation in radians
+      \param scale scale factor
+      \sa fbg_imageAffine()
+    */
+    extern void fbg_imageRotate(struct _fbg *fbg, struct _fbg_img *img, int x, int y, int pivot_x, int pivot_y, float angle, float scale);
+
+    //! draw an image mapped with perspective onto a convex quad (pseudo-3D floors, walls etc. ; Nearest-neighbor algorithm, clipped, rows are processed by the thread pool when set)
+    //! note : texture coordinates are exact every FBG_PERSPECTIVE_SPAN pixels and interpolated linearly in between,
+    //! so the output is an approximation of a per-pixel perspective division (pixels can be one texel off inside the spans)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param vertices quad positions (x, y pairs) of the image upper left, upper right, lower right then lower left corners
+      \sa fbg_imageAffine()
+    */
+    extern void fbg_imageQuad(struct _fbg *fbg, struct _fbg_img *img, const int *vertices);
 
     //! free the memory associated with an image
     /*!
-      \param img image structure pointer
-      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage()
+      \param img image structure pointer
+      \sa fbg_createImage(), fbg_loadPNG(), fbg_loadJPEG(), fbg_loadImage()
+    */
+    extern void fbg_freeImage(struct _fbg_img *img);
+
+    //! create an empty texture atlas
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param width atlas image width
+      \param height atlas image height
+      \return _fbg_atlas structure pointer
+      \sa fbg_atlasAdd(), fbg_atlasAddImages(), fbg_atlasBatch(), fbg_freeAtlas(), fbg_atlasFromImage()
+    */
+    extern struct _fbg_atlas *fbg_createAtlas(struct _fbg *fbg, unsigned int width, unsigned int height);
+
+    //! create a texture atlas from an image atlas rectangles (such as a raw image, see fbg_loadRawImage()), the image is not freed by fbg_freeAtlas()
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \return _fbg_atlas structure pointer (NULL when a rectangle is outside of the image)
+      \sa fbg_createAtlas(), fbg_loadRawImage(), fbg_saveRawImage()
+    */
+    extern struct _fbg_atlas *fbg_atlasFromImage(struct _fbg *fbg, struct _fbg_img *img);
+
+    //! pack an image into a texture atlas (copied, the image can be freed afterward)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param atlas _fbg_atlas structure pointer
+      \param img image structure pointer
+      \return sub-image index or -1 if the image does not fit
+      \sa fbg_atlasAddImages(), fbg_atlasImage(), fbg_atlasBatch()
+    */
+    extern int fbg_atlasAdd(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_img *img);
+
+    //! pack many images into a texture atlas at once (tallest images are packed first for a tighter packing)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param atlas _fbg_atlas structure pointer
+      \param images array of image structure pointers
+      \param count amount of images
+      \param indexes receive the sub-image index of each images (-1 if it does not fit), can be NULL
+      \return amount of packed images
+      \sa fbg_atlasAdd()
+    */
+    extern int fbg_atlasAddImages(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_img **images, int count, int *indexes);
+
+    //! draw a sub-image of a texture atlas
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param atlas _fbg_atlas structure pointer
+      \param index sub-image index (out of range indices draw nothing)
+      \param x X position (upper left coordinate)
+      \param y Y position (upper left coordinate)
+      \sa fbg_atlasBatch(), fbg_imageClip()
+    */
+    extern void fbg_atlasImage(struct _fbg *fbg, struct _fbg_atlas *atlas, int index, int x, int y);
+
+    //! draw many sub-images of a texture atlas, draws are sorted by atlas position for memory locality
+    //! note : the draw order is not preserved so overlapping blits may be drawn in any order
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param atlas _fbg_atlas structure pointer
+      \param blits array of blits (left untouched, blits with an out of range index are skipped)
+      \param count amount of blits
+      \sa fbg_atlasImage()
+    */
+    extern void fbg_atlasBatch(struct _fbg *fbg, struct _fbg_atlas *atlas, struct _fbg_atlas_blit *blits, int count);
+
+    //! free the memory associated with a texture atlas
+    /*!
+      \param atlas _fbg_atlas structure pointer
+      \sa fbg_createAtlas()
+    */
+    extern void fbg_freeAtlas(struct _fbg_atlas *atlas);
+
+    //! create a bitmap font from an image
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param img image structure pointer
+      \param glyph_width glyph / character width
+      \param glyph_height glyph / character height
+      \param first_char the first character of the bitmap font
+      \return _fbg_font structure pointer
+      \sa fbg_freeFont(), fbg_textFont(), fbg_text(), fbg_write(), fbg_drawFramerate()
+    */
+    extern struct _fbg_font *fbg_createFont(struct _fbg *fbg, struct _fbg_img *img, int glyph_width, int glyph_height, unsigned char first_char);
+
+    //! set the current font
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param font _fbg_font structure pointer
+      \sa fbg_createFont(), fbg_text(), fbg_write(), fbg_drawFramerate()
+    */
+    extern void fbg_textFont(struct _fbg *fbg, struct _fbg_font *font);
+
+    //! set the current text color
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param r
+      \param g
+      \param b
+      \sa fbg_createFont(), fbg_write(), fbg_textColorKey(), fbg_textBackground()
+    */
+    extern void fbg_textColor(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b);
+
+    //! set the current text background color (based on colorkey value!)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param r
+      \param g
+      \param b
+      \param a 0 = transparent background (based on colorkey), 255 = full text background
+      \sa fbg_createFont(), fbg_write(), fbg_textColorKey(), fbg_textColor()
+    */
+    extern void fbg_textBackground(struct _fbg *fbg, int r, int g, int b, int a);
+
+    //! set the current text color key
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param v grayscale value
+      \sa fbg_createFont(), fbg_write(), fbg_textColor()
+    */
+    extern void fbg_textColorKey(struct _fbg *fbg, unsigned char v);
+
+    //! draw a text
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param fnt _fbg_font structure pointer
+      \param text the text to draw ('\n' and ' ' are treated automatically)
+      \param x
+      \param y
+      \param r
+      \param g
+      \param b
+      \sa fbg_createFont(), fbg_write(), fbg_textColorkey(), fbg_textBackground()
+    */
+    extern void fbg_text(struct _fbg *fbg, struct _fbg_font *fnt, char *text, int x, int y, int r, int g, int b);
+
+    //! draw a text NEW
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param text the text to draw ('\n' and ' ' are treated automatically)
+      \param x
+      \param y
+      \param font size
+      \param r
+      \param g
+      \param b
+      \sa fbg_createFont(), fbg_write(), fbg_textColorkey(), fbg_textBackground()
+    */
+
+    extern void fbg_text_new(struct _fbg *fbg, const char *text, int x, int y, int font_size, uint8_t r, uint8_t g, uint8_t b);
+
+    //! create a proportional font from glyphs metrics and packed 1-bit rows (data is copied)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param first_char the first character of the font
+      \param glyphs_count amount of glyphs
+      \param line_height distance between two lines in pixels
+      \param glyphs glyphs metrics (can be NULL to fill them afterward)
+      \param bitmap glyph rows, one 32 bits word per row, MSB = leftmost pixel (can be NULL to fill them afterward)
+      \param bitmap_words amount of words in bitmap
+      \return _fbg_pfont structure pointer
+      \sa fbg_createPFontFromBitmap(), fbg_createDefaultPFont(), fbg_pfontText(), fbg_freePFont()
+    */
+    extern struct _fbg_pfont *fbg_createPFont(struct _fbg *fbg, unsigned char first_char, int glyphs_count, int line_height, const struct _fbg_glyph *glyphs, const uint32_t *bitmap, int bitmap_words);
+
+    //! create a proportional font from a fixed 8 pixels wide 1-bit font (such as font.h), glyphs are cropped to their horizontal extent
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param rows glyph rows, glyph_height bytes per glyph, MSB = leftmost pixel
+      \param glyph_height glyph height in pixels
+      \param first_char the first character of the font
+      \param glyphs_count amount of glyphs
+      \param spacing space between glyphs and lines in pixels
+      \return _fbg_pfont structure pointer
+      \sa fbg_createPFont(), fbg_createDefaultPFont()
+    */
+    extern struct _fbg_pfont *fbg_createPFontFromBitmap(struct _fbg *fbg, const uint8_t *rows, int glyph_height, unsigned char first_char, int glyphs_count, int spacing);
+
+    //! create a proportional font from the built-in 8x8 font (as used by fbg_text_new())
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \return _fbg_pfont structure pointer
+      \sa fbg_createPFontFromBitmap(), fbg_pfontText()
+    */
+    extern struct _fbg_pfont *fbg_createDefaultPFont(struct _fbg *fbg);
+
+    //! set the kerning adjustment of a pair of characters
+    /*!
+      \param font _fbg_pfont structure pointer
+      \param left left character
+      \param right right character
+      \param amount pen adjustment in pixels (negative values bring the characters closer)
+      \sa fbg_pfontText(), fbg_pfontTextWidth()
+    */
+    extern void fbg_pfontKerning(struct _fbg_pfont *font, unsigned char left, unsigned char right, int amount);
+
+    //! measure a text drawn with a proportional font (constant time per character)
+    /*!
+      \param font _fbg_pfont structure pointer
+      \param text the text to measure ('\n' is treated automatically)
+      \return width of the widest line in pixels
+      \sa fbg_pfontText()
     */
-    extern void fbg_freeImage(struct _fbg_img *img);
+    extern int fbg_pfontTextWidth(struct _fbg_pfont *font, const char *text);
 
-    //! create a bitmap font from an image
+    //! draw a text with a proportional font, glyph rows are drawn as spans (clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param img image structure pointer
-      \param glyph_width glyph / character width
-      \param glyph_height glyph / character height
-      \param first_char the first character of the bitmap font
-      \return _fbg_font structure pointer
-      \sa fbg_freeFont(), fbg_textFont(), fbg_text(), fbg_write(), fbg_drawFramerate()
+      \param font _fbg_pfont structure pointer
+      \param text the text to draw ('\n' is treated automatically)
+      \param x
+      \param y
+      \param r
+      \param g
+      \param b
+      \sa fbg_pfontTextWidth(), fbg_createPFont()
     */
-    extern struct _fbg_font *fbg_createFont(struct _fbg *fbg, struct _fbg_img *img, int glyph_width, int glyph_height, unsigned char first_char);
+    extern void fbg_pfontText(struct _fbg *fbg, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b);
 
-    //! set the current font
+    //! free the memory associated with a proportional font
+    /*!
+      \param font _fbg_pfont structure pointer
+      \sa fbg_createPFont()
+    */
+    extern void fbg_freePFont(struct _fbg_pfont *font);
+
+    //! create an anti-aliased font of a given pixel size from a proportional font (glyphs are area sampled into 8-bit coverage masks)
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param font _fbg_font structure pointer
-      \sa fbg_createFont(), fbg_text(), fbg_write(), fbg_drawFramerate()
+      \param source _fbg_pfont structure pointer (can be freed afterward)
+      \param pixel_height line height of the new font in pixels
+      \return _fbg_afont structure pointer
+      \sa fbg_afontText(), fbg_afontTextWidth(), fbg_freeAFont(), fbg_createDefaultPFont()
     */
-    extern void fbg_textFont(struct _fbg *fbg, struct _fbg_font *font);
+    extern struct _fbg_afont *fbg_createAFont(struct _fbg *fbg, struct _fbg_pfont *source, int pixel_height);
 
-    //! set the current text color
+    //! measure a text drawn with an anti-aliased font (constant time per character)
+    /*!
+      \param font _fbg_afont structure pointer
+      \param text the text to measure ('\n' is treated automatically)
+      \return width of the widest line in pixels
+      \sa fbg_afontText()
+    */
+    extern int fbg_afontTextWidth(struct _fbg_afont *font, const char *text);
+
+    //! draw a text with an anti-aliased font (clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
+      \param font _fbg_afont structure pointer
+      \param text the text to draw ('\n' is treated automatically)
+      \param x
+      \param y
       \param r
       \param g
       \param b
-      \sa fbg_createFont(), fbg_write(), fbg_textColorKey(), fbg_textBackground()
+      \sa fbg_createAFont(), fbg_maskBlend()
     */
-    extern void fbg_textColor(struct _fbg *fbg, unsigned char r, unsigned char g, unsigned char b);
+    extern void fbg_afontText(struct _fbg *fbg, struct _fbg_afont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b);
 
-    //! set the current text background color (based on colorkey value!)
+    //! free the memory associated with an anti-aliased font
+    /*!
+      \param font _fbg_afont structure pointer
+      \sa fbg_createAFont()
+    */
+    extern void fbg_freeAFont(struct _fbg_afont *font);
+
+    //! blend a color through an 8-bit coverage mask (clipped against the display)
     /*!
       \param fbg pointer to a FBG context / data structure
+      \param mask coverage mask (0 = untouched, 255 = color)
+      \param mask_stride mask line length in bytes
+      \param x mask X position (upper left coordinate)
+      \param y mask Y position (upper left coordinate)
+      \param w mask width
+      \param h mask height
       \param r
       \param g
       \param b
-      \param a 0 = transparent background (based on colorkey), 255 = full text background
-      \sa fbg_createFont(), fbg_write(), fbg_textColorKey(), fbg_textColor()
+      \sa fbg_afontText()
     */
-    extern void fbg_textBackground(struct _fbg *fbg, int r, int g, int b, int a);
+    extern void fbg_maskBlend(struct _fbg *fbg, const uint8_t *mask, int mask_stride, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b);
 
-    //! set the current text color key
+    //! create a text cache
+    //! note : runs are independent of the color so a cached text can be drawn with any color
     /*!
-      \param fbg pointer to a FBG context / data structure
-      \param v grayscale value
-      \sa fbg_createFont(), fbg_write(), fbg_textColor()
+      \param entries_count amount of cached texts (rounded up to a power of two)
+      \return _fbg_text_cache structure pointer
+      \sa fbg_textCached(), fbg_pfontTextCached(), fbg_freeTextCache()
     */
-    extern void fbg_textColorKey(struct _fbg *fbg, unsigned char v);
+    extern struct _fbg_text_cache *fbg_createTextCache(int entries_count);
 
-    //! draw a text
+    //! draw a text with the built-in font (same output as fbg_text_new()) through a text cache
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param fnt _fbg_font structure pointer
-      \param text the text to draw ('\n' and ' ' are treated automatically)
+      \param cache _fbg_text_cache structure pointer
+      \param text the text to draw
       \param x
       \param y
+      \param font_size font scale
       \param r
       \param g
       \param b
-      \sa fbg_createFont(), fbg_write(), fbg_textColorkey(), fbg_textBackground()
+      \sa fbg_createTextCache(), fbg_text_new()
     */
-    extern void fbg_text(struct _fbg *fbg, struct _fbg_font *fnt, char *text, int x, int y, int r, int g, int b);
+    extern void fbg_textCached(struct _fbg *fbg, struct _fbg_text_cache *cache, const char *text, int x, int y, int font_size, unsigned char r, unsigned char g, unsigned char b);
 
-    //! draw a text NEW
+    //! draw a text with a proportional font (same output as fbg_pfontText()) through a text cache
+    //! note : entries are keyed by the font address, clear the cache (fbg_freeTextCache()) when freeing fonts
     /*!
       \param fbg pointer to a FBG context / data structure
-      \param text the text to draw ('\n' and ' ' are treated automatically)
+      \param cache _fbg_text_cache structure pointer
+      \param font _fbg_pfont structure pointer
+      \param text the text to draw ('\n' is treated automatically)
       \param x
       \param y
-      \param font size
       \param r
       \param g
       \param b
-      \sa fbg_createFont(), fbg_write(), fbg_textColorkey(), fbg_textBackground()
+      \sa fbg_createTextCache(), fbg_pfontText()
     */
+    extern void fbg_pfontTextCached(struct _fbg *fbg, struct _fbg_text_cache *cache, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b);
 
-    extern void fbg_text_new(struct _fbg *fbg, const char *text, int x, int y, int font_size, uint8_t r, uint8_t g, uint8_t b);
+    //! free the memory associated with a text cache
+    /*!
+      \param cache _fbg_text_cache structure pointer
+      \sa fbg_createTextCache()
+    */
+    extern void fbg_freeTextCache(struct _fbg_text_cache *cache);
+
+    //! create a character-cell console using the built-in font
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param cols amount of columns
+      \param rows amount of rows
+      \param font_size built-in font scale
+      \return _fbg_console structure pointer (NULL when a size is not positive)
+      \sa fbg_consoleWrite(), fbg_consoleDraw(), fbg_consoleDrawDirty(), fbg_freeConsole()
+    */
+    extern struct _fbg_console *fbg_createConsole(struct _fbg *fbg, int cols, int rows, int font_size);
+
+    //! set the console colors used by subsequent writes
+    /*!
+      \param console _fbg_console structure pointer
+      \param fr foreground red
+      \param fg foreground green
+      \param fb foreground blue
+      \param br background red
+      \param bg background green
+      \param bb background blue
+      \sa fbg_consoleWrite(), fbg_consoleSetCell()
+    */
+    extern void fbg_consoleColor(struct _fbg_console *console, unsigned char fr, unsigned char fg, unsigned char fb, unsigned char br, unsigned char bg, unsigned char bb);
+
+    //! set a console cell with the current colors (the cell is rasterized again only if it changed)
+    /*!
+      \param console _fbg_console structure pointer
+      \param col cell column
+      \param row cell row
+      \param c ASCII character
+      \sa fbg_consoleColor(), fbg_consoleDraw()
+    */
+    extern void fbg_consoleSetCell(struct _fbg_console *console, int col, int row, unsigned char c);
+
+    //! write a character at the cursor position ('\n' and '\r' are treated automatically, the console scroll when the cursor go past the last row)
+    /*!
+      \param console _fbg_console structure pointer
+      \param c ASCII character
+      \sa fbg_consoleWrite(), fbg_consoleMove()
+    */
+    extern void fbg_consolePutc(struct _fbg_console *console, char c);
+
+    //! write a text at the cursor position
+    /*!
+      \param console _fbg_console structure pointer
+      \param text the text to write
+      \sa fbg_consolePutc()
+    */
+    extern void fbg_consoleWrite(struct _fbg_console *console, const char *text);
+
+    //! move the console cursor
+    /*!
+      \param console _fbg_console structure pointer
+      \param col cursor column
+      \param row cursor row
+    */
+    extern void fbg_consoleMove(struct _fbg_console *console, int col, int row);
+
+    //! scroll the console up, rasterized rows are moved so only the new rows are rasterized
+    /*!
+      \param console _fbg_console structure pointer
+      \param lines amount of rows to scroll
+    */
+    extern void fbg_consoleScroll(struct _fbg_console *console, int lines);
+
+    //! clear the console with the current background color and move the cursor home
+    /*!
+      \param console _fbg_console structure pointer
+    */
+    extern void fbg_consoleClear(struct _fbg_console *console);
+
+    //! rasterize the modified cells and draw the console (clipped against the display)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param console _fbg_console structure pointer
+      \param x console X position (upper left coordinate)
+      \param y console Y position (upper left coordinate)
+      \sa fbg_createConsole(), fbg_consoleDrawDirty()
+    */
+    extern void fbg_consoleDraw(struct _fbg *fbg, struct _fbg_console *console, int x, int y);
+
+    //! rasterize the modified cells and draw only the console rows changed by this draw and the previous one (clipped against the display)
+    //! note : the buffers must keep the console from the previous frames (no clear under it, same position), the back buffer can be the frame before last (swapped buffers)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param console _fbg_console structure pointer
+      \param x console X position (upper left coordinate)
+      \param y console Y position (upper left coordinate)
+      \sa fbg_consoleDraw()
+    */
+    extern void fbg_consoleDrawDirty(struct _fbg *fbg, struct _fbg_console *console, int x, int y);
+
+    //! free the memory associated with a console
+    /*!
+      \param console _fbg_console structure pointer
+      \sa fbg_createConsole()
+    */
+    extern void fbg_freeConsole(struct _fbg_console *console);
+
+    //! create an indexed (8-bit palette) surface, all indices are 0 and the palette is black
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param width surface width
+      \param height surface height
+      \return _fbg_indexed structure pointer
+      \sa fbg_indexedDraw(), fbg_setIndexed(), fbg_indexedColor(), fbg_freeIndexed()
+    */
+    extern struct _fbg_indexed *fbg_createIndexed(struct _fbg *fbg, int width, int height);
+
+    //! set a palette entry
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param index palette index
+      \param r
+      \param g
+      \param b
+      \sa fbg_indexedPalette(), fbg_indexedCycle()
+    */
+    extern void fbg_indexedColor(struct _fbg_indexed *indexed, unsigned char index, unsigned char r, unsigned char g, unsigned char b);
+
+    //! set consecutive palette entries
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param first first palette index
+      \param count amount of entries (clamped to the palette)
+      \param colors palette colors (generated by fbg_hslGradient() / fbg_rgbGradient() for example)
+      \sa fbg_indexedColor(), fbg_hslGradient()
+    */
+    extern void fbg_indexedPalette(struct _fbg_indexed *indexed, int first, int count, const struct _fbg_rgb *colors);
+
+    //! rotate a range of palette entries (color cycling, the indices are untouched)
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param first first palette index of the range
+      \param count amount of entries of the range (clamped to the palette)
+      \param amount rotation amount (positive = the colors move toward higher indices)
+      \sa fbg_indexedPalette()
+    */
+    extern void fbg_indexedCycle(struct _fbg_indexed *indexed, int first, int count, int amount);
+
+    //! set all the indices of a surface
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param index palette index
+    */
+    extern void fbg_indexedClear(struct _fbg_indexed *indexed, unsigned char index);
+
+    //! set the index of a pixel (no clipping)
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param x
+      \param y
+      \param index palette index
+    */
+    extern void fbg_indexedPixel(struct _fbg_indexed *indexed, int x, int y, unsigned char index);
+
+    //! fill a rectangle with an index (clipped against the surface)
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param index palette index
+    */
+    extern void fbg_indexedRect(struct _fbg_indexed *indexed, int x, int y, int w, int h, unsigned char index);
+
+    //! draw a line with an index (clipped against the surface)
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \param x1 first point X position
+      \param y1 first point Y position
+      \param x2 second point X position
+      \param y2 second point Y position
+      \param index palette index
+    */
+    extern void fbg_indexedLine(struct _fbg_indexed *indexed, int x1, int y1, int x2, int y2, unsigned char index);
+
+    //! expand an indexed surface into the back buffer through its palette (clipped against the display, rows are processed by the thread pool when set)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param indexed _fbg_indexed structure pointer
+      \param x surface X position (upper left coordinate)
+      \param y surface Y position (upper left coordinate)
+      \sa fbg_setIndexed()
+    */
+    extern void fbg_indexedDraw(struct _fbg *fbg, struct _fbg_indexed *indexed, int x, int y);
+
+    //! make fbg_draw() expand an indexed surface into the back buffer (at 0, 0) before the backend draw, the context then render in indexed mode
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param indexed _fbg_indexed structure pointer (NULL = disabled)
+      \sa fbg_indexedDraw()
+    */
+    extern void fbg_setIndexed(struct _fbg *fbg, struct _fbg_indexed *indexed);
+
+    //! free the memory associated with an indexed surface
+    /*!
+      \param indexed _fbg_indexed structure pointer
+      \sa fbg_createIndexed()
+    */
+    extern void fbg_freeIndexed(struct _fbg_indexed *indexed);
+
+    //! create a linear gradient, colors vary from the start point to the end point and are extended beyond them (the ramp is black)
+    /*!
+      \param x0 start point X position
+      \param y0 start point Y position
+      \param x1 end point X position
+      \param y1 end point Y position
+      \return _fbg_gradient structure pointer
+      \sa fbg_gradientStops(), fbg_gradientRect(), fbg_gradientLinear(), fbg_freeGradient()
+    */
+    extern struct _fbg_gradient *fbg_createLinearGradient(int x0, int y0, int x1, int y1);
+
+    //! create a radial gradient, colors vary from the center to the radius and are extended beyond it (the ramp is black)
+    /*!
+      \param x center X position
+      \param y center Y position
+      \param radius radius
+      \return _fbg_gradient structure pointer
+      \sa fbg_gradientStops(), fbg_gradientRect(), fbg_gradientRadial(), fbg_freeGradient()
+    */
+    extern struct _fbg_gradient *fbg_createRadialGradient(int x, int y, int radius);
+
+    //! make a gradient linear / move its points (the ramp is kept)
+    /*!
+      \param gradient _fbg_gradient structure pointer
+      \param x0 start point X position
+      \param y0 start point Y position
+      \param x1 end point X position
+      \param y1 end point Y position
+      \sa fbg_createLinearGradient()
+    */
+    extern void fbg_gradientLinear(struct _fbg_gradient *gradient, int x0, int y0, int x1, int y1);
+
+    //! make a gradient radial / move its center or change its radius (the ramp is kept)
+    /*!
+      \param gradient _fbg_gradient structure pointer
+      \param x center X position
+      \param y center Y position
+      \param radius radius
+      \sa fbg_createRadialGradient()
+    */
+    extern void fbg_gradientRadial(struct _fbg_gradient *gradient, int x, int y, int radius);
+
+    //! set the gradient ramp from evenly spaced color stops (interpolated in RGB, 256 stops are copied as is)
+    /*!
+      \param gradient _fbg_gradient structure pointer
+      \param colors stops colors (a ramp generated by fbg_hslGradient() for example)
+      \param count stops count (1 to 256)
+      \sa fbg_rgbGradient(), fbg_hslGradient()
+    */
+    extern void fbg_gradientStops(struct _fbg_gradient *gradient, const struct _fbg_rgb *colors, int count);
+
+    //! draw a gradient horizontal span (clipped)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param gradient _fbg_gradient structure pointer
+      \param x span X position
+      \param y span Y position
+      \param w span width
+      \sa fbg_gradientRect()
+    */
+    extern void fbg_gradientSpan(struct _fbg *fbg, struct _fbg_gradient *gradient, int x, int y, int w);
+
+    //! fill a rectangle with a gradient (clipped, rows are processed by the thread pool when set)
+    //! note : runs before / after the ramp are filled with a single color and rows of horizontal ramps are copied, these cost about a memset
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param gradient _fbg_gradient structure pointer
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \sa fbg_gradientSpan(), fbg_gradientBackground()
+    */
+    extern void fbg_gradientRect(struct _fbg *fbg, struct _fbg_gradient *gradient, int x, int y, int w, int h);
+
+    //! fill the whole back buffer with a gradient
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param gradient _fbg_gradient structure pointer
+      \sa fbg_gradientRect(), fbg_background()
+    */
+    extern void fbg_gradientBackground(struct _fbg *fbg, struct _fbg_gradient *gradient);
+
+    //! free the memory associated with a gradient
+    /*!
+      \param gradient _fbg_gradient structure pointer
+      \sa fbg_createLinearGradient(), fbg_createRadialGradient()
+    */
+    extern void fbg_freeGradient(struct _fbg_gradient *gradient);
+
+    //! create a lock-free command queue, any threads can push commands and the render thread execute them with fbg_queueDrain()
+    /*!
+      \param capacity maximum amount of pending commands (rounded up to a power of two)
+      \return _fbg_queue structure pointer
+      \sa fbg_queuePush(), fbg_queueDrain(), fbg_freeQueue()
+    */
+    extern struct _fbg_queue *fbg_createQueue(int capacity);
+
+    //! push a command to the queue (lock-free, can be called from any thread)
+    /*!
+      \param queue _fbg_queue structure pointer
+      \param command command to copy into the queue
+      \return 1 if the command was queued, 0 if the queue was full (the command is dropped)
+      \sa fbg_queueText(), fbg_queueRect(), fbg_queueImage(), fbg_queueCallback()
+    */
+    extern int fbg_queuePush(struct _fbg_queue *queue, const struct _fbg_command *command);
+
+    //! queue a text (truncated to FBG_COMMAND_TEXT_SIZE - 1 characters)
+    //! note : with the built-in font the text is skipped if it does not fit in the display
+    /*!
+      \param queue _fbg_queue structure pointer
+      \param font proportional font (NULL = built-in font)
+      \param text text to draw
+      \param x text X position (upper left coordinate)
+      \param y text Y position (upper left coordinate)
+      \param r red
+      \param g green
+      \param b blue
+      \return 1 if the command was queued, 0 otherwise
+      \sa fbg_queuePush()
+    */
+    extern int fbg_queueText(struct _fbg_queue *queue, struct _fbg_pfont *font, const char *text, int x, int y, unsigned char r, unsigned char g, unsigned char b);
+
+    //! queue a filled rectangle (clipped against the display when executed)
+    /*!
+      \param queue _fbg_queue structure pointer
+      \param x rectangle X position (upper left coordinate)
+      \param y rectangle Y position (upper left coordinate)
+      \param w rectangle width
+      \param h rectangle height
+      \param r red
+      \param g green
+      \param b blue
+      \param a alpha (255 = opaque)
+      \return 1 if the command was queued, 0 otherwise
+      \sa fbg_queuePush()
+    */
+    extern int fbg_queueRect(struct _fbg_queue *queue, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+    //! queue an image update, the pixels are copied into the image by the render thread
+    /*!
+      \param queue _fbg_queue structure pointer
+      \param img image to update
+      \param data new pixels (img->width * img->height * fbg->components bytes) allocated with malloc(), ownership is transferred to the queue (also freed when the queue is full)
+      \return 1 if the command was queued, 0 otherwise
+      \sa fbg_queuePush()
+    */
+    extern int fbg_queueImage(struct _fbg_queue *queue, struct _fbg_img *img, unsigned char *data);
+
+    //! queue a function call executed on the render thread
+    /*!
+      \param queue _fbg_queue structure pointer
+      \param callback function to call
+      \param user_data user data passed to the function
+      \return 1 if the command was queued, 0 otherwise
+      \sa fbg_queuePush()
+    */
+    extern int fbg_queueCallback(struct _fbg_queue *queue, void (*callback)(struct _fbg *fbg, void *user_data), void *user_data);
+
+    //! execute the pending commands in push order (render thread only, typically once per frame after fbg_clear())
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param queue _fbg_queue structure pointer
+      \return amount of executed commands
+      \sa fbg_createQueue()
+    */
+    extern int fbg_queueDrain(struct _fbg *fbg, struct _fbg_queue *queue);
+
+    //! free the memory associated with a queue (pending image updates are freed)
+    /*!
+      \param queue _fbg_queue structure pointer
+      \sa fbg_createQueue()
+    */
+    extern void fbg_freeQueue(struct _fbg_queue *queue);
+
+    //! start recording the calls made on a context into a trace file (library built with -DFBG_TRACE)
+    //! traced calls : fbg_draw, fbg_flip, fbg_resize / pushed resizes, fbg_clear, fbg_background, fbg_fadeDown, fbg_fadeUp, fbg_fill, fbg_pixel, fbg_pixela, fbg_fpixel,
+    //! fbg_hline, fbg_vline, fbg_line, fbg_polygon, fbg_rect, fbg_recta, fbg_frect, fbg_text_new, fbg_image, fbg_imageColorkey, fbg_imageClip, fbg_imageEx,
+    //! circles / ellipses / rounded rectangles, fbg_span, fbg_spana, fbg_imageAffine (fbg_imageRotate), fbg_imageQuad, fbg_atlasImage, fbg_atlasBatch
+    //! note : other calls are captured through the traced calls they use (fbg_text draw with fbg_pixel etc.)
+    //! calls writing the buffers directly (fbg_maskBlend / fbg_afontText, gradients, fbg_indexedDraw / fbg_setIndexed, fbg_plot, fbg_drawInto) are not captured,
+    //! an untraced call marker is recorded instead so fbg_traceReplay() report the frames which cannot be reproduced
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param path trace file path
+      \return 1 on success, 0 on failure (or when the library was built without FBG_TRACE)
+      \sa fbg_traceStop(), fbg_traceReplay()
+    */
+    extern int fbg_traceStart(struct _fbg *fbg, const char *path);
+
+    //! stop recording (flush and close the trace file)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \sa fbg_traceStart()
+    */
+    extern void fbg_traceStop(struct _fbg *fbg);
+
+    //! checksum of a frame (64-bit FNV-1a of the pixels, row padding excluded)
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param buffer frame buffer (typically fbg->disp_buffer after fbg_flip)
+      \return frame checksum
+    */
+    extern uint64_t fbg_frameChecksum(struct _fbg *fbg, const unsigned char *buffer);
+
+    //! replay a trace against a memory context (no backend) and measure each call
+    /*!
+      \param path trace file path
+      \param frame_callback function called after each replayed fbg_flip with the frame checksum and the frame replay time in nanoseconds (can be NULL)
+      \param user_data user data passed to the callback
+      \param stats per call timings and amount of frames using untraced calls (can be NULL)
+      \return replayed frames count, -1 on failure
+      \sa fbg_traceStart()
+    */
+    extern int fbg_traceReplay(const char *path, void (*frame_callback)(struct _fbg *fbg, uint32_t frame, uint64_t checksum, uint64_t time, void *user_data), void *user_data, struct _fbg_trace_stats *stats);
 
     //! free the memory associated with a font
     /*!
@@ -632,6 +2442,74 @@
     */
     extern void fbg_drawInto(struct _fbg *fbg, unsigned char *buffer);
 
+    //! create a memory arena
+    /*!
+      \param block_size minimum size of the arena blocks in bytes (0 = FBG_ARENA_BLOCK_SIZE)
+      \return _fbg_arena structure pointer
+      \sa fbg_arenaAlloc(), fbg_arenaReset(), fbg_freeArena(), fbg_setAssetsArena()
+    */
+    extern struct _fbg_arena *fbg_createArena(size_t block_size);
+
+    //! allocate zero-initialized memory aligned on FBG_BUFFER_ALIGNMENT bytes (can be released with free())
+    /*!
+      \param size amount of bytes to allocate
+      \return pointer to the allocated memory or NULL
+      \sa fbg_customSetup(), fbg_createImage()
+    */
+    extern void *fbg_alignedAlloc(size_t size);
+
+    //! allocate zero-initialized memory from an arena (memory is aligned on FBG_ARENA_ALIGNMENT bytes)
+    /*!
+      \param arena _fbg_arena structure pointer
+      \param size amount of bytes to allocate
+      \return pointer to the allocated memory or NULL
+      \sa fbg_createArena(), fbg_arenaReset()
+    */
+    extern void *fbg_arenaAlloc(struct _fbg_arena *arena, size_t size);
+
+    //! allocate zero-initialized memory from an arena with a custom alignment
+    /*!
+      \param arena _fbg_arena structure pointer
+      \param size amount of bytes to allocate
+      \param alignment memory alignment in bytes (power of two)
+      \return pointer to the allocated memory or NULL
+      \sa fbg_createArena(), fbg_arenaAlloc()
+    */
+    extern void *fbg_arenaAllocAligned(struct _fbg_arena *arena, size_t size, size_t alignment);
+
+    //! release all the allocations of an arena at once, the memory is kept for further allocations
+    //! note : a chain of blocks is merged into a single block so that the arena stabilize after a few resets
+    /*!
+      \param arena _fbg_arena structure pointer
+      \sa fbg_createArena(), fbg_arenaAlloc(), fbg_freeArena()
+    */
+    extern void fbg_arenaReset(struct _fbg_arena *arena);
+
+    //! free an arena and all its allocations
+    /*!
+      \param arena _fbg_arena structure pointer
+      \sa fbg_createArena(), fbg_arenaReset()
+    */
+    extern void fbg_freeArena(struct _fbg_arena *arena);
+
+    //! set the arena used by fbg_createImage() and fbg_createFont(), the arena is not freed by fbg_close()
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param arena _fbg_arena structure pointer, assets are allocated on the heap if NULL
+      \sa fbg_createArena(), fbg_createImage(), fbg_createFont()
+    */
+    extern void fbg_setAssetsArena(struct _fbg *fbg, struct _fbg_arena *arena);
+
+    //! allocate zero-initialized per-frame scratch memory (spans, edge tables, command lists etc.)
+    //! note : the memory is only valid until the next fbg_flip() call
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param size amount of bytes to allocate
+      \return pointer to the allocated memory or NULL
+      \sa fbg_flip(), fbg_arenaAlloc()
+    */
+    extern void *fbg_scratchAlloc(struct _fbg *fbg, size_t size);
+
     //! pseudo random number between min / max
     /*!
       \param min
@@ -671,10 +2549,67 @@
     */
     #define fbg_imageScale(fbg, img, x, y, sx, sy) fbg_imageEx(fbg, img, x, y, sx, sy, 0, 0, img->width, img->height)
 
+    //! internal buffers and images data alignment in bytes (cache line size)
+    #define FBG_BUFFER_ALIGNMENT 64
+
+    #ifndef FBG_STRIDE_ALIGNMENT
+    //! internal buffers line length alignment in bytes, build with -DFBG_STRIDE_ALIGNMENT=64 so that every row start aligned (1 = packed rows)
+    #define FBG_STRIDE_ALIGNMENT 1
+    #endif
+
+    #ifndef FBG_PERSPECTIVE_SPAN
+    //! perspective mapped spans are interpolated linearly between exact texture coordinates computed every FBG_PERSPECTIVE_SPAN pixels (1 = exact division per pixel, the golden values assume 16)
+    #define FBG_PERSPECTIVE_SPAN 16
+    #endif
+
+    #ifndef FBG_IMAGE_MAX_SIZE
+    //! largest image data in bytes accepted by fbg_createImage() (decoded image headers above it are rejected)
+    #define FBG_IMAGE_MAX_SIZE (256 * 1024 * 1024)
+    #endif
+
+    #ifndef FBG_PARALLEL_THRESHOLD
+    //! buffer size in bytes below which full-buffer operations stay serial
+    #define FBG_PARALLEL_THRESHOLD (256 * 1024)
+    #endif
+
+    //! default arena block size in bytes
+    #define FBG_ARENA_BLOCK_SIZE (64 * 1024)
+    //! arena allocations alignment in bytes
+    #define FBG_ARENA_ALIGNMENT 16
+
+    //! amount of slots probed by a text cache lookup
+    #define FBG_TEXT_CACHE_PROBES 8
+
+    //! raw image file identifier
+    #define FBG_RAW_MAGIC "FBGR"
+    //! raw image file format version
+    #define FBG_RAW_VERSION 1
+
+#ifndef WITHOUT_JPEG
+    //! load a JPEG image file at full size
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param filename JPEG file path
+      \sa fbg_loadJPEGEx(), fbg_loadImage()
+    */
+    #define fbg_loadJPEG(fbg, filename) fbg_loadJPEGEx(fbg, filename, 1)
+
+    //! load a JPEG image from memory at full size
+    /*!
+      \param fbg pointer to a FBG context / data structure
+      \param data JPEG data
+      \param size JPEG data size in bytes
+      \sa fbg_loadJPEGFromMemoryEx(), fbg_loadImageFromMemory()
+    */
+    #define fbg_loadJPEGFromMemory(fbg, data, size) fbg_loadJPEGFromMemoryEx(fbg, data, size, 1)
+#endif
+
     //! integer MAX Math function
     #define _FBG_MAX(a,b) ((a) > (b) ? a : b)
     //! integer MIN Math function
     #define _FBG_MIN(a,b) ((a) < (b) ? a : b)
+    //! round a value up to a multiple of alignment
+    #define _FBG_ALIGN(value, alignment) ((((value) + (alignment) - 1) / (alignment)) * (alignment))
     //! integer SIGN function
     #define _FBG_SGN(x) ((x<0)?-1:((x>0)?1:0))
 
@@ -0,0 +1,627 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fbgraphics.h"
+
+// golden image checker : render reference scenes of every primitive through a memory context (3 and 4 components, serial and threaded)
+// and compare each frame checksum against the stored golden values, any rewrite of a drawing path must keep them bit-exact
+//   golden golden.txt       check the scenes against golden.txt (exit status 1 on mismatch)
+//   golden -w golden.txt    write the current checksums as golden values
+//   golden                  print the checksums
+
+#define SCENE_WIDTH 400
+#define SCENE_HEIGHT 300
+
+struct _fbg_img *test_image(struct _fbg *fbg, int w, int h) {
+  struct _fbg_img *img = fbg_createImage(fbg, w, h);
+  if (!img) {
+    return NULL;
+  }
+
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      unsigned char *p = img->data + (y * w + x) * fbg->components;
+      p[0] = x * 255 / w;
+      p[1] = y * 255 / h;
+      p[2] = (x ^ y) * 8;
+      if (fbg->components == 4) {
+        p[3] = 255;
+      }
+    }
+  }
+
+  return img;
+}
+
+void scene_fill(struct _fbg *fbg) {
+  fbg_background(fbg, 12, 34, 56);
+  fbg_clear(fbg, 40);
+  fbg_background(fbg, 200, 100, 50);
+  fbg_fadeDown(fbg, 30);
+  fbg_fadeUp(fbg, 10);
+}
+
+void scene_pixels(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  for (int i = 0; i < 2000; i++) {
+    int x = (i * 37) % (SCENE_WIDTH + 20) - 10;
+    int y = (i * 91) % (SCENE_HEIGHT + 20) - 10;
+
+    if (x >= 0 && y >= 0 && x < fbg->width && y < fbg->height) {
+      fbg_pixel(fbg, x, y, i, i * 3, i * 7);
+      fbg_pixela(fbg, fbg->width - 1 - x, y, 255, i, 0, i * 5);
+    }
+  }
+
+  fbg_fill(fbg, 0, 255, 128);
+  fbg_fpixel(fbg, 10, 10);
+}
+
+void scene_lines(struct _fbg *fbg) {
+  fbg_clear(fbg, 16);
+
+  for (int i = 0; i < 40; i++) {
+    fbg_hline(fbg, i * 3, i * 7, 200 - i, 255, i * 6, 0);
+    fbg_vline(fbg, 300 + i * 2, i, 250 - i * 3, 0, i * 6, 255);
+    fbg_line(fbg, 0, 0, SCENE_WIDTH - 1 - i * 9, SCENE_HEIGHT - 1, i * 6, 255, i * 6);
+    fbg_line(fbg, SCENE_WIDTH - 1, i * 7, 0, SCENE_HEIGHT - 1 - i * 2, 200, 0, i * 6);
+  }
+
+  fbg_span(fbg, 0, 150, SCENE_WIDTH, 255, 255, 255);
+}
+
+void scene_rects(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  int vertices[] = { 20, 20, 380, 40, 300, 280, 150, 200, 10, 290 };
+  fbg_polygon(fbg, 5, vertices, 255, 255, 0);
+
+  for (int i = 0; i < 20; i++) {
+    fbg_rect(fbg, i * 17, i * 13, 60, 40, i * 12, 100, 255 - i * 12);
+    fbg_recta(fbg, 340 - i * 17, i * 13, 60, 40, 255, i * 12, 0, 40 + i * 10);
+  }
+
+  fbg_fill(fbg, 10, 200, 30);
+  fbg_frect(fbg, 150, 100, 100, 100);
+}
+
+void scene_images(struct _fbg *fbg) {
+  fbg_clear(fbg, 32);
+
+  struct _fbg_img *img = test_image(fbg, 64, 48);
+  if (!img) {
+    return;
+  }
+
+  fbg_image(fbg, img, 0, 0);
+  fbg_imageColorkey(fbg, img, 70, 0, 0, 0, 0);
+  fbg_imageClip(fbg, img, 140, 0, 10, 8, 40, 30);
+  fbg_imageEx(fbg, img, 0, 60, 2.5f, 1.5f, 0, 0, 64, 48);
+  fbg_imageEx(fbg, img, 200, 60, 0.75f, 3.0f, 8, 8, 48, 32);
+
+  // flipping twice must restore the image
+  fbg_imageFlip(img);
+  fbg_image(fbg, img, 300, 0);
+  fbg_imageFlip(img);
+  fbg_image(fbg, img, 300, 200);
+
+  fbg_freeImage(img);
+}
+
+void scene_text(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  fbg_text_new(fbg, "FBGraphics 0123456789", 4, 4, 1, 255, 255, 255);
+  fbg_text_new(fbg, "Golden", 4, 40, 3, 255, 128, 0);
+
+  struct _fbg_console *console = fbg_createConsole(fbg, 30, 8, 1);
+  if (!console) {
+    return;
+  }
+
+  fbg_consoleColor(console, 0, 255, 0, 0, 0, 64);
+  fbg_consoleWrite(console, "console line 1\nconsole line 2\n");
+  fbg_consoleDraw(fbg, console, 100, 150);
+
+  fbg_freeConsole(console);
+}
+
+void scene_console(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  struct _fbg_console *dirty = fbg_createConsole(fbg, 24, 6, 1);
+  struct _fbg_console *full = fbg_createConsole(fbg, 24, 6, 1);
+  if (!dirty || !full) {
+    return;
+  }
+
+  // the same writes drawn as dirty rows and fully must give the same console
+  const char *writes[4] = { "line 1\nline 2\n", "line 3", "\nline 4\nline 5\nline 6\nline 7", " end" };
+  for (int i = 0; i < 4; i++) {
+    fbg_consoleColor(dirty, 255, 255 - i * 60, 0, 0, 0, 64 + i * 32);
+    fbg_consoleColor(full, 255, 255 - i * 60, 0, 0, 0, 64 + i * 32);
+    fbg_consoleWrite(dirty, writes[i]);
+    fbg_consoleWrite(full, writes[i]);
+    fbg_consoleDrawDirty(fbg, dirty, 10, 10);
+  }
+
+  // only the last row is copied from now on, the rectangle over the first rows stay
+  fbg_rect(fbg, 10, 10, 40, 16, 128, 0, 0);
+  for (int i = 0; i < 2; i++) {
+    fbg_consoleWrite(dirty, "!");
+    fbg_consoleWrite(full, "!");
+    fbg_consoleDrawDirty(fbg, dirty, 10, 10);
+  }
+
+  fbg_consoleDraw(fbg, full, 10, 150);
+
+  fbg_freeConsole(dirty);
+  fbg_freeConsole(full);
+}
+
+void scene_hsl(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  // RGB -> HSL -> RGB round trip of a color ramp
+  for (int x = 0; x < fbg->width; x++) {
+    struct _fbg_rgb rgb;
+    struct _fbg_hsl hsl;
+
+    fbg_hslToRGB(&rgb, x * 360 / fbg->width, 0.8f, 0.5f);
+    fbg_vline(fbg, x, 0, 150, rgb.r, rgb.g, rgb.b);
+
+    fbg_rgbToHsl(&hsl, rgb.r, rgb.g, rgb.b);
+    fbg_hslToRGB(&rgb, hsl.h, hsl.s, hsl.l);
+    fbg_vline(fbg, x, 150, 150, rgb.r, rgb.g, rgb.b);
+  }
+}
+
+void scene_ramps(struct _fbg *fbg) {
+  struct _fbg_rgb ramp[SCENE_WIDTH];
+  struct _fbg_hsl hsl[SCENE_WIDTH];
+
+  struct _fbg_hsl from = { -60, 1.0f, 0.25f }, to = { 660, 0.5f, 0.75f };
+  fbg_hslGradient(ramp, SCENE_WIDTH, &from, &to);
+
+  struct _fbg_rgb black = { 0, 0, 0, 0 }, orange = { 255, 128, 16, 0 };
+  fbg_rgbGradient(&ramp[SCENE_WIDTH / 2], SCENE_WIDTH / 2, &black, &orange);
+
+  // batch RGB -> HSL -> RGB round trip
+  fbg_rgbToHslArray(hsl, ramp, SCENE_WIDTH);
+  for (int x = 0; x < SCENE_WIDTH; x++) {
+    fbg_vline(fbg, x, 0, 100, ramp[x].r, ramp[x].g, ramp[x].b);
+  }
+
+  fbg_hslToRGBArray(ramp, hsl, SCENE_WIDTH);
+  for (int x = 0; x < SCENE_WIDTH; x++) {
+    fbg_vline(fbg, x, 100, 100, ramp[x].r, ramp[x].g, ramp[x].b);
+
+    fbg_hslToRGBFixed(&ramp[x], x, x * 255 / SCENE_WIDTH, 128);
+    fbg_vline(fbg, x, 200, 100, ramp[x].r, ramp[x].g, ramp[x].b);
+  }
+}
+
+void scene_indexed(struct _fbg *fbg) {
+  fbg_clear(fbg, 20);
+
+  struct _fbg_indexed *indexed = fbg_createIndexed(fbg, 320, 200);
+  if (!indexed) {
+    return;
+  }
+
+  struct _fbg_rgb palette[64];
+  struct _fbg_hsl from = { 0, 1.0f, 0.5f }, to = { 360, 1.0f, 0.5f };
+  fbg_hslGradient(palette, 64, &from, &to);
+  fbg_indexedPalette(indexed, 1, 64, palette);
+  fbg_indexedColor(indexed, 100, 255, 255, 255);
+
+  for (int y = 0; y < indexed->height; y++) {
+    fbg_indexedRect(indexed, 0, y, indexed->width, 1, 1 + (y * 63) / indexed->height);
+  }
+
+  fbg_indexedRect(indexed, -10, -10, 40, 40, 100);
+  fbg_indexedRect(indexed, 300, 180, 40, 40, 0);
+  fbg_indexedLine(indexed, -50, 0, 400, 199, 100);
+  fbg_indexedPixel(indexed, 160, 100, 0);
+
+  // color cycling only touch the palette
+  fbg_indexedCycle(indexed, 1, 64, 10);
+
+  fbg_indexedDraw(fbg, indexed, 40, 20);
+  fbg_indexedDraw(fbg, indexed, -100, 230);
+  fbg_indexedDraw(fbg, indexed, 250, -150);
+
+  fbg_freeIndexed(indexed);
+}
+
+void scene_shapes(struct _fbg *fbg) {
+  fbg_background(fbg, 30, 60, 90);
+
+  fbg_circle(fbg, 60, 60, 50, 255, 255, 255);
+  fbg_circleFill(fbg, 60, 60, 30, 255, 0, 0);
+  fbg_circleFilla(fbg, 80, 70, 30, 0, 255, 0, 128);
+  fbg_circlea(fbg, 80, 70, 40, 255, 255, 0, 96);
+  fbg_circleFill(fbg, -20, 150, 60, 0, 0, 255);
+
+  fbg_ellipse(fbg, 250, 60, 120, 40, 255, 255, 255);
+  fbg_ellipseFill(fbg, 250, 60, 80, 20, 200, 100, 0);
+  fbg_ellipseFilla(fbg, 250, 60, 20, 55, 0, 200, 255, 160);
+  fbg_ellipsea(fbg, 390, 280, 60, 90, 255, 0, 255, 200);
+  fbg_ellipseFill(fbg, 200, 150, 150, 0, 255, 255, 255);
+
+  fbg_roundRect(fbg, 20, 170, 200, 110, 20, 255, 255, 255);
+  fbg_roundRectFill(fbg, 30, 180, 180, 90, 40, 90, 30, 120);
+  fbg_roundRectFilla(fbg, 150, 200, 200, 150, 30, 255, 128, 0, 100);
+  fbg_roundRecta(fbg, 240, 120, 140, 60, 500, 0, 255, 0, 200);
+  fbg_spana(fbg, -10, 295, 500, 255, 255, 255, 64);
+}
+
+void scene_gradients(struct _fbg *fbg) {
+  struct _fbg_rgb sky[2] = { { 10, 20, 60, 0 }, { 230, 120, 40, 0 } };
+  struct _fbg_rgb stops[4] = { { 255, 0, 0, 0 }, { 255, 255, 0, 0 }, { 0, 255, 0, 0 }, { 0, 0, 255, 0 } };
+
+  struct _fbg_gradient *linear = fbg_createLinearGradient(0, 0, 0, SCENE_HEIGHT - 1);
+  struct _fbg_gradient *radial = fbg_createRadialGradient(300, 200, 90);
+  if (!linear || !radial) {
+    return;
+  }
+
+  fbg_gradientStops(linear, sky, 2);
+  fbg_gradientBackground(fbg, linear);
+
+  // horizontal, diagonal (reversed) then a 256 entries HSL ramp
+  fbg_gradientStops(linear, stops, 4);
+  fbg_gradientLinear(linear, 20, 0, 180, 0);
+  fbg_gradientRect(fbg, linear, -10, 10, 220, 60);
+  fbg_gradientLinear(linear, 380, 280, 220, 90);
+  fbg_gradientRect(fbg, linear, 200, 80, 250, 250);
+
+  struct _fbg_rgb ramp[256];
+  struct _fbg_hsl from = { 0, 1.0f, 0.5f }, to = { 300, 1.0f, 0.5f };
+  fbg_hslGradient(ramp, 256, &from, &to);
+  fbg_gradientStops(linear, ramp, 256);
+  fbg_gradientLinear(linear, 0, 100, 30, 220);
+  fbg_gradientRect(fbg, linear, 10, 90, 170, 120);
+
+  fbg_gradientStops(radial, stops, 3);
+  fbg_gradientRect(fbg, radial, 190, 90, 200, 200);
+  fbg_gradientRadial(radial, -20, 320, 120);
+  fbg_gradientRect(fbg, radial, -50, 220, 200, 200);
+  fbg_gradientRadial(radial, 100, 250, 0);
+  fbg_gradientRect(fbg, radial, 90, 240, 20, 20);
+
+  for (int y = 0; y < 20; y++) {
+    fbg_gradientSpan(fbg, radial, -30 + y * 5, 275 + y, 460 - y * 10);
+  }
+
+  fbg_freeGradient(linear);
+  fbg_freeGradient(radial);
+}
+
+void scene_transforms(struct _fbg *fbg) {
+  fbg_clear(fbg, 16);
+
+  struct _fbg_img *img = test_image(fbg, 64, 48);
+  if (!img) {
+    return;
+  }
+
+  // the quads are affine between exact texels every FBG_PERSPECTIVE_SPAN pixels, the golden values are for the default span (16)
+  int floor[8] = { 140, 150, 260, 150, 430, 310, -30, 310 };
+  fbg_imageQuad(fbg, img, floor);
+
+  int wall[8] = { 300, 10, 390, -20, 390, 140, 300, 110 };
+  fbg_imageQuad(fbg, img, wall);
+
+  for (int i = 0; i < 6; i++) {
+    fbg_imageRotate(fbg, img, 70, 70, 8, 24, i * 1.047f, 0.75f);
+  }
+
+  fbg_imageAffine(fbg, img, 1.0f, 0.5f, -0.25f, 1.5f, 160, 20);
+  fbg_imageAffine(fbg, img, -2.0f, 0, 0, 2.0f, 60, 150);
+  fbg_imageRotate(fbg, img, 400, 300, 32, 24, 0.3f, 3.0f);
+
+  fbg_freeImage(img);
+}
+
+void scene_afont(struct _fbg *fbg) {
+  fbg_clear(fbg, 200);
+
+  // odd widths / positions so that both the paired and the tail blends are used
+  const uint8_t mask[3 * 3] = { 128, 128, 128, 255, 64, 0, 1, 254, 17 };
+  fbg_maskBlend(fbg, mask, 3, 1, 1, 3, 3, 0, 0, 0);
+  fbg_maskBlend(fbg, mask, 3, -1, 297, 3, 3, 255, 0, 0);
+
+  struct _fbg_pfont *pfont = fbg_createDefaultPFont(fbg);
+  if (!pfont) {
+    return;
+  }
+
+  int sizes[3] = { 7, 13, 24 };
+  for (int i = 0; i < 3; i++) {
+    struct _fbg_afont *afont = fbg_createAFont(fbg, pfont, sizes[i]);
+    if (!afont) {
+      continue;
+    }
+
+    fbg_afontText(fbg, afont, "Anti-aliased 0123\nodd width", 5 + i * 3, 20 + i * 60, 20, 40, 60);
+    fbg_afontText(fbg, afont, "clipped", -7, 290, 255, 255, 255);
+    fbg_afontText(fbg, afont, "clipped", 395 - afont->line_height, 150, 0, 0, 255);
+
+    fbg_freeAFont(afont);
+  }
+
+  fbg_freePFont(pfont);
+}
+
+// font with a glyph above the line top (negative bearing) and descenders below the line height
+struct _fbg_pfont *test_pfont(struct _fbg *fbg) {
+  struct _fbg_glyph glyphs[4] = {
+    { 0, 8, 10, 0, -2, 9 },
+    { 10, 8, 4, 1, 6, 9 },
+    { 14, 5, 3, 0, 2, 6 },
+    { 17, 7, 12, -1, 1, 7 }
+  };
+
+  uint32_t bitmap[29];
+  for (int i = 0; i < 29; i++) {
+    bitmap[i] = 0xfe000000u ^ (i * 0x13000000u);
+  }
+
+  return fbg_createPFont(fbg, 'a', 4, 8, glyphs, bitmap, 29);
+}
+
+void scene_fonts(struct _fbg *fbg) {
+  fbg_clear(fbg, 10);
+
+  struct _fbg_pfont *pfont = fbg_createDefaultPFont(fbg);
+  struct _fbg_pfont *tall = test_pfont(fbg);
+  struct _fbg_text_cache *cache = fbg_createTextCache(16);
+  if (!pfont || !tall || !cache) {
+    return;
+  }
+
+  fbg_pfontKerning(pfont, 'A', 'V', -2);
+
+  const char *text = "AVAV proportional\nsecond line 0123";
+  const char *tall_text = "abcd dcba\nddaa\n cab";
+
+  // uncached and cached (miss then hit) in the same frame
+  fbg_pfontText(fbg, pfont, text, 3, 5, 255, 255, 255);
+  fbg_pfontTextCached(fbg, cache, pfont, text, 3, 35, 255, 200, 0);
+  fbg_pfontTextCached(fbg, cache, pfont, text, 203, 35, 0, 200, 255);
+
+  fbg_pfontText(fbg, tall, tall_text, 7, 80, 255, 0, 0);
+  fbg_pfontTextCached(fbg, cache, tall, tall_text, 107, 80, 0, 255, 0);
+  fbg_pfontTextCached(fbg, cache, tall, tall_text, -3, -1, 0, 0, 255);
+
+  fbg_text_new(fbg, "text_new 2x", 5, 140, 2, 200, 200, 200);
+  fbg_textCached(fbg, cache, "text_new 2x", 5, 160, 2, 200, 100, 50);
+  fbg_textCached(fbg, cache, "edge", fbg->width - 30, fbg->height - 10, 3, 50, 100, 200);
+
+  fbg_freeTextCache(cache);
+  fbg_freePFont(tall);
+  fbg_freePFont(pfont);
+}
+
+void scene_bitmap_font(struct _fbg *fbg) {
+  fbg_clear(fbg, 40);
+
+  // 16 glyphs of 7x9 pixels, pixels with a first component of 0 are the color key
+  struct _fbg_img *img = fbg_createImage(fbg, 7 * 8, 9 * 2);
+  if (!img) {
+    return;
+  }
+
+  for (unsigned int y = 0; y < img->height; y++) {
+    for (unsigned int x = 0; x < img->width; x++) {
+      unsigned char *p = img->data + (y * img->width + x) * fbg->components;
+      memset(p, ((x * 7 + y * 3) % 5 < 2) ? 255 : 0, fbg->components);
+    }
+  }
+
+  struct _fbg_font *font = fbg_createFont(fbg, img, 7, 9, 'A');
+  if (!font) {
+    fbg_freeImage(img);
+    return;
+  }
+
+  fbg_text(fbg, font, "ABCDEFGH\nIJ KLMNOP", 3, 3, 255, 255, 0);
+
+  fbg_textColorKey(fbg, 0);
+  fbg_textBackground(fbg, 0, 0, 255, 128);
+  fbg_text(fbg, font, "PONM LKJI", 101, 51, 0, 255, 0);
+
+  fbg_freeFont(font);
+  fbg_freeImage(img);
+}
+
+void scene_atlas(struct _fbg *fbg) {
+  fbg_clear(fbg, 0);
+
+  struct _fbg_atlas *atlas = fbg_createAtlas(fbg, 64, 64);
+  if (!atlas) {
+    return;
+  }
+
+  // odd sizes
+  int sizes[5][2] = { { 13, 7 }, { 21, 17 }, { 5, 30 }, { 31, 11 }, { 9, 9 } };
+  struct _fbg_img *images[5];
+  int indexes[5];
+  for (int i = 0; i < 5; i++) {
+    images[i] = test_image(fbg, sizes[i][0], sizes[i][1]);
+    if (!images[i]) {
+      return;
+    }
+  }
+
+  fbg_atlasAddImages(fbg, atlas, images, 5, indexes);
+
+  for (int i = 0; i < 5; i++) {
+    fbg_atlasImage(fbg, atlas, indexes[i], 3 + i * 37, 5 + i);
+  }
+
+  // non-overlapping blits (the batch order is not preserved)
+  struct _fbg_atlas_blit blits[40];
+  for (int i = 0; i < 40; i++) {
+    blits[i].index = indexes[i % 5];
+    blits[i].x = 1 + (i % 10) * 39;
+    blits[i].y = 60 + (i / 10) * 33;
+  }
+
+  fbg_atlasBatch(fbg, atlas, blits, 40);
+
+  for (int i = 0; i < 5; i++) {
+    fbg_freeImage(images[i]);
+  }
+
+  fbg_freeAtlas(atlas);
+}
+
+void scene_set_indexed(struct _fbg *fbg) {
+  struct _fbg_indexed *indexed = fbg_createIndexed(fbg, fbg->width, fbg->height);
+  if (!indexed) {
+    return;
+  }
+
+  struct _fbg_rgb palette[256];
+  struct _fbg_rgb from = { 0, 0, 64, 0 }, to = { 255, 220, 0, 0 };
+  fbg_rgbGradient(palette, 256, &from, &to);
+  fbg_indexedPalette(indexed, 0, 256, palette);
+
+  for (int i = 0; i < 64; i++) {
+    fbg_indexedRect(indexed, i * 7 - 20, i * 5 - 10, 41, 23, i * 4);
+    fbg_indexedLine(indexed, 0, i * 5, fbg->width - 1, fbg->height - 1 - i * 3, 255 - i);
+  }
+
+  // fbg_draw expand the surface into the back buffer
+  fbg_setIndexed(fbg, indexed);
+  fbg_draw(fbg);
+  fbg_setIndexed(fbg, NULL);
+
+  fbg_freeIndexed(indexed);
+
+  fbg_rect(fbg, 10, 10, 5, 5, 255, 0, 0);
+}
+
+struct scene {
+  const char *name;
+  void (*render)(struct _fbg *fbg);
+  // frame width (0 = SCENE_WIDTH)
+  int width;
+};
+
+struct scene scenes[] = {
+  { "fill", scene_fill, 0 },
+  { "pixels", scene_pixels, 0 },
+  { "lines", scene_lines, 0 },
+  { "rects", scene_rects, 0 },
+  { "images", scene_images, 0 },
+  { "text", scene_text, 0 },
+  { "hsl", scene_hsl, 0 },
+  { "ramps", scene_ramps, 0 },
+  { "indexed", scene_indexed, 0 },
+  { "shapes", scene_shapes, 0 },
+  { "gradients", scene_gradients, 0 },
+  { "transforms", scene_transforms, 0 },
+  { "afont", scene_afont, 0 },
+  { "afont_odd", scene_afont, 397 },
+  { "fonts", scene_fonts, 0 },
+  { "fonts_odd", scene_fonts, 397 },
+  { "bitmap_font", scene_bitmap_font, 0 },
+  { "atlas", scene_atlas, 0 },
+  { "atlas_odd", scene_atlas, 397 },
+  { "set_indexed", scene_set_indexed, 0 },
+  { "set_indexed_odd", scene_set_indexed, 397 },
+  { "console", scene_console, 0 }
+};
+
+uint64_t render(struct scene *scene, int components, int threads) {
+  struct _fbg *fbg = fbg_customSetup(scene->width ? scene->width : SCENE_WIDTH, SCENE_HEIGHT, components, 1, 0, NULL, NULL, NULL, NULL, NULL);
+  if (!fbg) {
+    return 0;
+  }
+
+  fbg_setThreads(fbg, threads);
+
+  scene->render(fbg);
+
+  fbg_draw(fbg);
+  fbg_flip(fbg);
+
+  uint64_t checksum = fbg_frameChecksum(fbg, fbg->disp_buffer);
+
+  fbg_close(fbg);
+
+  return checksum;
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = NULL;
+  int write = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-w") == 0) {
+      write = 1;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  FILE *golden = NULL;
+  if (path) {
+    golden = fopen(path, write ? "w" : "r");
+    if (!golden) {
+      fprintf(stderr, "golden: cannot open '%s'!\n", path);
+      return 1;
+    }
+  }
+
+  int failures = 0;
+
+  for (size_t i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++) {
+    for (int components = 3; components <= 4; components++) {
+      uint64_t checksum = render(&scenes[i], components, 1);
+
+      // the threaded paths must be bit-exact with the serial ones
+      uint64_t threaded_checksum = render(&scenes[i], components, 4);
+      if (threaded_checksum != checksum) {
+        printf("%-8s %i  threaded %016llx != serial %016llx\n", scenes[i].name, components, (unsigned long long)threaded_checksum, (unsigned long long)checksum);
+        failures++;
+      }
+
+      if (golden && write) {
+        fprintf(golden, "%s %i %016llx\n", scenes[i].name, components, (unsigned long long)checksum);
+      } else if (golden) {
+        char name[64];
+        int golden_components;
+        unsigned long long golden_checksum;
+
+        if (fscanf(golden, "%63s %i %llx", name, &golden_components, &golden_checksum) != 3 || strcmp(name, scenes[i].name) != 0 || golden_components != components) {
+          printf("%-8s %i  missing golden value\n", scenes[i].name, components);
+          failures++;
+        } else if (golden_checksum != checksum) {
+          printf("%-8s %i  %016llx != golden %016llx\n", scenes[i].name, components, (unsigned long long)checksum, golden_checksum);
+          failures++;
+        } else {
+          printf("%-8s %i  ok\n", scenes[i].name, components);
+        }
+      } else {
+        printf("%-8s %i  %016llx\n", scenes[i].name, components, (unsigned long long)checksum);
+      }
+    }
+  }
+
+  if (golden) {
+    fclose(golden);
+  }
+
+  if (failures) {
+    printf("%i failure(s)\n", failures);
+    return 1;
+  }
+
+  return 0;
+}
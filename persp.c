@@ -4,6 +4,7 @@
 #include "fbg_fbdev.h" // insert any backends from ../custom_backend/backend_name folder
 #include "fbgraphics.h"
 #include <stdlib.h>
+#include <string.h>
 
 int keep_running = 1;
 
@@ -56,6 +57,20 @@ void draw_lines_between_elements(struct _fbg *fbg) {
     // }
   }
 
+// checkerboard texture scrolled toward the viewer
+void update_ground(struct _fbg_img *ground, int scroll) {
+  for (unsigned int v = 0; v < ground->height; v++) {
+    for (unsigned int u = 0; u < ground->width; u++) {
+      unsigned char *pix = ground->data + (v * ground->width + u) * ground->components;
+      int light = (((u >> 3) ^ ((v - scroll) >> 3)) & 1);
+
+      pix[0] = light ? 220 : 30;
+      pix[1] = light ? 220 : 60;
+      pix[2] = light ? 220 : 120;
+    }
+  }
+}
+
 void int_handler(int dummy) {
   keep_running = 0;
 }
@@ -70,8 +85,29 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  fbg_setTargetFramerate(fbg, 60);
+
   initialize_elements(fbg, vertex_size, vertex_size);
 
+  struct _fbg_img *ground = fbg_createImage(fbg, 64, 64);
+  struct _fbg_img *needle = fbg_createImage(fbg, 64, 4);
+  if (!ground || !needle) {
+    fbg_close(fbg);
+    return 0;
+  }
+
+  memset(needle->data, 255, needle->width * needle->height * needle->components);
+
+  // pseudo-3D floor on the lower half : the far edge is narrower
+  int ground_quad[8] = {
+    fbg->width * 3 / 8, fbg->height / 2,
+    fbg->width * 5 / 8, fbg->height / 2,
+    fbg->width, fbg->height,
+    0, fbg->height
+  };
+
+  int frame = 0;
+
   do {
 
     fbg_clear(fbg, 0); // can also be replaced by fbg_background(fbg, 0, 0, 0);
@@ -81,11 +117,22 @@ int main(int argc, char *argv[]) {
     update_and_draw_elements(fbg, vertex_size, vertex_size);
     draw_lines_between_elements(fbg);
 
+    update_ground(ground, frame);
+    fbg_imageQuad(fbg, ground, ground_quad);
+
+    // dial needle rotating around its left end
+    fbg_imageRotate(fbg, needle, fbg->width / 2, fbg->height / 4, 0, 2, frame * 0.05f, 1.0f);
+
+    frame++;
+
     fbg_flip(fbg);
   }
   while (keep_running)
     ;
 
+  fbg_freeImage(ground);
+  fbg_freeImage(needle);
+
   fbg_close(fbg);
 
   return 0;
@@ -16,6 +16,9 @@ int dys[NUM_ELEMS];
 
 int vertex_size = 2;
 
+// amount of drawn elements, lowered by the quality governor when frames take too long
+int active_elems = NUM_ELEMS;
+
 void initialize_elements(struct _fbg *fbg, int w, int h) {
   for (int n = 0; n < NUM_ELEMS; n++) {
     xs[n] = rand() % (fbg->width - w);
@@ -26,7 +29,7 @@ void initialize_elements(struct _fbg *fbg, int w, int h) {
 }
 
 void update_and_draw_elements(struct _fbg *fbg, int w, int h) {
-  for (int n = 0; n < NUM_ELEMS; n++) {
+  for (int n = 0; n < active_elems; n++) {
     int x = xs[n];
     int y = ys[n];
     int dx = dxs[n];
@@ -59,8 +62,8 @@ void update_and_draw_elements(struct _fbg *fbg, int w, int h) {
 }
 
 void draw_lines_between_elements(struct _fbg *fbg) {
-  for (int j = 0; j < NUM_ELEMS; j++) {
-    for (int k = 0; k < NUM_ELEMS; k++) {
+  for (int j = 0; j < active_elems; j++) {
+    for (int k = 0; k < active_elems; k++) {
       fbg_line(fbg, xs[j] + 1, ys[j] + 1, xs[k] + 1, ys[k] + 1,
                (j * 15) % 255, (k * 25) % 255, ((j + k) * 35) % 255);
     }
@@ -81,6 +84,15 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  fbg_setTargetFramerate(fbg, 60);
+
+  // drop elements when the frame time get close to the 60 fps budget
+  struct _fbg_governor *governor = fbg_createGovernor(0);
+  if (governor) {
+    fbg_governorAddKnob(governor, &active_elems, 3, NUM_ELEMS, 1, NULL, NULL);
+    fbg_setGovernor(fbg, governor);
+  }
+
   initialize_elements(fbg, vertex_size, vertex_size);
 
   do {
@@ -97,6 +109,11 @@ int main(int argc, char *argv[]) {
   while (keep_running)
     ;
 
+  if (governor) {
+    fbg_setGovernor(fbg, NULL);
+    fbg_freeGovernor(governor);
+  }
+
   fbg_close(fbg);
 
   return 0;
@@ -0,0 +1,133 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fbg_fbdev.h"
+#include "fbg_stream.h"
+#include "fbgraphics.h"
+
+// stream viewer / recorder
+//   streamview [stream]              display the stream (file, named pipe, standard output of a streaming app when omitted) on /dev/fb0
+//   streamview [stream] -o prefix    write every frame as prefix_00000.ppm, prefix_00001.ppm etc. (no display needed)
+
+int keep_running = 1;
+
+void int_handler(int dummy) {
+  keep_running = 0;
+}
+
+int save_ppm(const char *prefix, struct _fbg_stream_reader *reader) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s_%05u.ppm", prefix, reader->index);
+
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "streamview: cannot create '%s'!\n", path);
+    return 0;
+  }
+
+  int components = reader->header.components;
+  int pixels = reader->header.width * reader->header.height;
+
+  fprintf(f, "P6\n%u %u\n255\n", reader->header.width, reader->header.height);
+  for (int i = 0; i < pixels; i++) {
+    fwrite(reader->frame + i * components, 1, 3, f);
+  }
+
+  fclose(f);
+
+  return 1;
+}
+
+void show_frame(struct _fbg *fbg, struct _fbg_stream_reader *reader) {
+  int components = reader->header.components;
+  int w = _FBG_MIN((int)reader->header.width, fbg->width);
+  int h = _FBG_MIN((int)reader->header.height, fbg->height);
+
+  for (int y = 0; y < h; y++) {
+    unsigned char *src = reader->frame + y * reader->header.width * components;
+    unsigned char *dst = fbg->back_buffer + y * fbg->line_length;
+
+    if (components == fbg->components) {
+      memcpy(dst, src, w * components);
+    } else {
+      for (int x = 0; x < w; x++) {
+        memcpy(dst + x * fbg->components, src + x * components, 3);
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  signal(SIGINT, int_handler);
+
+  const char *input = NULL;
+  const char *prefix = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      prefix = argv[++i];
+    } else {
+      input = argv[i];
+    }
+  }
+
+  int fd = input ? open(input, O_RDONLY) : STDIN_FILENO;
+  if (fd == -1) {
+    fprintf(stderr, "streamview: cannot open '%s'!\n", input);
+    return 1;
+  }
+
+  struct _fbg_stream_reader *reader = fbg_streamOpenReader(fd);
+  if (!reader) {
+    return 1;
+  }
+
+  fprintf(stderr, "streamview: %ux%u, %u components\n", reader->header.width, reader->header.height, reader->header.components);
+
+  struct _fbg *fbg = NULL;
+  if (!prefix) {
+    fbg = fbg_fbdevInit();
+    if (fbg == NULL) {
+      fbg_streamFreeReader(reader);
+      return 1;
+    }
+  }
+
+  unsigned long frames = 0;
+  unsigned long tiles = 0;
+
+  while (keep_running && fbg_streamReadFrame(reader)) {
+    frames++;
+    tiles += reader->tiles_count;
+
+    if (prefix) {
+      if (!save_ppm(prefix, reader)) {
+        break;
+      }
+    } else {
+      // the stream pace the display
+      show_frame(fbg, reader);
+
+      fbg_draw(fbg);
+      fbg_flip(fbg);
+    }
+  }
+
+  fprintf(stderr, "streamview: %lu frames, %.1f modified tiles per frame\n", frames, frames ? (double)tiles / frames : 0.0);
+
+  if (fbg) {
+    fbg_close(fbg);
+  }
+
+  fbg_streamFreeReader(reader);
+
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
+
+  return 0;
+}
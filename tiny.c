@@ -15,11 +15,17 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, int_handler);
 
     // open "/dev/fb0" by default, use fbg_fbdevSetup("/dev/fb1", 0) if you want to use another framebuffer
+    // use fbg_fbdevSetupEx(NULL, 0, 2) to render at half resolution (upscaled when drawn)
     // note : fbg_fbdevInit is the linux framebuffer backend, you can use a different backend easily by including the proper header and compiling with the appropriate backend file found in ../custom_backend/backend_name
     struct _fbg *fbg = fbg_fbdevInit();
     if (fbg == NULL) {
         return 0;
     }
+
+    fbg_setTargetFramerate(fbg, 60);
+
+    // full-screen clears use every core (0 = online processors count)
+    fbg_setThreads(fbg, 0);
     
     do {
         x_offset = (x_offset + 1) % fbg->width;
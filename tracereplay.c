@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fbgraphics.h"
+
+// trace replayer
+//   tracereplay trace.fbgt        replay a trace (recorded with a FBG_TRACE build) and print each frame checksum / replay time then per call timings
+//   tracereplay trace.fbgt -q     only print the summary
+
+const char *op_names[FBG_TRACE_OPS] = {
+  "image data", "draw", "flip", "resize", "clear", "background", "fadeDown", "fadeUp", "fill",
+  "pixel", "pixela", "fpixel", "hline", "vline", "line", "polygon", "rect", "recta", "frect",
+  "text_new", "image", "imageColorkey", "imageClip", "imageEx", "ellipse", "roundRect",
+  "span", "spana", "imageAffine", "imageQuad", "untraced"
+};
+
+void print_frame(struct _fbg *fbg, uint32_t frame, uint64_t checksum, uint64_t time, void *user_data) {
+  (void)fbg;
+
+  int quiet = *(int *)user_data;
+  if (!quiet) {
+    printf("frame %5u  %016llx  %8.3f ms\n", frame, (unsigned long long)checksum, time / 1000000.0);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = NULL;
+  int quiet = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0) {
+      quiet = 1;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  if (!path) {
+    fprintf(stderr, "usage: tracereplay trace.fbgt [-q]\n");
+    return 1;
+  }
+
+  struct _fbg_trace_stats stats;
+  int frames = fbg_traceReplay(path, print_frame, &quiet, &stats);
+  if (frames < 0) {
+    return 1;
+  }
+
+  printf("\n%u frames replayed in %.3f ms\n", stats.frames, stats.total_time / 1000000.0);
+  if (stats.untraced_frames) {
+    printf("%u frames use untraced calls, their checksums can differ from the recording\n", stats.untraced_frames);
+  }
+  printf("\n");
+  printf("%-14s %10s %12s %12s\n", "call", "count", "total ms", "avg us");
+
+  for (int op = 0; op < FBG_TRACE_OPS; op++) {
+    if (stats.calls[op] == 0) {
+      continue;
+    }
+
+    printf("%-14s %10lu %12.3f %12.3f\n", op_names[op], stats.calls[op], stats.time[op] / 1000000.0, stats.time[op] / 1000.0 / stats.calls[op]);
+  }
+
+  return 0;
+}